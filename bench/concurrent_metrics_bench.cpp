@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: MIT
+// Scaling benchmark for ConcurrentMetrics versus a mutex-guarded Metrics.
+//
+// Usage: concurrent-metrics-bench [completions_per_thread] [max_threads]
+
+#include "concurrent_metrics.hpp"
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int kUsers = 1024;
+
+Request synthetic_request(uint64_t i) {
+    Request r{};
+    r.user_id = static_cast<int>((i * 2654435761u) % kUsers);
+    r.op = (i & 1) ? OpType::WRITE : OpType::READ;
+    r.arrival_ts = static_cast<double>(i) * 1e-6;
+    r.size_bytes = 4096u << (i % 6);
+    r.start_ts = r.arrival_ts;
+    r.finish_ts = r.arrival_ts + 1e-5 * static_cast<double>(1 + i % 97);
+    return r;
+}
+
+template <typename Body>
+double run_threads(int threads, Body body) {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) workers.emplace_back(body, t);
+    for (auto& w : workers) w.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t per_thread = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2'000'000;
+    int max_threads = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    std::cout << "threads,sharded_mops,mutex_mops,speedup\n";
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        ssd::ConcurrentMetrics sharded(kUsers, threads);
+        double sharded_s = run_threads(threads, [&](int t) {
+            for (uint64_t i = 0; i < per_thread; ++i)
+                sharded.on_finish(t, synthetic_request(i + t * per_thread));
+        });
+
+        ssd::Metrics shared(kUsers);
+        std::mutex lock;
+        double mutex_s = run_threads(threads, [&](int t) {
+            for (uint64_t i = 0; i < per_thread; ++i) {
+                Request r = synthetic_request(i + t * per_thread);
+                std::lock_guard<std::mutex> guard(lock);
+                shared.on_finish(r);
+            }
+        });
+
+        auto snap = sharded.snapshot();
+        uint64_t total = 0;
+        for (uint64_t c : snap.completed) total += c;
+        if (total != per_thread * threads) {
+            std::cerr << "lost completions: " << total << "\n";
+            return 1;
+        }
+
+        double ops = static_cast<double>(per_thread) * threads;
+        double sharded_mops = ops / sharded_s / 1e6;
+        double mutex_mops = ops / mutex_s / 1e6;
+        std::cout << threads << "," << sharded_mops << "," << mutex_mops << ","
+                  << sharded_mops / mutex_mops << "\n";
+    }
+    return 0;
+}
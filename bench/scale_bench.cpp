@@ -0,0 +1,404 @@
+// SPDX-License-Identifier: MIT
+// End-to-end scale benchmark: every policy against in-process synthetic
+// workloads across tenant, request and channel counts, with budgets.
+//
+// Usage: scale-bench [--tier smoke|full] [--tenants N,..] [--requests N,..]
+//                    [--channels N,..] [--policies rr,drr,..] [--report PATH]
+//                    [--max-wall-s S] [--max-rss-mb MB]
+//                    [--max-allocs-per-request X] [--min-events-per-s X]
+//
+// Each case runs in a forked child so peak RSS is per case and a case that
+// blows its wall budget is killed rather than stalling the suite. L1D read
+// and LLC misses come from perf_event_open when the PMU is exposed. Requests
+// are generated on the fly and never stored. Exit status is 1 when any case
+// exceeds a ceiling.
+
+#include "metrics.hpp"
+#include "scheduler_impl.hpp"
+#include "simulator.hpp"
+#include "ssd.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{0};
+
+} // namespace
+
+// Count every heap allocation made by the simulator in this process.
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+struct Case {
+    std::string policy;
+    uint64_t tenants = 0;
+    uint64_t requests = 0;
+    int channels = 0;
+};
+
+// CaseResult crosses the fork boundary as raw bytes, so it stays POD.
+struct CaseResult {
+    double wall_s = 0.0;
+    double peak_rss_mb = 0.0;
+    uint64_t allocations = 0;
+    uint64_t events = 0;
+    uint64_t completed = 0;
+    double fairness = 0.0;
+    int64_t l1d_misses = -1;  // -1 when the PMU is unavailable
+    int64_t llc_misses = -1;
+    int status = 0;  // 0 ok, 1 killed by the wall budget, 2 crashed
+};
+
+// PerfCounter counts one hardware event for this process in user space.
+// Virtual machines and containers often hide the PMU; the counter then
+// reads -1 and the report records null.
+class PerfCounter {
+public:
+    PerfCounter(uint32_t type, uint64_t config) {
+        perf_event_attr attr {};
+        attr.type = type;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd_ = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+    ~PerfCounter() {
+        if (fd_ >= 0) close(fd_);
+    }
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+
+    void start() {
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    int64_t stop() {
+        if (fd_ < 0) return -1;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        int64_t value = 0;
+        return read(fd_, &value, sizeof(value)) == sizeof(value) ? value : -1;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+struct Ceilings {
+    double max_wall_s = 600.0;
+    double max_rss_mb = 8192.0;
+    double max_allocs_per_request = 4.0;
+    double min_events_per_s = 1e5;
+};
+
+constexpr double kChannelMBps = 250.0;  // per-channel bandwidth, read and write
+constexpr double kLoad = 0.9;           // offered load relative to capacity
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// SyntheticWorkload yields Poisson arrivals at kLoad of device capacity. A
+// fifth of the tenants receives half the requests. Sizes range from 4 KiB
+// to 128 KiB, and 30% of requests are writes.
+class SyntheticWorkload {
+public:
+    SyntheticWorkload(uint64_t tenants, int channels) : tenants_(tenants) {
+        double mean_bytes = 4096.0 * (1 + 2 + 4 + 8 + 16 + 32) / 6.0;
+        double capacity = kChannelMBps * channels * 1024.0 * 1024.0;
+        mean_gap_s_ = mean_bytes / (capacity * kLoad);
+    }
+
+    Request next() {
+        uint64_t h = mix(++seq_);
+        double u = static_cast<double>((h >> 11) + 1) / 9007199254740993.0;
+        now_ += -std::log(u) * mean_gap_s_;
+
+        uint64_t g = mix(h);
+        uint64_t hot = std::max<uint64_t>(tenants_ / 5, 1);
+        uint64_t uid = (g & 1) ? (g >> 1) % hot : (g >> 1) % tenants_;
+
+        Request r{};
+        r.user_id = static_cast<int>(uid);
+        r.op = (g >> 40) % 10 < 3 ? OpType::WRITE : OpType::READ;
+        r.arrival_ts = now_;
+        r.size_bytes = 4096u << ((g >> 48) % 6);
+        r.address = (g >> 8) << 12;
+        return r;
+    }
+
+private:
+    uint64_t tenants_;
+    uint64_t seq_ = 0;
+    double now_ = 0.0;
+    double mean_gap_s_ = 0.0;
+};
+
+CaseResult run_case(const Case& c) {
+    CaseResult result;
+    PerfCounter l1d(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+                                            (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                            (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    PerfCounter llc(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    l1d.start();
+    llc.start();
+    uint64_t allocs_before = g_allocations.load(std::memory_order_relaxed);
+    auto t0 = std::chrono::steady_clock::now();
+
+    ssd::SchedulerOptions opts;
+    auto scheduler = ssd::make_scheduler(c.policy, opts);
+    int users = static_cast<int>(c.tenants);
+    scheduler->set_users(users);
+    SimConfig cfg { users, c.channels, kChannelMBps * c.channels,
+                    kChannelMBps * c.channels, {}, {}, OracleMode::Off, nullptr };
+    ssd::SSD device(cfg);
+    ssd::Metrics metrics(users);
+    ssd::Simulator sim(*scheduler, device, metrics);
+
+    SyntheticWorkload workload(c.tenants, c.channels);
+    for (uint64_t i = 0; i < c.requests; ++i)
+        sim.admit(workload.next());
+    sim.drain();
+    result.l1d_misses = l1d.stop();
+    result.llc_misses = llc.stop();
+
+    result.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    result.allocations = g_allocations.load(std::memory_order_relaxed) - allocs_before;
+    result.events = sim.stats().admitted + sim.stats().dispatched + sim.stats().completed;
+    result.completed = sim.stats().completed;
+    result.fairness = metrics.fairness_index();
+
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    result.peak_rss_mb = static_cast<double>(usage.ru_maxrss) / 1024.0;
+    return result;
+}
+
+// run_isolated forks a child for |c|, killing it once |wall_budget_s| passes.
+CaseResult run_isolated(const Case& c, double wall_budget_s) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::perror("pipe");
+        std::exit(2);
+    }
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        alarm(static_cast<unsigned>(std::ceil(wall_budget_s)));
+        CaseResult r = run_case(c);
+        ssize_t written = write(fds[1], &r, sizeof(r));
+        _exit(written == static_cast<ssize_t>(sizeof(r)) ? 0 : 1);
+    }
+    close(fds[1]);
+
+    CaseResult result;
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (got != static_cast<ssize_t>(sizeof(result))) {
+        result = CaseResult{};
+        bool timed_out = WIFSIGNALED(status) && WTERMSIG(status) == SIGALRM;
+        result.status = timed_out ? 1 : 2;
+        result.wall_s = timed_out ? wall_budget_s : 0.0;
+    }
+    return result;
+}
+
+std::vector<uint64_t> parse_list(const char* text) {
+    std::vector<uint64_t> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) values.push_back(static_cast<uint64_t>(std::stod(item)));
+    return values;
+}
+
+std::vector<std::string> parse_names(const char* text) {
+    std::vector<std::string> names;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty()) names.push_back(item);
+    return names;
+}
+
+std::string counter_json(int64_t value) {
+    return value < 0 ? "null" : std::to_string(value);
+}
+
+// violations lists which ceilings |r| broke.
+std::vector<std::string> violations(const Case& c, const CaseResult& r, const Ceilings& lim) {
+    std::vector<std::string> out;
+    if (r.status == 1) out.push_back("wall_timeout");
+    if (r.status == 2) out.push_back("crashed");
+    if (r.status != 0) return out;
+    if (r.wall_s > lim.max_wall_s) out.push_back("wall_s");
+    if (r.peak_rss_mb > lim.max_rss_mb) out.push_back("peak_rss_mb");
+    if (static_cast<double>(r.allocations) > lim.max_allocs_per_request * static_cast<double>(c.requests))
+        out.push_back("allocations");
+    if (r.wall_s > 0.0 && static_cast<double>(r.events) / r.wall_s < lim.min_events_per_s)
+        out.push_back("events_per_s");
+    if (r.completed != c.requests) out.push_back("lost_requests");
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string tier = "smoke";
+    std::string report_path = "scale_report.json";
+    std::vector<uint64_t> tenants, requests, channels;
+    std::vector<std::string> policies = { "rr", "drr", "qfq", "sgfs" };
+    Ceilings lim;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--tier") tier = value;
+        else if (flag == "--tenants") tenants = parse_list(value);
+        else if (flag == "--requests") requests = parse_list(value);
+        else if (flag == "--channels") channels = parse_list(value);
+        else if (flag == "--policies") policies = parse_names(value);
+        else if (flag == "--report") report_path = value;
+        else if (flag == "--max-wall-s") lim.max_wall_s = std::atof(value);
+        else if (flag == "--max-rss-mb") lim.max_rss_mb = std::atof(value);
+        else if (flag == "--max-allocs-per-request") lim.max_allocs_per_request = std::atof(value);
+        else if (flag == "--min-events-per-s") lim.min_events_per_s = std::atof(value);
+        else {
+            std::cerr << "Unknown option: " << flag << "\n";
+            return 2;
+        }
+    }
+
+    // The full tier crosses every tenant count with the smallest and largest
+    // channel counts at 10^7 requests, then pushes the request count to 10^9
+    // at moderate fan-out. Explicit lists replace the tier's matrix.
+    std::vector<Case> cases;
+    auto add_matrix = [&](const std::vector<uint64_t>& ts, const std::vector<uint64_t>& rs,
+                          const std::vector<uint64_t>& cs) {
+        for (uint64_t r : rs)
+            for (uint64_t t : ts)
+                for (uint64_t ch : cs)
+                    for (const auto& p : policies)
+                        cases.push_back({ p, t, r, static_cast<int>(ch) });
+    };
+    if (!tenants.empty() || !requests.empty() || !channels.empty()) {
+        add_matrix(tenants.empty() ? std::vector<uint64_t>{ 1000 } : tenants,
+                   requests.empty() ? std::vector<uint64_t>{ 100000 } : requests,
+                   channels.empty() ? std::vector<uint64_t>{ 8 } : channels);
+    } else if (tier == "full") {
+        add_matrix({ 1000, 100000, 1000000 }, { 10000000 }, { 8, 4096 });
+        add_matrix({ 1000 }, { 100000000, 1000000000 }, { 512 });
+    } else {
+        add_matrix({ 1000, 10000 }, { 100000 }, { 8, 64 });
+    }
+
+    std::ofstream report(report_path);
+    if (!report) {
+        std::cerr << "Cannot write " << report_path << "\n";
+        return 2;
+    }
+    report << "{\n  \"tier\": \"" << tier << "\",\n  \"ceilings\": {"
+           << "\"max_wall_s\": " << lim.max_wall_s
+           << ", \"max_rss_mb\": " << lim.max_rss_mb
+           << ", \"max_allocs_per_request\": " << lim.max_allocs_per_request
+           << ", \"min_events_per_s\": " << lim.min_events_per_s << "},\n  \"cases\": [\n";
+
+    int failures = 0;
+    std::cout << "policy,tenants,requests,channels,wall_s,peak_rss_mb,allocs_per_request,"
+                 "events_per_s,l1d_miss_per_request,llc_miss_per_request,status\n";
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const Case& c = cases[i];
+        CaseResult r = run_isolated(c, lim.max_wall_s);
+        auto broken = violations(c, r, lim);
+        if (!broken.empty()) ++failures;
+
+        double eps = r.wall_s > 0.0 ? static_cast<double>(r.events) / r.wall_s : 0.0;
+        double apr = c.requests ? static_cast<double>(r.allocations) / static_cast<double>(c.requests) : 0.0;
+        auto per_request = [&](int64_t misses) {
+            return misses < 0 || c.requests == 0
+                ? std::string("n/a")
+                : std::to_string(static_cast<double>(misses) / static_cast<double>(c.requests));
+        };
+        std::string verdict = broken.empty() ? "ok" : "FAIL";
+        for (const auto& b : broken) verdict += ":" + b;
+
+        std::cout << c.policy << "," << c.tenants << "," << c.requests << "," << c.channels << ","
+                  << r.wall_s << "," << r.peak_rss_mb << "," << apr << "," << eps << ","
+                  << per_request(r.l1d_misses) << "," << per_request(r.llc_misses) << ","
+                  << verdict << std::endl;
+
+        report << "    {\"policy\": \"" << c.policy << "\", \"tenants\": " << c.tenants
+               << ", \"requests\": " << c.requests << ", \"channels\": " << c.channels
+               << ", \"wall_s\": " << r.wall_s << ", \"peak_rss_mb\": " << r.peak_rss_mb
+               << ", \"allocations\": " << r.allocations << ", \"events\": " << r.events
+               << ", \"events_per_s\": " << eps << ", \"fairness\": " << r.fairness
+               << ", \"l1d_misses\": " << counter_json(r.l1d_misses)
+               << ", \"llc_misses\": " << counter_json(r.llc_misses)
+               << ", \"violations\": [";
+        for (size_t b = 0; b < broken.size(); ++b)
+            report << (b ? ", " : "") << "\"" << broken[b] << "\"";
+        report << "]}" << (i + 1 < cases.size() ? "," : "") << "\n";
+        report.flush();
+    }
+    report << "  ],\n  \"failures\": " << failures << "\n}\n";
+
+    std::cout << failures << " of " << cases.size() << " cases exceeded a ceiling; report in "
+              << report_path << "\n";
+    return failures == 0 ? 0 : 1;
+}
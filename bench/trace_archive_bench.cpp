@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: MIT
+// Size and decode-speed benchmark for the columnar trace archive.
+//
+// Usage: trace-archive-bench [requests] [tenants] [path]
+
+#include "trace_archive.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The 24-byte fixed-width record the request-level binary traces use.
+constexpr double kFixedWidthBytes = 24.0;
+
+std::vector<Request> synthetic_trace(size_t n, int tenants) {
+    std::mt19937_64 rng(42);
+    std::exponential_distribution<double> gap(200000.0);  // ~200k IOPS
+    std::uniform_int_distribution<int> tenant(0, tenants - 1);
+    const uint32_t sizes[] = { 4096, 8192, 16384, 65536, 131072 };
+
+    std::vector<Request> trace(n);
+    double ts = 0.0;
+    int user = 0;
+    OpType op = OpType::READ;
+    uint32_t size = sizes[0];
+    uint64_t address = 0;
+    for (size_t i = 0; i < n; ++i) {
+        ts += gap(rng);
+        // Tenants issue short bursts, which is what real block traces look like.
+        if (rng() % 4 == 0) {
+            user = tenant(rng);
+            op = (rng() % 3 == 0) ? OpType::WRITE : OpType::READ;
+            size = sizes[rng() % 5];
+            address = (rng() % (1ull << 24)) * 4096;  // bursts are sequential runs
+        }
+        trace[i].user_id = user;
+        trace[i].op = op;
+        trace[i].arrival_ts = ts;
+        trace[i].size_bytes = size;
+        trace[i].address = address;
+        address += size;
+    }
+    return trace;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4'000'000;
+    int tenants = argc > 2 ? std::atoi(argv[2]) : 1000;
+    std::string path = argc > 3 ? argv[3] : "trace-archive-bench.ssdtrc";
+
+    auto trace = synthetic_trace(n, tenants);
+
+    auto t0 = std::chrono::steady_clock::now();
+    util::write_trace_archive(path, trace);
+    double encode_s = seconds_since(t0);
+
+    util::TraceArchiveReader reader(path);
+    double bytes_per_request = static_cast<double>(reader.file_bytes()) / static_cast<double>(n);
+
+    t0 = std::chrono::steady_clock::now();
+    auto serial = reader.read_all(1);
+    double decode1_s = seconds_since(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    auto parallel = reader.read_all(0);
+    double decodeN_s = seconds_since(t0);
+
+    double mid = trace[n / 2].arrival_ts;
+    t0 = std::chrono::steady_clock::now();
+    auto window = reader.read_range(mid, mid + 0.01, 1);
+    double seek_s = seconds_since(t0);
+
+    bool ok = serial.size() == n && parallel.size() == n;
+    for (size_t i = 0; ok && i < n; ++i)
+        ok = serial[i].user_id == trace[i].user_id && serial[i].size_bytes == trace[i].size_bytes &&
+             serial[i].op == trace[i].op && serial[i].address == trace[i].address;
+    std::remove(path.c_str());
+
+    double fixed_mb = kFixedWidthBytes * static_cast<double>(n) / 1e6;
+    std::cout << "requests," << n << "\n"
+              << "blocks," << reader.blocks().size() << "\n"
+              << "bytes_per_request," << bytes_per_request << "\n"
+              << "ratio_vs_fixed_width," << kFixedWidthBytes / bytes_per_request << "\n"
+              << "encode_mreq_per_s," << n / encode_s / 1e6 << "\n"
+              << "decode_1t_mreq_per_s," << n / decode1_s / 1e6 << "\n"
+              << "decode_1t_fixed_equiv_MBps," << fixed_mb / decode1_s << "\n"
+              << "decode_mt_fixed_equiv_MBps," << fixed_mb / decodeN_s << "\n"
+              << "window_seek_ms," << seek_s * 1e3 << " (" << window.size() << " requests)\n"
+              << "roundtrip," << (ok ? "ok" : "MISMATCH") << "\n";
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+// SPDX-License-Identifier: MIT
+// Fixed-point versus floating-point virtual-time tags for fair queueing.
+//
+// Usage: vtime-bench [requests] [flows]
+//
+// Reports the cost of computing an enqueue tag both ways, the cost of the
+// full WeightedFairScheduler enqueue against the previous double-based code,
+// and how many service decisions change when the same workload runs after a
+// long history (large tag values) or across a rebase.
+
+#include "scheduler_impl.hpp"
+#include "vtime.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// LegacyWfq is the enqueue path of the double-tagged scheduler this replaced,
+// including its bounds check and active-flow bookkeeping.
+class LegacyWfq {
+public:
+    explicit LegacyWfq(const std::vector<double>& weights)
+        : queues_(weights.size()), weights_(weights), last_finish_(weights.size(), 0.0) {}
+
+    void enqueue(const Request& r) {
+        if (r.user_id < 0 || r.user_id >= static_cast<int>(queues_.size()))
+            return;
+        double start_tag = std::max(last_finish_[r.user_id], virtual_time_);
+        double finish_tag = start_tag + static_cast<double>(r.size_bytes) / weights_[r.user_id];
+        last_finish_[r.user_id] = finish_tag;
+        bool was_empty = queues_[r.user_id].empty();
+        queues_[r.user_id].push_back({ r, finish_tag });
+        if (was_empty) ++active_flows_;
+    }
+
+    // drain pops front to back like dispatch does, so both queues see the
+    // same allocation pattern.
+    void drain() {
+        for (auto& q : queues_)
+            while (!q.empty()) q.pop_front();
+        active_flows_ = 0;
+    }
+
+private:
+    struct Tagged {
+        Request req;
+        double finish_tag;
+    };
+    std::vector<std::deque<Tagged>> queues_;
+    std::vector<double> weights_;
+    std::vector<double> last_finish_;
+    double virtual_time_ = 0.0;
+    int active_flows_ = 0;
+};
+
+// DoubleTags / FixedTags give service_order one interface over both tag types.
+struct DoubleTags {
+    using Tag = double;
+    std::vector<double> weights;
+    Tag offset(double bytes) const { return bytes; }
+    Tag cost(int uid, uint32_t size) const { return static_cast<double>(size) / weights[uid]; }
+    static Tag rebase(Tag tag, Tag) { return tag; }
+};
+
+struct FixedTags {
+    using Tag = ssd::VTag;
+    std::vector<ssd::ReciprocalWeight> weights;
+    Tag offset(double bytes) const {
+        return static_cast<Tag>(bytes * static_cast<double>(uint64_t{1} << ssd::kVTimeFracBits));
+    }
+    Tag cost(int uid, uint32_t size) const { return weights[uid].cost(size); }
+    static Tag rebase(Tag tag, Tag base) { return tag - base; }
+};
+
+// service_order serves |picks| requests from always-backlogged flows whose
+// tags start at |history_bytes| and returns the uid sequence. Sizes cycle
+// through a fixed pattern per flow so both tag types see the same workload.
+template <typename Tags>
+std::vector<int> service_order(const Tags& tags, size_t flows, size_t picks,
+                               double history_bytes, bool force_rebase) {
+    static const uint32_t kSizes[] = { 4096, 512, 16384, 4096, 131072, 8192, 4096 };
+    using Tag = typename Tags::Tag;
+    Tag start = tags.offset(history_bytes);
+    std::vector<Tag> head(flows);
+    std::vector<size_t> served(flows, 0);
+    for (size_t f = 0; f < flows; ++f)
+        head[f] = start + tags.cost(static_cast<int>(f), kSizes[f % 7]);
+
+    std::vector<int> order;
+    order.reserve(picks);
+    for (size_t p = 0; p < picks; ++p) {
+        size_t best = 0;
+        for (size_t f = 1; f < flows; ++f)
+            if (head[f] < head[best]) best = f;
+        order.push_back(static_cast<int>(best));
+        if (force_rebase && p == picks / 2) {
+            Tag base = head[best];
+            for (auto& h : head) h = Tags::rebase(h, base);
+        }
+        ++served[best];
+        head[best] += tags.cost(static_cast<int>(best), kSizes[(best + served[best]) % 7]);
+    }
+    return order;
+}
+
+size_t count_differences(const std::vector<int>& a, const std::vector<int>& b) {
+    size_t n = 0;
+    for (size_t i = 0; i < a.size() && i < b.size(); ++i) n += a[i] != b[i];
+    return n;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t requests = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20'000'000;
+    size_t flows = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+    if (flows == 0) flows = 1;
+
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> weight_dist(0.1, 10.0);
+    std::vector<double> weights(flows);
+    for (auto& w : weights) w = weight_dist(rng);
+    // Non-dyadic weights are the ones floating-point tags round on.
+    weights[0] = 1.0 / 3.0;
+    if (flows > 1) weights[1] = 0.3;
+
+    constexpr size_t kPattern = 1 << 16;
+    std::vector<uint32_t> sizes(kPattern);
+    std::vector<uint32_t> users(kPattern);
+    for (size_t i = 0; i < kPattern; ++i) {
+        sizes[i] = 512u << (rng() % 9);
+        users[i] = static_cast<uint32_t>(rng() % flows);
+    }
+
+    // ==== Tag arithmetic alone ====
+    std::vector<double> dtags(flows, 0.0);
+    double dvt = 0.0;
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        size_t k = i & (kPattern - 1);
+        double& tag = dtags[users[k]];
+        tag = std::max(tag, dvt) + static_cast<double>(sizes[k]) / weights[users[k]];
+        if ((i & 1023) == 0) dvt = tag;
+    }
+    double double_s = seconds_since(t0);
+
+    std::vector<ssd::ReciprocalWeight> recips;
+    for (double w : weights) recips.emplace_back(w);
+    std::vector<ssd::VTag> ftags(flows, 0);
+    ssd::VTag fvt = 0;
+    t0 = Clock::now();
+    for (size_t i = 0; i < requests; ++i) {
+        size_t k = i & (kPattern - 1);
+        ssd::VTag& tag = ftags[users[k]];
+        tag = std::max(tag, fvt) + recips[users[k]].cost(sizes[k]);
+        if ((i & 1023) == 0) fvt = tag;
+    }
+    double fixed_s = seconds_since(t0);
+    double sink = dvt + static_cast<double>(fvt);
+
+    double ns_double = double_s * 1e9 / static_cast<double>(requests);
+    double ns_fixed = fixed_s * 1e9 / static_cast<double>(requests);
+    std::cout << "Tag compute: double " << ns_double << " ns, fixed-point " << ns_fixed
+              << " ns, speedup " << ns_double / ns_fixed << "x\n";
+
+    // ==== Full scheduler enqueue, drained every batch to bound memory ====
+    constexpr size_t kBatch = 1 << 14;
+    size_t enqueue_requests = std::min<size_t>(requests, 4'000'000);
+    LegacyWfq legacy(weights);
+    ssd::WeightedFairScheduler wfq;
+    wfq.set_users(static_cast<int>(flows));
+    wfq.set_weights(weights);
+
+    // Alternate which side runs first so neither always inherits a warm cache.
+    double legacy_s = 0.0, wfq_s = 0.0;
+    auto run_legacy = [&](size_t base) {
+        Request r{};
+        auto b0 = Clock::now();
+        for (size_t i = base; i < base + kBatch; ++i) {
+            size_t k = i & (kPattern - 1);
+            r.user_id = static_cast<int>(users[k]);
+            r.size_bytes = sizes[k];
+            legacy.enqueue(r);
+        }
+        legacy_s += seconds_since(b0);
+        legacy.drain();
+    };
+    auto run_wfq = [&](size_t base) {
+        Request r{};
+        auto b0 = Clock::now();
+        for (size_t i = base; i < base + kBatch; ++i) {
+            size_t k = i & (kPattern - 1);
+            r.user_id = static_cast<int>(users[k]);
+            r.size_bytes = sizes[k];
+            wfq.enqueue(r);
+        }
+        wfq_s += seconds_since(b0);
+        while (auto uid = wfq.pick_user(0.0)) wfq.pop(*uid);
+    };
+    for (size_t base = 0; base < enqueue_requests; base += kBatch) {
+        if ((base / kBatch) % 2 == 0) {
+            run_legacy(base);
+            run_wfq(base);
+        } else {
+            run_wfq(base);
+            run_legacy(base);
+        }
+    }
+    double n = static_cast<double>(enqueue_requests);
+    std::cout << "Scheduler enqueue: double " << legacy_s * 1e9 / n << " ns, fixed-point "
+              << wfq_s * 1e9 / n << " ns, speedup " << legacy_s / wfq_s << "x\n";
+
+    // ==== Ordering stability ====
+    size_t picks = std::min<size_t>(requests, 2'000'000);
+    size_t order_flows = std::min<size_t>(flows, 16);
+    DoubleTags dt{ weights };
+    FixedTags ft{ recips };
+    const double kHistory = 1099511627776.0;  // 1 TiB of prior normalized service
+
+    auto d0 = service_order(dt, order_flows, picks, 0.0, false);
+    auto d1 = service_order(dt, order_flows, picks, kHistory, false);
+    auto f0 = service_order(ft, order_flows, picks, 0.0, false);
+    auto f1 = service_order(ft, order_flows, picks, kHistory, false);
+    auto f2 = service_order(ft, order_flows, picks, kHistory, true);
+    size_t double_changed = count_differences(d0, d1);
+    size_t fixed_changed = count_differences(f0, f1);
+    size_t rebase_changed = count_differences(f0, f2);
+
+    std::cout << "Ordering after 1 TiB of history (" << picks << " decisions, "
+              << order_flows << " flows): double changed " << double_changed
+              << ", fixed-point changed " << fixed_changed << ", across rebase "
+              << rebase_changed << "\n";
+    std::cout << "Fixed-point vs double decisions at time zero: "
+              << count_differences(d0, f0) << " differ\n";
+
+    if (sink < 0.0) std::cout << "";
+    return fixed_changed == 0 && rebase_changed == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "scheduler.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ssd {
+
+// Interference attribution: which neighbours make a tenant slow. A tenant's
+// latency in the shared run, minus its latency running alone, is split
+// among the other tenants by their Shapley values in the game whose value
+// for a coalition of neighbours is the tenant's latency when only it and
+// that coalition run. Coalitions come from sampled tenant orderings, and
+// each distinct subset is simulated once, keyed by its bitmask.
+
+// Measures attributed per tenant, in the order they are stored.
+enum class InterferenceMeasure : uint8_t {
+    MeanLatency = 0,
+    P99Latency = 1,
+    MeanSlowdown = 2,
+    P99Slowdown = 3,
+};
+constexpr size_t kInterferenceMeasures = 4;
+using MeasureValues = std::array<double, kInterferenceMeasures>;
+
+// AttributionOptions configures attribute_interference.
+struct AttributionOptions {
+    int permutations = 64;  // sampled tenant orderings; all of them when fewer exist
+    int threads = 0;        // coalitions simulated in parallel; <= 0: all cores
+    uint64_t seed = 1;
+    SimOptions sim;         // event-loop options for every coalition
+};
+
+// Attribution is the outcome of attribute_interference. Tenants are the
+// users with at least one request, at most 64 of them.
+struct Attribution {
+    std::vector<int> tenants;
+    std::vector<MeasureValues> alone;   // per tenant, running with no neighbours
+    std::vector<MeasureValues> shared;  // per tenant, running with every tenant
+    // shapley[v][j] is tenant j's share of shared[v] - alone[v] (both tenant
+    // indices). The shares over j != v add up to that difference.
+    std::vector<std::vector<MeasureValues>> shapley;
+    size_t permutations = 0;  // orderings evaluated
+    bool exact = false;       // every ordering was evaluated
+    size_t coalitions = 0;    // distinct subsets simulated
+    size_t lookups = 0;       // coalition values read, memo hits included
+    double wall_s = 0.0;
+};
+
+// attribute_interference simulates coalitions of |trace|'s tenants, each on
+// a fresh SSD built from |cfg| with a scheduler from |make_scheduler|. A
+// coalition replays only its members' requests, read in place from |trace|.
+// Throws std::invalid_argument for more than 64 tenants.
+Attribution attribute_interference(const std::vector<Request>& trace, int num_users,
+                                   const SimConfig& cfg,
+                                   const std::function<std::unique_ptr<Scheduler>()>& make_scheduler,
+                                   const std::vector<double>& weights,
+                                   const AttributionOptions& opts);
+
+} // namespace ssd
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace ssd {
+
+inline constexpr size_t kCacheLineBytes = 64;
+
+// CacheAlignedAllocator hands out storage that starts on a cache line and is
+// padded to a whole number of lines, so arrays owned by different threads
+// never share a line.
+template <typename T>
+struct CacheAlignedAllocator {
+    using value_type = T;
+
+    CacheAlignedAllocator() = default;
+    template <typename U>
+    CacheAlignedAllocator(const CacheAlignedAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + kCacheLineBytes - 1) / kCacheLineBytes * kCacheLineBytes;
+        return static_cast<T*>(::operator new(bytes, std::align_val_t(kCacheLineBytes)));
+    }
+    void deallocate(T* p, size_t) {
+        ::operator delete(p, std::align_val_t(kCacheLineBytes));
+    }
+
+    template <typename U>
+    bool operator==(const CacheAlignedAllocator<U>&) const { return true; }
+    template <typename U>
+    bool operator!=(const CacheAlignedAllocator<U>&) const { return false; }
+};
+
+// MetricsSnapshot is a merged, point-in-time view of ConcurrentMetrics.
+struct MetricsSnapshot {
+    static constexpr int kLatencyBuckets = 64;  // bucket b holds [2^b, 2^(b+1)) ns
+
+    std::vector<uint64_t> completed;
+    std::vector<uint64_t> latency_ns;
+    std::vector<uint64_t> bytes;
+    std::array<uint64_t, kLatencyBuckets> latency_histogram{};
+    uint64_t dropped = 0;  // completions for user IDs outside the configured range
+
+    double avg_latency(int user_id) const;
+    // latency_quantile returns the upper edge (seconds) of the bucket holding |q|.
+    double latency_quantile(double q) const;
+    // fairness_index returns Jain's metric over users that moved bytes.
+    double fairness_index() const;
+};
+
+// ConcurrentMetrics collects per-user counters and a latency histogram from
+// many completion threads. Each thread owns one shard and records into it
+// with plain load/store pairs (no read-modify-write atomics, no locks), so the
+// completion path never contends. Readers merge shards with relaxed loads at
+// any time; the snapshot is consistent per counter, not across counters.
+//
+// The user range is fixed at construction: unknown IDs are counted as dropped
+// instead of resizing storage underneath concurrent writers.
+class ConcurrentMetrics {
+public:
+    ConcurrentMetrics(int num_users, int num_shards);
+
+    // on_finish records |req| in |shard|. A shard must have a single writer.
+    // Throws std::out_of_range when |shard| is not in [0, num_shards()).
+    void on_finish(int shard, const Request& req);
+
+    // snapshot merges every shard; safe to call while writers are running.
+    MetricsSnapshot snapshot() const;
+
+    int num_users() const { return num_users_; }
+    int num_shards() const { return static_cast<int>(shards_.size()); }
+
+private:
+    using Counter = std::atomic<uint64_t>;
+
+    struct UserCounters {
+        Counter completed{0};
+        Counter latency_ns{0};
+        Counter bytes{0};
+    };
+
+    struct alignas(kCacheLineBytes) Shard {
+        explicit Shard(int num_users) : users(num_users) {}
+        std::vector<UserCounters, CacheAlignedAllocator<UserCounters>> users;
+        std::array<Counter, MetricsSnapshot::kLatencyBuckets> histogram{};
+        Counter dropped{0};
+    };
+
+    // bump is only called by the shard owner, so a relaxed load + store is a
+    // race-free increment that compiles to plain moves.
+    static void bump(Counter& c, uint64_t v) {
+        c.store(c.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    int num_users_;
+    std::vector<std::unique_ptr<Shard>> shards_;  // over-aligned new per shard
+};
+
+} // namespace ssd
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "dmclock.hpp"
+#include "metrics.hpp"
+#include "scheduler.hpp"
+#include "simulator.hpp"
+#include "ssd.hpp"
+#include "types.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ssd {
+
+// ArrayOptions describes a set of identical devices a trace is striped over.
+struct ArrayOptions {
+    int devices = 1;
+    uint64_t stripe_bytes = 128 * 1024;  // address range per stripe unit
+    // spread[u] is how many devices tenant u uses: devices [0, spread[u]).
+    // Missing or non-positive entries mean every device.
+    std::vector<int> spread;
+    // coordinate exchanges dmClock delta/rho between dmclock device
+    // schedulers; off, each device schedules on local state only.
+    bool coordinate = true;
+};
+
+// DeviceStats summarizes one device of the array.
+struct DeviceStats {
+    size_t completed = 0;
+    uint64_t bytes = 0;
+    uint64_t reserved_bytes = 0;   // served in a dmClock reservation phase
+    std::vector<uint64_t> user_bytes;
+};
+
+// ArraySimulator replays a trace over several devices, each with its own
+// scheduler and event loop, all recording into one Metrics. A request goes to
+// device (address / stripe_bytes) % spread of its tenant. The per-device loops
+// step together from event to event, so a decision on one device sees every
+// earlier completion on the others. When the device schedulers are plain
+// dmclock, the array plays the tenants' part: it counts completions in a
+// DmClockTracker that the schedulers read delta/rho from.
+class ArraySimulator {
+public:
+    using SchedulerFactory = std::function<std::unique_ptr<Scheduler>()>;
+
+    ArraySimulator(const ArrayOptions& opts, const SimConfig& device_cfg,
+                   const SchedulerFactory& make_scheduler, int num_users,
+                   const std::vector<double>& weights, Metrics& metrics,
+                   const SimOptions& sim_opts = {});
+
+    // run replays |trace| (sorted by arrival) until every request completes.
+    void run(const std::vector<Request>& trace);
+
+    // set_completion_hook registers |hook| to observe every completion after
+    // Metrics has recorded it.
+    void set_completion_hook(std::function<void(const Request&)> hook) {
+        completion_hook_ = std::move(hook);
+    }
+
+    // coordinated reports whether dmClock counters are being exchanged.
+    bool coordinated() const { return tracker_ != nullptr; }
+    int device_of(const Request& r) const;
+    int spread(int user) const;
+
+    const std::vector<DeviceStats>& device_stats() const { return stats_; }
+    // end_time is the simulated time of the last completion on any device.
+    double end_time() const;
+
+private:
+    // sync_to steps every device through the events before |t| in time order,
+    // then moves them all to |t| (unless infinite).
+    void sync_to(double t);
+
+    struct Device {
+        std::unique_ptr<SSD> ssd;
+        std::unique_ptr<Scheduler> scheduler;
+        std::unique_ptr<Simulator> sim;
+    };
+
+    ArrayOptions opts_;
+    int num_users_;
+    std::vector<Device> devices_;
+    std::vector<DeviceStats> stats_;
+    std::unique_ptr<DmClockTracker> tracker_;
+    std::function<void(const Request&)> completion_hook_;
+    double now_ = 0.0;
+};
+
+} // namespace ssd
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "scheduler_impl.hpp"
+#include "tenant_state.hpp"
+#include "types.hpp"
+#include "vtime.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace ssd {
+
+// dmClock (Gulati et al., OSDI'10) gives each tenant a reservation (a rate
+// floor), a weight and a limit (a rate cap) that hold across several
+// independently scheduled devices. Each device runs mClock on its own, tagging
+// requests with reservation (R), proportional (P) and limit (L) tags. The only
+// coordination is two counters the tenant piggybacks on every request: delta,
+// the bytes its other devices completed since its previous request to this
+// one, and rho, the part of delta served in the reservation phase. A device
+// advances the tenant's tags by that remote service as well as its own, so
+// global reservations and shares hold without any shared scheduler state.
+
+class DmClockTracker;
+
+// DmClockScheduler is the per-device mClock policy. Reservations and limits
+// come from SchedulerOptions in MB/s per tenant (0 disables either), weights
+// from set_weights. Dispatch first serves the smallest R tag that is due
+// (reservation phase), otherwise the smallest P tag among tenants under
+// their limit (weight phase). Requests served in the reservation phase are
+// marked with Request::qos_reserved so the tenant can report them as rho.
+//
+// Only the head of each tenant's queue is tagged, when it gets there. In
+// dmClock a client keeps few requests outstanding per server and queues the
+// rest itself, so a request reaches the server shortly before its service.
+// Here the device queue holds that backlog too, and reaching the head stands
+// in for being sent: it is when the tags are computed and, with a tracker
+// attached, when delta/rho are read.
+//
+// Tags are fixed-point like the other virtual-time policies (vtime.hpp): R
+// and L count simulated time in units of 2^-kVTimeFracBits us, P weighted
+// bytes. Rates and weights are kept as reciprocals, so tagging is a multiply
+// and a shift per tag.
+class DmClockScheduler final : public Scheduler {
+    struct Tags {
+        VTag r = 0;
+        VTag p = 0;
+        VTag l = 0;
+    };
+
+    // Hot holds what pick_user reads. Tenants without a reservation (limit)
+    // have R = kNever (L = 0).
+    struct Hot {
+        Tags head;                      // tags of the queued head
+        uint32_t head_idx = kNilIndex;  // kNilIndex when the tenant is idle
+        uint32_t tail_idx = kNilIndex;
+    };
+
+    struct Cold {
+        bool reserves = false;
+        bool limited = false;
+        ReciprocalWeight weight;       // P tag per byte
+        ReciprocalWeight reservation;  // R tag per byte
+        ReciprocalWeight limit;        // L tag per byte
+        Tags last;                  // tags of the latest head
+        uint64_t enqueued = 0;
+        uint64_t served_bytes = 0;
+        uint64_t reserved_bytes = 0;
+    };
+
+    std::vector<Hot> hot_;
+    std::vector<Cold> cold_;
+    RequestPool pool_;
+    std::vector<double> reservations_MBps_;
+    std::vector<double> limits_MBps_;
+    size_t backlog_ = 0;
+    VTag vtime_ = 0;               // P tag of the last weight-phase dispatch
+    DmClockTracker* tracker_ = nullptr;
+    int device_ = 0;
+    int picked_ = -1;              // tenant chosen by the last pick_user
+    bool picked_reserved_ = false;
+
+    void refresh_rates();
+    void tag_head(int uid);
+    void rebase();
+
+public:
+    explicit DmClockScheduler(const SchedulerOptions& opts = {});
+
+    void set_users(int n) override;
+    void set_weights(const std::vector<double>& w) override;
+    void enqueue(const Request& r) override;
+    std::optional<int> pick_user(double now) override;
+    std::optional<Request> pop(int uid) override;
+    bool empty() const override { return backlog_ == 0; }
+    double next_wakeup(double now) const override;
+
+    // coordinate makes this scheduler |device| of an array whose tenants'
+    // completions |tracker| counts. Without it, tags reflect local service
+    // only, as in plain mClock.
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        tracker_ = tracker;
+        device_ = device;
+        return true;
+    }
+
+    uint64_t served_bytes(int user) const { return cold_[user].served_bytes; }
+    uint64_t reserved_bytes(int user) const { return cold_[user].reserved_bytes; }
+};
+
+// DmClockTracker is the tenants' side of dmClock: it counts the bytes each
+// tenant has had completed on every device and produces the delta/rho pair to
+// send with the tenant's next request to a device. State is per tenant and
+// per (tenant, device) pair, both operations are O(1), and a tenant's
+// counters are only touched by that tenant's own requests, so a distributed
+// implementation keeps them at the client with no lock shared across tenants
+// or devices.
+class DmClockTracker {
+public:
+    DmClockTracker(int tenants, int devices);
+
+    // on_complete counts |r|'s bytes as served by |device|.
+    void on_complete(int device, const Request& r);
+
+    // next returns (delta, rho) for |user|'s next request to |device|: bytes
+    // the other devices completed for |user| since its previous request to
+    // |device|, in total and in their reservation phase.
+    std::pair<uint64_t, uint64_t> next(int device, int user);
+
+private:
+    struct Counters {
+        uint64_t done = 0;
+        uint64_t reserved = 0;
+    };
+    // Link is one (tenant, device) pair: what the device completed, and the
+    // global and local counters as of the tenant's last request to it.
+    struct Link {
+        Counters local;
+        Counters seen_global;
+        Counters seen_local;
+    };
+
+    int devices_;
+    std::vector<Counters> global_;  // per tenant
+    std::vector<Link> links_;       // tenant * devices_ + device
+};
+
+} // namespace ssd
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ftl.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace ssd {
+
+// EnduranceThrottleScheduler enforces a per-tenant flash endurance budget on
+// top of any fairness policy. The device's rated DWPD is split across tenants
+// by weight; each write is charged its size times the tenant's observed write
+// amplification, and a tenant that has used up its share is held back until
+// the budget refills. Reads always pass straight through.
+class EnduranceThrottleScheduler : public Scheduler {
+    std::unique_ptr<Scheduler> base_;
+    const Ftl* ftl_;                 // source of per-tenant WAF (may be null)
+    double budget_bytes_per_s_;      // physical bytes/s the device may absorb
+    double burst_s_;                 // budget available up front, in seconds
+    std::vector<double> share_;      // normalized weights
+    std::vector<double> charged_;    // physical bytes charged so far
+    std::vector<double> held_s_;     // total time writes spent held back
+    std::vector<std::deque<Request>> parked_;
+    size_t parked_count_ = 0;
+
+    // eligible_at is when |uid|'s accrued budget catches up with its charges.
+    double eligible_at(size_t uid) const {
+        double rate = share_[uid] * budget_bytes_per_s_;
+        if (rate <= 0.0) return std::numeric_limits<double>::infinity();
+        return charged_[uid] / rate - burst_s_;
+    }
+
+    // release moves parked writes of tenants still within budget into the
+    // base policy. A write is admitted while the tenant is within budget, so
+    // the overshoot is bounded by one request.
+    void release(double now) {
+        if (parked_count_ == 0) return;
+        for (size_t uid = 0; uid < parked_.size(); ++uid) {
+            auto& q = parked_[uid];
+            while (!q.empty() && eligible_at(uid) <= now) {
+                double waf = ftl_ ? ftl_->tenant_waf(static_cast<int>(uid)) : 1.0;
+                charged_[uid] += static_cast<double>(q.front().size_bytes) * waf;
+                held_s_[uid] += std::max(0.0, now - q.front().arrival_ts);
+                base_->enqueue(q.front());
+                q.pop_front();
+                --parked_count_;
+            }
+        }
+    }
+
+public:
+    // |dwpd| and |logical_bytes| define the device budget; |burst_s| seconds
+    // of it are granted at time zero so short traces aren't throttled at once.
+    EnduranceThrottleScheduler(std::unique_ptr<Scheduler> base, const Ftl* ftl,
+                               double dwpd, double logical_bytes, double burst_s = 1.0)
+        : base_(std::move(base)), ftl_(ftl),
+          budget_bytes_per_s_(std::max(dwpd, 0.0) * logical_bytes / 86400.0),
+          burst_s_(std::max(burst_s, 0.0)) {}
+
+    void set_users(int n) override {
+        n = std::max(n, 0);
+        base_->set_users(n);
+        share_.assign(n, n > 0 ? 1.0 / n : 0.0);
+        charged_.assign(n, 0.0);
+        held_s_.assign(n, 0.0);
+        parked_.assign(n, {});
+        parked_count_ = 0;
+    }
+
+    void set_weights(const std::vector<double>& w) override {
+        base_->set_weights(w);
+        double total = 0.0;
+        for (size_t i = 0; i < share_.size(); ++i)
+            total += i < w.size() && w[i] > 0.0 ? w[i] : 1.0;
+        for (size_t i = 0; i < share_.size(); ++i)
+            share_[i] = (i < w.size() && w[i] > 0.0 ? w[i] : 1.0) / total;
+    }
+
+    void set_quantum(double q) override {
+        base_->set_quantum(q);
+    }
+
+    void enqueue(const Request& r) override {
+        if (r.op != OpType::WRITE || r.user_id < 0 ||
+            r.user_id >= static_cast<int>(parked_.size())) {
+            base_->enqueue(r);
+            return;
+        }
+        parked_[r.user_id].push_back(r);
+        ++parked_count_;
+        release(r.arrival_ts);
+    }
+
+    std::optional<int> pick_user(double now) override {
+        release(now);
+        return base_->pick_user(now);
+    }
+
+    std::optional<Request> pop(int uid) override {
+        return base_->pop(uid);
+    }
+
+    bool empty() const override {
+        return parked_count_ == 0 && base_->empty();
+    }
+
+    // next_wakeup is the earliest time a held tenant regains budget. Tenants
+    // already back under budget are released by the next pick_user.
+    double next_wakeup(double now) const override {
+        double next = base_->next_wakeup(now);
+        for (size_t uid = 0; parked_count_ > 0 && uid < parked_.size(); ++uid) {
+            if (parked_[uid].empty()) continue;
+            double t = eligible_at(uid);
+            if (t > now) next = std::min(next, t);
+        }
+        return next;
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        return base_->coordinate(tracker, device);
+    }
+
+    // charged_bytes returns the physical bytes charged to |uid|.
+    double charged_bytes(int uid) const {
+        return uid >= 0 && uid < static_cast<int>(charged_.size()) ? charged_[uid] : 0.0;
+    }
+    // held_s returns the total time |uid|'s writes waited for budget.
+    double held_s(int uid) const {
+        return uid >= 0 && uid < static_cast<int>(held_s_.size()) ? held_s_[uid] : 0.0;
+    }
+};
+
+} // namespace ssd
@@ -2,7 +2,8 @@
 
 #include "types.hpp"
 
-#include <queue>
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 
 namespace ssd {
@@ -14,9 +15,12 @@ struct Event {
     Request request;  // Copy of the request carrying runtime metadata.
 };
 
+// EventCompare orders by time, then channel. A channel has at most one
+// request in flight, so the order is total and independent of heap shape.
 struct EventCompare {
     bool operator()(const Event& a, const Event& b) const {
-        return a.time > b.time; // min-heap on time
+        if (a.time != b.time) return a.time > b.time; // min-heap on time
+        return a.channel > b.channel;
     }
 };
 
@@ -24,23 +28,40 @@ struct EventCompare {
 class EventQueue {
 public:
     // Push inserts a new completion event into the queue.
-    void push(const Event& ev) { queue_.push(ev); }
+    void push(const Event& ev) {
+        heap_.push_back(ev);
+        std::push_heap(heap_.begin(), heap_.end(), EventCompare());
+    }
+
+    // push_batch inserts |n| events. A batch at least as large as the heap is
+    // appended and re-heapified in linear time instead of sifted one by one.
+    void push_batch(const Event* evs, size_t n) {
+        size_t old = heap_.size();
+        heap_.insert(heap_.end(), evs, evs + n);
+        if (n >= old) {
+            std::make_heap(heap_.begin(), heap_.end(), EventCompare());
+            return;
+        }
+        for (size_t i = old + 1; i <= heap_.size(); ++i)
+            std::push_heap(heap_.begin(), heap_.begin() + i, EventCompare());
+    }
 
     // empty returns true when no events are pending.
-    bool empty() const { return queue_.empty(); }
+    bool empty() const { return heap_.empty(); }
 
     // top returns a const reference to the earliest event.
-    const Event& top() const { return queue_.top(); }
+    const Event& top() const { return heap_.front(); }
 
     // pop removes and returns the earliest event.
     Event pop() {
-        auto ev = queue_.top();
-        queue_.pop();
+        std::pop_heap(heap_.begin(), heap_.end(), EventCompare());
+        Event ev = heap_.back();
+        heap_.pop_back();
         return ev;
     }
 
 private:
-    std::priority_queue<Event, std::vector<Event>, EventCompare> queue_;
+    std::vector<Event> heap_;
 };
 
 } // namespace ssd
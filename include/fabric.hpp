@@ -0,0 +1,102 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "scheduler.hpp"
+#include "ssd.hpp"
+#include "types.hpp"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace ssd {
+
+// FabricConfig describes an NVMe-over-Fabrics front end shared by several hosts.
+struct FabricConfig {
+    int num_hosts = 1;
+    int queue_depth = 32;               // outstanding commands per connection
+    double link_MBps = 3000.0;          // per-host link bandwidth, each direction
+    double capsule_overhead_s = 15e-6;  // per-capsule processing + propagation
+    uint32_t capsule_bytes = 64;        // command/response capsule size on the wire
+    std::string arbitration = "rr";     // target queue arbitration: rr or fifo
+};
+
+// fabric_preset returns a FabricConfig for "tcp" or "rdma"; other names fall
+// back to the default (TCP-like) values.
+FabricConfig fabric_preset(const std::string& transport);
+
+// HostFabricStats summarizes where a host's commands spent their time.
+struct HostFabricStats {
+    size_t completed = 0;
+    double link_s = 0.0;          // capsule + data transfer, both directions
+    double target_wait_s = 0.0;   // time queued at the target before the SSD
+    double device_s = 0.0;        // time on an SSD channel
+    int max_inflight = 0;         // peak connection occupancy
+};
+
+// FabricSimulator drives several host schedulers that share one SSD target
+// through per-host fabric connections. Tenants are pinned to host
+// user_id % num_hosts. Everything is simulated in-process.
+class FabricSimulator {
+public:
+    using SchedulerFactory = std::function<std::unique_ptr<Scheduler>()>;
+
+    FabricSimulator(const FabricConfig& cfg, const SchedulerFactory& make_scheduler,
+                    int num_users, const std::vector<double>& weights,
+                    SSD& device, Metrics& metrics);
+
+    // run replays |trace| (sorted by arrival) until every request completes.
+    void run(const std::vector<Request>& trace);
+
+    const std::vector<HostFabricStats>& host_stats() const { return stats_; }
+
+private:
+    enum class EventKind : uint8_t { TargetArrival, DeviceComplete, HostComplete };
+
+    struct FabricEvent {
+        double time;
+        EventKind kind;
+        int host;
+        Request request;
+        double stamp;  // kind-specific timestamp carried between stages
+    };
+
+    struct FabricEventCompare {
+        bool operator()(const FabricEvent& a, const FabricEvent& b) const {
+            return a.time > b.time;
+        }
+    };
+
+    struct PendingCommand {
+        Request request;
+        double arrived_at;  // when the capsule reached the target
+    };
+
+    struct Host {
+        std::unique_ptr<Scheduler> scheduler;
+        int inflight = 0;
+        double tx_free_at = 0.0;  // host -> target link
+        double rx_free_at = 0.0;  // target -> host link
+        std::deque<PendingCommand> target_queue;
+    };
+
+    int host_of(int user_id) const;
+    double wire_time(uint32_t payload_bytes) const;
+    void dispatch_hosts(double now);
+    void dispatch_target(double now);
+    void handle(const FabricEvent& ev);
+
+    FabricConfig cfg_;
+    double link_s_per_byte_ = 0.0;
+    SSD& device_;
+    Metrics& metrics_;
+    std::vector<Host> hosts_;
+    std::vector<HostFabricStats> stats_;
+    int next_target_host_ = 0;
+    std::priority_queue<FabricEvent, std::vector<FabricEvent>, FabricEventCompare> events_;
+};
+
+} // namespace ssd
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ssd {
+
+// FtlWork reports background flash operations triggered by one host write.
+struct FtlWork {
+    uint32_t host_pages = 0;  // pages programmed for the host data itself
+    uint32_t gc_copies = 0;   // valid pages relocated by garbage collection
+    uint32_t wl_copies = 0;   // pages relocated by static wear leveling
+    uint32_t erases = 0;      // blocks erased
+};
+
+// TenantWear attributes physical page programs to the tenant owning the data.
+struct TenantWear {
+    uint64_t host_pages = 0;
+    uint64_t gc_pages = 0;
+    uint64_t wl_pages = 0;
+
+    uint64_t physical_pages() const { return host_pages + gc_pages + wl_pages; }
+};
+
+// NamespaceStats attributes flash work to one namespace. The triggered_*
+// counters cover GC and wear-leveling work that the namespace's writes paid
+// for, whoever owned the data; foreign_copies is the part that relocated other
+// namespaces' pages, which only happens when namespaces share blocks.
+struct NamespaceStats {
+    uint64_t host_pages = 0;
+    uint64_t relocated_pages = 0;   // this namespace's pages copied by GC/WL
+    uint64_t triggered_copies = 0;
+    uint64_t foreign_copies = 0;
+    uint64_t triggered_erases = 0;
+};
+
+// Ftl is a page-mapped flash translation layer with greedy or FIFO garbage
+// collection, per-block erase counters, and optional dynamic/static wear
+// leveling. Host and relocation traffic use separate write streams so hot and
+// cold data don't share blocks.
+//
+// The logical space is split into namespaces laid out back to back in one
+// mapping table. Blocks form either one pool shared by every namespace or one
+// pool per namespace (FtlConfig::partition_blocks); each pool has its own free
+// list, GC buckets and open blocks, and GC never crosses pools. A namespace
+// is a few dozen bytes and a pool a couple of KiB (one bucket head per
+// valid-page count plus its queues), so 64 partitioned namespaces add a small
+// fraction of a MiB next to the per-page tables of a large drive.
+class Ftl {
+public:
+    // The device starts empty, or in the state cfg.snapshot_path holds, or
+    // preconditioned as cfg.precondition asks.
+    Ftl(const FtlConfig& cfg, int num_users);
+
+    // precondition replaces the mapping with the steady state that long-run
+    // |pattern| writes over |fill| of the logical space would leave, built
+    // directly in O(blocks + pages) without simulating a write. Sequential
+    // leaves blocks fully valid or fully stale; Random spreads valid counts
+    // the way greedy GC under uniform random writes does (see ftl.cpp). Erase
+    // counts and wear statistics are kept, so the run measures only itself.
+    void precondition(Precondition pattern, double fill, uint64_t seed);
+
+    // save_snapshot writes the mapping, block states and erase counts to
+    // |path|; load_snapshot restores them into an FTL of the same geometry.
+    // Wear statistics aren't part of a snapshot. Both throw runtime_error.
+    void save_snapshot(const std::string& path) const;
+    void load_snapshot(const std::string& path);
+
+    // write maps |bytes| at |address| (wrapped into namespace |nsid|) for
+    // |user_id| and returns the flash work it caused.
+    FtlWork write(int user_id, uint64_t address, uint32_t bytes, uint16_t nsid = 0);
+
+    // background_time_s converts |work| (beyond the host pages themselves) into
+    // channel time using the configured page/erase latencies.
+    double background_time_s(const FtlWork& work) const;
+
+    // namespace_of returns the namespace |user_id|'s requests address.
+    uint16_t namespace_of(int user_id) const;
+    int num_namespaces() const { return static_cast<int>(namespaces_.size()); }
+    int num_pools() const { return static_cast<int>(pools_.size()); }
+    uint64_t namespace_logical_pages(int ns) const { return namespaces_[ns].logical_pages; }
+    // namespace_pool returns the block pool |ns| allocates from.
+    int namespace_pool(int ns) const { return namespaces_[ns].pool; }
+    // pool_blocks returns how many blocks pool |pool| owns.
+    uint32_t pool_blocks(int pool) const { return pools_[pool].num_blocks; }
+    const NamespaceStats& namespace_stats(int ns) const { return namespaces_[ns].stats; }
+
+    uint64_t logical_pages() const { return logical_pages_; }
+    uint32_t num_blocks() const { return static_cast<uint32_t>(blocks_.size()); }
+    uint64_t logical_bytes() const { return logical_pages_ * cfg_.page_bytes; }
+    const FtlConfig& config() const { return cfg_; }
+
+    const std::vector<TenantWear>& tenant_wear() const { return wear_; }
+    // tenant_physical_bytes returns bytes programmed on behalf of |user_id|.
+    uint64_t tenant_physical_bytes(int user_id) const;
+    // tenant_waf returns physical / host pages for |user_id| (1.0 when idle).
+    double tenant_waf(int user_id) const;
+
+    uint64_t host_pages() const { return host_pages_; }
+    uint64_t physical_pages() const { return host_pages_ + gc_pages_ + wl_pages_; }
+    uint64_t total_erases() const { return total_erases_; }
+    uint32_t min_erase_count() const;
+    uint32_t max_erase_count() const;
+    double mean_erase_count() const;
+
+    // projected_lifetime_s extrapolates how long the device lasts at the wear
+    // rate observed over |elapsed_s| seconds, limited by the most-worn block.
+    double projected_lifetime_s(double elapsed_s) const;
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    enum class BlockState : uint8_t { Free, Open, Sealed };
+
+    struct Block {
+        uint32_t valid = 0;
+        uint32_t erase_count = 0;
+        uint32_t write_ptr = 0;
+        uint32_t prev = kNone;  // sealed-block bucket links (by valid count)
+        uint32_t next = kNone;
+        BlockState state = BlockState::Free;
+        uint16_t pool = 0;
+    };
+    static_assert(sizeof(Block) == 24, "pool index should fit the block's padding");
+
+    enum Stream { kHostStream = 0, kRelocStream = 1 };
+
+    // Pool is a contiguous range of blocks holding a contiguous range of
+    // logical pages (one namespace, or all of them when blocks are shared).
+    struct Pool {
+        uint32_t first_block = 0;
+        uint32_t num_blocks = 0;
+        uint64_t first_lpn = 0;
+        uint64_t logical_pages = 0;
+        uint32_t active[2] = { kNone, kNone };
+        std::vector<uint32_t> buckets;  // head of sealed blocks per valid count
+        uint32_t min_bucket = 0;        // lower bound on the lowest non-empty bucket
+        // Free blocks: FIFO without wear leveling, otherwise least-worn first.
+        std::deque<uint32_t> free_fifo;
+        std::priority_queue<std::pair<uint32_t, uint32_t>,
+                            std::vector<std::pair<uint32_t, uint32_t>>,
+                            std::greater<>> free_by_wear;
+        size_t free_count = 0;
+        // Sealed blocks in seal order as (block, erase count), kept only when
+        // a namespace on the pool uses FIFO GC. Entries whose block has been
+        // erased since are skipped.
+        bool track_seal_order = false;
+        std::deque<std::pair<uint32_t, uint32_t>> sealed;
+    };
+
+    struct Namespace {
+        uint64_t first_lpn = 0;
+        uint64_t logical_pages = 0;
+        uint16_t pool = 0;
+        GcPolicy gc = GcPolicy::Greedy;
+        NamespaceStats stats;
+    };
+
+    void layout(uint64_t num_blocks);
+    void precondition_pool(Pool& pool, Precondition pattern, double fill, std::mt19937_64& rng);
+    uint16_t namespace_of_lpn(uint32_t lpn) const;
+    uint32_t program(uint32_t lpn, Pool& pool, Stream stream, FtlWork& work);
+    void invalidate(uint32_t ppn);
+    void open_block(Pool& pool, Stream stream, FtlWork& work);
+    void seal(uint32_t block);
+    uint32_t take_free_block(Pool& pool);
+    void release_block(uint32_t block);
+    bool collect(Pool& pool, FtlWork& work);
+    uint32_t oldest_sealed(Pool& pool);
+    void relocate(uint32_t block, bool for_wear_leveling, FtlWork& work);
+    void maybe_static_wear_level(Pool& pool, FtlWork& work);
+    void rebuild_from_mapping();
+    void bucket_insert(uint32_t block);
+    void bucket_remove(uint32_t block);
+    TenantWear& wear_for(int user_id);
+
+    FtlConfig cfg_;
+    uint64_t logical_pages_ = 0;
+    std::vector<uint32_t> l2p_;    // logical page -> physical page
+    std::vector<uint32_t> p2l_;    // physical page -> logical page (kNone if invalid)
+    std::vector<int32_t> owner_;   // logical page -> tenant that last wrote it
+    std::vector<Block> blocks_;
+    std::vector<Pool> pools_;
+    std::vector<Namespace> namespaces_;
+    uint16_t writer_ns_ = 0;       // namespace of the write being served
+    bool in_gc_ = false;
+
+    std::vector<TenantWear> wear_;
+    TenantWear unowned_;  // relocations of pages with no recorded owner
+    uint64_t host_pages_ = 0;
+    uint64_t gc_pages_ = 0;
+    uint64_t wl_pages_ = 0;
+    uint64_t total_erases_ = 0;
+    uint32_t max_erase_ = 0;
+    uint64_t erases_since_wl_check_ = 0;
+};
+
+} // namespace ssd
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ssd {
+
+// SpaceSaving keeps the k heaviest keys of a weighted stream (Metwally et
+// al.). A monitored key adds its weight; an unmonitored one takes over the
+// lightest slot and inherits that slot's count as its error. Every key whose
+// weight exceeds total / k is monitored, and count - error <= true weight <=
+// count. Slots are kept in an indexed min-heap: a hit is a hash lookup plus
+// a sift toward the leaves, which stops at once for all but the lightest
+// slots.
+class SpaceSaving {
+public:
+    struct Slot {
+        int key = -1;
+        double count = 0.0;
+        double error = 0.0;  // weight possibly belonging to earlier keys
+    };
+    // AddResult tells the caller which slot |key| is in and whether it just
+    // took the slot over (so per-slot side data should be reset).
+    struct AddResult {
+        uint32_t slot;
+        bool replaced;
+    };
+
+    explicit SpaceSaving(size_t k = 0);
+
+    AddResult add(int key, double weight);
+
+    size_t capacity() const { return capacity_; }
+    size_t size() const { return slots_.size(); }
+    const Slot& slot(uint32_t i) const { return slots_[i]; }
+    // find returns |key|'s slot, or -1 when it isn't monitored.
+    int64_t find(int key) const;
+    // ranked returns slot indices, heaviest first.
+    std::vector<uint32_t> ranked() const;
+    double total() const { return total_; }
+
+private:
+    void sift_down(uint32_t pos);
+    void sift_up(uint32_t pos);
+    void swap_heap(uint32_t a, uint32_t b);
+
+    size_t capacity_;
+    std::vector<Slot> slots_;
+    std::vector<uint32_t> heap_;      // slot indices, lightest at the root
+    std::vector<uint32_t> heap_pos_;  // slot index -> heap position
+    std::unordered_map<int, uint32_t> index_;
+    double total_ = 0.0;
+};
+
+// CountMinSketch estimates per-key sums in width x depth counters. Updates
+// are conservative (only the minimal counters grow), so an estimate never
+// undercounts and overcounts by at most e / width of the stream total with
+// probability 1 - exp(-depth).
+class CountMinSketch {
+public:
+    CountMinSketch(size_t width = 0, size_t depth = 0, uint64_t seed = 1);
+
+    void add(int key, uint64_t amount);
+    uint64_t estimate(int key) const;
+
+    size_t width() const { return width_; }
+    size_t depth() const { return depth_; }
+    uint64_t total() const { return total_; }
+    // error_bound is the overcount that holds with probability 1 - exp(-depth).
+    double error_bound() const;
+
+private:
+    size_t cell(size_t row, int key) const;
+
+    size_t width_, depth_;
+    std::vector<uint64_t> counts_;  // depth rows of width counters
+    std::vector<uint64_t> salts_;   // per-row hash multipliers
+    uint64_t total_ = 0;
+};
+
+// TopKOptions sizes a HeavyHitterTracker.
+struct TopKOptions {
+    size_t k = 100;             // heavy tenants per ranking
+    size_t sketch_width = 1 << 16;
+    size_t sketch_depth = 4;
+    size_t distinct_bits = 1 << 20;  // linear-counting bitmap for the tenant count
+    uint64_t seed = 1;
+};
+
+// Rankings kept by HeavyHitterTracker.
+enum class TopKBasis : uint8_t {
+    Bytes = 0,
+    Requests = 1,
+    Load = 2,  // summed response time: the tenant's share of queue occupancy
+};
+constexpr size_t kTopKBases = 3;
+
+// TenantSummary holds exact statistics of a tenant since it took its slot.
+struct TenantSummary {
+    uint64_t requests = 0;
+    uint64_t bytes = 0;
+    double latency_sum_s = 0.0;
+    LogHistogram latency_ns;
+};
+
+// HeavyHitterTracker summarizes completions in memory independent of the
+// number of tenants: a Space-Saving table per basis with exact statistics
+// for every monitored tenant, Count-Min sketches of requests, bytes and
+// response time for point queries on any tenant, and aggregates for the
+// tenants outside the byte ranking (the tail). Each completion costs O(1)
+// hash and sketch updates plus the heap sifts described above.
+class HeavyHitterTracker {
+public:
+    explicit HeavyHitterTracker(const TopKOptions& opts = {});
+
+    void on_finish(const Request& r);
+
+    const SpaceSaving& ranking(TopKBasis basis) const {
+        return rankings_[static_cast<size_t>(basis)];
+    }
+    const TenantSummary& summary(TopKBasis basis, uint32_t slot) const {
+        return summaries_[static_cast<size_t>(basis)][slot];
+    }
+    const CountMinSketch& requests_sketch() const { return sk_requests_; }
+    const CountMinSketch& bytes_sketch() const { return sk_bytes_; }
+    const CountMinSketch& latency_sketch() const { return sk_latency_ns_; }
+
+    // distinct_tenants estimates how many tenants completed a request.
+    double distinct_tenants() const;
+    uint64_t requests() const { return requests_; }
+    uint64_t bytes() const { return bytes_; }
+    // Completions of tenants not in the full byte ranking when they finished.
+    uint64_t tail_requests() const { return tail_requests_; }
+    uint64_t tail_bytes() const { return tail_bytes_; }
+    double tail_latency_sum_s() const { return tail_latency_s_; }
+    const LogHistogram& tail_latency_ns() const { return tail_latency_ns_; }
+    const LogHistogram& latency_ns() const { return latency_ns_; }
+
+    // write_csv writes every ranking and the tail summary to |path|.
+    bool write_csv(const std::string& path) const;
+
+private:
+    TopKOptions opts_;
+    std::array<SpaceSaving, kTopKBases> rankings_;
+    std::array<std::vector<TenantSummary>, kTopKBases> summaries_;
+    CountMinSketch sk_requests_, sk_bytes_, sk_latency_ns_;
+    std::vector<uint64_t> distinct_;  // linear-counting bitmap
+    uint64_t requests_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t tail_requests_ = 0;
+    uint64_t tail_bytes_ = 0;
+    double tail_latency_s_ = 0.0;
+    LogHistogram tail_latency_ns_;
+    LogHistogram latency_ns_;
+};
+
+} // namespace ssd
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+
+namespace ssd {
+
+// LiveOptions controls streaming ingest from a pipe, FIFO, or stdin.
+struct LiveOptions {
+    double reorder_slack_s = 0.5;   // simulate up to latest timestamp minus slack
+    double window_s = 1.0;          // simulated seconds per reported window
+    size_t max_buffered = 1 << 20;  // reorder buffer cap; oldest released beyond it
+    int max_users = 256;            // user IDs beyond this fold modulo max_users
+};
+
+// LiveStats counts what happened to the input stream.
+struct LiveStats {
+    size_t lines = 0;
+    size_t requests = 0;
+    size_t skipped = 0;   // unparseable lines (e.g. blkparse summaries)
+    size_t late = 0;      // arrivals older than the released watermark
+    size_t folded = 0;    // requests whose user ID was folded into range
+    size_t windows = 0;   // window rows emitted
+};
+
+// ArrivalLater orders a min-heap of requests by arrival, then user ID, the
+// order load_trace sorts a trace into.
+struct ArrivalLater {
+    bool operator()(const Request& a, const Request& b) const {
+        if (a.arrival_ts == b.arrival_ts) return a.user_id > b.user_id;
+        return a.arrival_ts > b.arrival_ts;
+    }
+};
+
+// WindowReporter aggregates completions into fixed simulated-time windows and
+// prints one CSV row per non-empty window.
+class WindowReporter {
+public:
+    WindowReporter(double window_s, int num_users, std::ostream& out);
+
+    // on_finish must see completions in finish-time order.
+    void on_finish(const Request& r);
+    void flush();
+
+    size_t rows() const { return rows_; }
+
+private:
+    double window_s_;
+    std::ostream& out_;
+    Metrics window_;
+    int num_users_;
+    double current_ = 0.0;
+    size_t rows_ = 0;
+};
+
+// run_live parses |in| line by line as it arrives and feeds |sim| in arrival
+// order through a bounded reorder buffer. Once input has moved past a window
+// boundary, per-window stats are written to |out| as CSV and flushed, so a
+// pipe like `blkparse -i - | ssd-fairness --live -t -` reports while it runs.
+// Memory stays bounded by the reorder buffer and per-user counters.
+LiveStats run_live(std::istream& in, const LiveOptions& opts, Simulator& sim,
+                   std::ostream& out);
+
+} // namespace ssd
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// write_request_image stores |trace| as a raw Request array behind a small
+// header so other processes can map it without parsing. The image is only
+// portable between builds that share the Request layout (checked on open).
+void write_request_image(const std::string& path, const std::vector<Request>& trace,
+                         int num_users);
+
+// MappedTrace maps a request image read-only. Every process mapping the same
+// file shares one copy through the page cache.
+class MappedTrace {
+public:
+    explicit MappedTrace(const std::string& path);
+    ~MappedTrace();
+
+    MappedTrace(const MappedTrace&) = delete;
+    MappedTrace& operator=(const MappedTrace&) = delete;
+
+    const Request* data() const { return requests_; }
+    size_t size() const { return count_; }
+    int num_users() const { return num_users_; }
+
+private:
+    void* base_ = nullptr;
+    size_t mapped_bytes_ = 0;
+    const Request* requests_ = nullptr;
+    size_t count_ = 0;
+    int num_users_ = 0;
+};
+
+} // namespace util
@@ -9,26 +9,90 @@
 
 namespace ssd {
 
+// LogHistogram counts non-negative integers in log-linear buckets: values
+// below 16 are exact and every power of two above is split into 16
+// sub-buckets, so a quantile is within 1/16 of the true value. Storage grows
+// only up to the largest bucket seen (~2 KB for nanosecond latencies < 10 s).
+class LogHistogram {
+public:
+    static constexpr int kSubBits = 4;
+
+    void record(uint64_t v);
+    void merge(const LogHistogram& other);
+    void clear();
+
+    uint64_t count() const { return total_; }
+    // quantile returns the upper edge of the bucket holding quantile |q|.
+    uint64_t quantile(double q) const;
+
+private:
+    std::vector<uint32_t> counts_;
+    uint64_t total_ = 0;
+};
+
+// FairnessSuite summarizes how evenly a per-tenant quantity is spread.
+struct FairnessSuite {
+    double jain = 0.0;     // (sum x)^2 / (n sum x^2); 1 when equal
+    double max_min = 0.0;  // max / min; 1 when equal
+    double cov = 0.0;      // population stddev / mean; 0 when equal
+    double gini = 0.0;     // mean absolute difference / (2 mean); 0 when equal
+};
+
+// fairness_suite computes every FairnessSuite metric over |x|.
+FairnessSuite fairness_suite(std::vector<double> x);
+
+// LatencyBasis selects the per-tenant quantity a latency fairness metric
+// compares. Slowdown is response time over device service time.
+enum class LatencyBasis { MeanLatency, P99Latency, MeanSlowdown, P99Slowdown };
+
 // Metrics collects per-user throughput and latency statistics.
 class Metrics {
 public:
     explicit Metrics(int num_users = 0);
 
+    // reset clears every counter for |num_users| tenants; quantile tracking
+    // and weights are kept.
     void reset(int num_users);
 
+    // track_quantiles keeps per-user latency and slowdown histograms, needed
+    // by the P99 bases. Off by default, since it costs ~4 KB per active
+    // tenant; the CLI turns it on unless --topk is given.
+    void track_quantiles(bool on);
+    bool tracks_quantiles() const { return track_quantiles_; }
+
+    // set_weights sets the shares used by weighted latency fairness.
+    void set_weights(const std::vector<double>& w) { weights_ = w; }
+
     // on_finish ingests a completed request and updates aggregates.
     void on_finish(const Request& req);
 
     // avg_latency returns the mean latency (seconds) for |user_id|.
     double avg_latency(int user_id) const;
+    // latency_quantile returns |user_id|'s latency quantile |q| in seconds.
+    // Requires track_quantiles.
+    double latency_quantile(int user_id, double q) const;
+    // avg_slowdown returns the mean response/service time ratio of |user_id|.
+    double avg_slowdown(int user_id) const;
+    // slowdown_quantile returns |user_id|'s slowdown quantile |q|.
+    // Requires track_quantiles.
+    double slowdown_quantile(int user_id, double q) const;
     // total_bytes returns the accumulated bytes served by |user_id|.
     uint64_t total_bytes(int user_id) const;
     // completed returns the number of finished requests for |user_id|.
     size_t completed(int user_id) const;
 
+    // num_users returns how many users currently have a stats slot.
+    int num_users() const { return static_cast<int>(stats_.size()); }
+
     // fairness_index returns Jain's fairness metric over non-idle users.
     double fairness_index() const;
 
+    // latency_fairness compares |basis| across users that completed a
+    // request. Weighted, a tenant's value is scaled by its weight over the
+    // mean weight: twice the share is entitled to half the latency.
+    // Throws std::logic_error for a P99 basis without track_quantiles.
+    FairnessSuite latency_fairness(LatencyBasis basis, bool weighted = false) const;
+
     // Writes per-user stats to CSV. Returns true on success.
     bool save_csv(const std::string& path) const;
 
@@ -36,10 +100,15 @@ private:
     struct UserStats {
         size_t completed = 0;
         double total_latency = 0.0;
+        double total_slowdown = 0.0;
         uint64_t bytes = 0;
     };
 
     std::vector<UserStats> stats_;
+    std::vector<LogHistogram> latency_ns_;      // per user, if tracked
+    std::vector<LogHistogram> slowdown_milli_;  // per user, if tracked
+    std::vector<double> weights_;
+    bool track_quantiles_ = false;
 };
 
 } // namespace ssd
@@ -0,0 +1,501 @@
+#pragma once
+
+#include "scheduler_impl.hpp"
+#include "tenant_state.hpp"
+#include "vtime.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ssd {
+
+// Policy pipelines compose stages around one base policy. The spec lists
+// stages in request order: "prio>tbf>drr>sgfs" means priority classes first,
+// each class regulated by per-tenant token buckets, then scheduled by DRR,
+// whose decisions SGFS rotates. "rw" splits the rest of the chain into read
+// and write domains. Stages before the base wrap it outermost
+// first; stages after it wrap the base directly.
+//
+// Each stage holds its inner stage by value and is instantiated as a template,
+// so for the combinations registered in pipeline.cpp the whole chain is one
+// concrete type and inner calls inline. Other specs are built from the same
+// templates over SchedulerHandle, which costs a virtual call per stage.
+
+// PrioStage runs one |Inner| per priority class and always serves the highest
+// class that can dispatch. A class whose inner stage holds work back (e.g. a
+// token bucket) doesn't block lower classes.
+template <typename Inner>
+class PrioStage final : public Scheduler {
+    std::vector<Inner> classes_;
+    std::vector<int> priorities_;
+    std::vector<uint8_t> class_of_;
+    int picked_class_ = 0;
+
+public:
+    PrioStage(const SchedulerOptions& opts, const std::function<Inner()>& make_inner)
+        : priorities_(opts.priorities) {
+        int top = 0;
+        for (int p : priorities_) top = std::max(top, std::min(p, 255));
+        for (int c = 0; c <= top; ++c) classes_.push_back(make_inner());
+    }
+
+    void set_users(int n) override {
+        n = std::max(n, 0);
+        int lowest = static_cast<int>(classes_.size()) - 1;
+        class_of_.assign(n, static_cast<uint8_t>(lowest));
+        for (int u = 0; u < n && u < static_cast<int>(priorities_.size()); ++u)
+            class_of_[u] = static_cast<uint8_t>(std::clamp(priorities_[u], 0, lowest));
+        for (auto& c : classes_) c.set_users(n);
+    }
+
+    void set_weights(const std::vector<double>& w) override {
+        for (auto& c : classes_) c.set_weights(w);
+    }
+
+    void set_quantum(double q) override {
+        for (auto& c : classes_) c.set_quantum(q);
+    }
+
+    void enqueue(const Request& r) override {
+        if (r.user_id < 0 || r.user_id >= static_cast<int>(class_of_.size())) return;
+        classes_[class_of_[r.user_id]].enqueue(r);
+    }
+
+    // The class is remembered for pop() because inner stages may relabel the
+    // user id they return (SGFS rotation).
+    std::optional<int> pick_user(double now) override {
+        for (int c = 0; c < static_cast<int>(classes_.size()); ++c) {
+            if (classes_[c].empty()) continue;
+            if (auto uid = classes_[c].pick_user(now)) {
+                picked_class_ = c;
+                return uid;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Request> pop(int uid) override {
+        return classes_[picked_class_].pop(uid);
+    }
+
+    bool empty() const override {
+        for (const auto& c : classes_)
+            if (!c.empty()) return false;
+        return true;
+    }
+
+    double next_wakeup(double now) const override {
+        double next = std::numeric_limits<double>::infinity();
+        for (const auto& c : classes_) next = std::min(next, c.next_wakeup(now));
+        return next;
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        bool found = false;
+        for (auto& c : classes_) found = c.coordinate(tracker, device) || found;
+        return found;
+    }
+};
+
+// TokenBucketStage admits each tenant's requests into |Inner| at no more than
+// its weighted share of tbf_rate_MBps, with tbf_burst_bytes of burst. Requests
+// over the rate wait in a per-tenant FIFO. A rate of 0 disables regulation.
+template <typename Inner>
+class TokenBucketStage final : public Scheduler {
+    struct Bucket {
+        double tokens = 0.0;         // bytes available as of |last|
+        double last = 0.0;
+        uint32_t head = kNilIndex;   // held requests
+        uint32_t tail = kNilIndex;
+    };
+
+    Inner inner_;
+    double rate_Bps_;
+    double burst_;
+    std::vector<Bucket> buckets_;
+    std::vector<double> rate_;       // per-tenant bytes/s
+    std::vector<int> held_;          // tenants with held requests
+    RequestPool pool_;
+    size_t held_count_ = 0;
+
+    // eligible_at is when |uid|'s bucket covers its head request. Requests
+    // larger than the burst only need a full bucket.
+    double eligible_at(int uid) const {
+        const Bucket& b = buckets_[uid];
+        double need = std::min<double>(pool_.at(b.head).req.size_bytes, burst_);
+        if (b.tokens >= need) return b.last;
+        return rate_[uid] > 0.0 ? b.last + (need - b.tokens) / rate_[uid]
+                                : std::numeric_limits<double>::infinity();
+    }
+
+    void refill(int uid, double now) {
+        Bucket& b = buckets_[uid];
+        if (now <= b.last) return;
+        b.tokens = std::min(burst_, b.tokens + rate_[uid] * (now - b.last));
+        b.last = now;
+    }
+
+    void release(double now) {
+        for (size_t i = 0; i < held_.size();) {
+            int uid = held_[i];
+            Bucket& b = buckets_[uid];
+            while (b.head != kNilIndex && eligible_at(uid) <= now) {
+                refill(uid, now);
+                Request r = pool_.pop(b.head, b.tail);
+                b.tokens -= r.size_bytes;
+                --held_count_;
+                inner_.enqueue(r);
+            }
+            if (b.head == kNilIndex) {
+                held_[i] = held_.back();
+                held_.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+public:
+    TokenBucketStage(const SchedulerOptions& opts, Inner inner)
+        : inner_(std::move(inner)),
+          rate_Bps_(std::max(opts.tbf_rate_MBps, 0.0) * 1024.0 * 1024.0),
+          burst_(std::max(opts.tbf_burst_bytes, 1.0)) {}
+
+    void set_users(int n) override {
+        n = std::max(n, 0);
+        inner_.set_users(n);
+        buckets_.assign(n, {});
+        for (auto& b : buckets_) b.tokens = burst_;
+        rate_.assign(n, n > 0 ? rate_Bps_ / n : 0.0);
+        held_.clear();
+        pool_.clear();
+        held_count_ = 0;
+    }
+
+    void set_weights(const std::vector<double>& w) override {
+        inner_.set_weights(w);
+        double total = 0.0;
+        for (size_t i = 0; i < rate_.size(); ++i)
+            total += i < w.size() && w[i] > 0.0 ? w[i] : 1.0;
+        for (size_t i = 0; i < rate_.size(); ++i)
+            rate_[i] = rate_Bps_ * (i < w.size() && w[i] > 0.0 ? w[i] : 1.0) / total;
+    }
+
+    void set_quantum(double q) override {
+        inner_.set_quantum(q);
+    }
+
+    void enqueue(const Request& r) override {
+        if (rate_Bps_ <= 0.0 || r.user_id < 0 ||
+            r.user_id >= static_cast<int>(buckets_.size())) {
+            inner_.enqueue(r);
+            return;
+        }
+        Bucket& b = buckets_[r.user_id];
+        refill(r.user_id, r.arrival_ts);
+        double need = std::min<double>(r.size_bytes, burst_);
+        if (b.head == kNilIndex && b.tokens >= need) {
+            b.tokens -= r.size_bytes;
+            inner_.enqueue(r);
+            return;
+        }
+        if (b.head == kNilIndex) held_.push_back(r.user_id);
+        pool_.push(b.head, b.tail, r);
+        ++held_count_;
+    }
+
+    std::optional<int> pick_user(double now) override {
+        if (held_count_ > 0) release(now);
+        return inner_.pick_user(now);
+    }
+
+    std::optional<Request> pop(int uid) override {
+        return inner_.pop(uid);
+    }
+
+    bool empty() const override {
+        return held_count_ == 0 && inner_.empty();
+    }
+
+    double next_wakeup(double now) const override {
+        double next = inner_.next_wakeup(now);
+        for (int uid : held_) {
+            double t = eligible_at(uid);
+            if (t > now) next = std::min(next, t);
+        }
+        return next;
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        return inner_.coordinate(tracker, device);
+    }
+};
+
+// advance_pair adds |cost| to flow |d| of a two-flow virtual clock. Past
+// kVTimeRebaseAt both flows drop by the smaller tag; an idle other flow
+// restarts from |d|'s tag on its next enqueue, so it clamps to zero.
+inline void advance_pair(VTag (&vtime)[2], int d, VTag cost, bool other_busy) {
+    vtime[d] += cost;
+    if (vtime[d] < kVTimeRebaseAt) return;
+    VTag base = other_busy ? std::min(vtime[0], vtime[1]) : vtime[d];
+    vtime[d] -= base;
+    vtime[1 - d] = vtime[1 - d] > base ? vtime[1 - d] - base : 0;
+}
+
+// ReadWriteSplitStage gives every tenant separate read and write queues by
+// running one |Inner| per direction, each with its own weights (writes use
+// SchedulerOptions::write_weights when set). Between the two domains it either
+// prefers reads, serving one write after rw_max_read_streak consecutive reads
+// while writes wait, or splits bytes rw_read_share : 1 - rw_read_share using
+// a two-flow fixed-point virtual clock. Both decisions are O(1) on top of
+// |Inner|.
+template <typename Inner>
+class ReadWriteSplitStage final : public Scheduler {
+    enum Dir { kRead = 0, kWrite = 1 };
+
+    Inner domains_[2];
+    RwArbitration arbitration_;
+    int max_read_streak_;
+    ReciprocalWeight share_[2];
+    std::vector<double> write_weights_;
+    VTag vtime_[2] = { 0, 0 };  // bytes served / share, per direction
+    int read_streak_ = 0;
+    int picked_ = kRead;
+
+    // preferred returns the direction to try first; both must be non-empty.
+    int preferred() const {
+        if (arbitration_ == RwArbitration::ReadPriority)
+            return read_streak_ >= max_read_streak_ ? kWrite : kRead;
+        return vtime_[kWrite] < vtime_[kRead] ? kWrite : kRead;
+    }
+
+public:
+    ReadWriteSplitStage(const SchedulerOptions& opts, Inner reads, Inner writes)
+        : domains_{ std::move(reads), std::move(writes) },
+          arbitration_(opts.rw_arbitration),
+          max_read_streak_(std::max(opts.rw_max_read_streak, 1)),
+          write_weights_(opts.write_weights) {
+        double r = std::clamp(opts.rw_read_share, 0.01, 0.99);
+        share_[kRead] = ReciprocalWeight(r);
+        share_[kWrite] = ReciprocalWeight(1.0 - r);
+    }
+
+    void set_users(int n) override {
+        for (auto& d : domains_) d.set_users(n);
+        vtime_[kRead] = vtime_[kWrite] = 0;
+        read_streak_ = 0;
+    }
+
+    void set_weights(const std::vector<double>& w) override {
+        domains_[kRead].set_weights(w);
+        domains_[kWrite].set_weights(write_weights_.empty() ? w : write_weights_);
+    }
+
+    void set_quantum(double q) override {
+        for (auto& d : domains_) d.set_quantum(q);
+    }
+
+    // A direction that was idle restarts at the other's virtual time, so it
+    // can't bank service while it had nothing queued.
+    void enqueue(const Request& r) override {
+        int d = r.op == OpType::READ ? kRead : kWrite;
+        if (domains_[d].empty()) vtime_[d] = std::max(vtime_[d], vtime_[1 - d]);
+        domains_[d].enqueue(r);
+    }
+
+    std::optional<int> pick_user(double now) override {
+        bool has[2] = { !domains_[kRead].empty(), !domains_[kWrite].empty() };
+        if (!has[kRead] && !has[kWrite]) return std::nullopt;
+        int first = has[kRead] && has[kWrite] ? preferred() : (has[kRead] ? kRead : kWrite);
+        for (int d : { first, 1 - first }) {
+            if (!has[d]) continue;
+            if (auto uid = domains_[d].pick_user(now)) {
+                picked_ = d;
+                return uid;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Request> pop(int uid) override {
+        auto req = domains_[picked_].pop(uid);
+        if (!req) return req;
+        // Read priority never consults the clock, so it isn't kept.
+        if (arbitration_ == RwArbitration::Proportional)
+            advance_pair(vtime_, picked_, share_[picked_].cost(req->size_bytes),
+                         !domains_[1 - picked_].empty());
+        if (picked_ == kWrite || domains_[kWrite].empty())
+            read_streak_ = 0;
+        else
+            ++read_streak_;
+        return req;
+    }
+
+    bool empty() const override {
+        return domains_[kRead].empty() && domains_[kWrite].empty();
+    }
+
+    double next_wakeup(double now) const override {
+        return std::min(domains_[kRead].next_wakeup(now), domains_[kWrite].next_wakeup(now));
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        bool reads = domains_[kRead].coordinate(tracker, device);
+        return domains_[kWrite].coordinate(tracker, device) || reads;
+    }
+};
+
+// SizeClassStage queues each request in one of a few size classes, split at
+// SchedulerOptions::size_class_bytes, and runs one |Inner| per class so
+// tenants stay weighted-fair within a class. Classes whose requests are at
+// most size_express_bytes form the express lane. The rest are bulk. The
+// smallest non-empty class goes first (SRPT by class), found by
+// count-trailing-zeros over a bitmap of non-empty classes, so express always
+// precedes bulk. Each bulk class is guaranteed size_bulk_share of the bytes
+// served while it is backlogged: a fixed-point clock per bulk class advances
+// by its bytes over the share, and a class whose clock falls behind the
+// stage's total goes first, the furthest behind first. With k bulk classes
+// backlogged at once, each keeps at least min(size_bulk_share, 1/k) of the
+// bytes, less one request. Decisions are O(1) in the classes' bitmaps plus a
+// scan of the backlogged bulk classes, on top of |Inner|.
+template <typename Inner>
+class SizeClassStage final : public Scheduler {
+    static constexpr int kMaxClasses = 32;
+
+    std::vector<Inner> classes_;
+    std::vector<uint32_t> bounds_;  // upper size bound of every class but the last
+    uint32_t bulk_mask_ = 0;        // bit per bulk class
+    uint32_t busy_ = 0;             // bit per class with queued requests
+    ReciprocalWeight bulk_share_;
+    std::vector<VTag> floor_;       // per bulk class: bytes served / bulk share
+    VTag served_ = 0;               // bytes served by the stage
+    int picked_ = 0;
+
+    int class_of(uint32_t bytes) const {
+        return static_cast<int>(std::lower_bound(bounds_.begin(), bounds_.end(), bytes) -
+                                bounds_.begin());
+    }
+
+    // rebase drops every clock by the smallest live one. Idle classes restart
+    // from served_ on their next enqueue, so they clamp to zero.
+    void rebase() {
+        VTag base = served_;
+        for (uint32_t bits = busy_ & bulk_mask_; bits; bits &= bits - 1)
+            base = std::min(base, floor_[__builtin_ctz(bits)]);
+        served_ -= base;
+        for (VTag& f : floor_) f = f > base ? f - base : 0;
+    }
+
+    // most_behind returns the backlogged bulk class furthest below its share,
+    // or -1 when every one has had it.
+    int most_behind() const {
+        int best = -1;
+        for (uint32_t bits = busy_ & bulk_mask_; bits; bits &= bits - 1) {
+            int c = __builtin_ctz(bits);
+            if (floor_[c] < served_ && (best < 0 || floor_[c] < floor_[best])) best = c;
+        }
+        return best;
+    }
+
+public:
+    SizeClassStage(const SchedulerOptions& opts, const std::function<Inner()>& make_inner)
+        : bulk_share_(std::clamp(opts.size_bulk_share, 0.01, 0.99)) {
+        for (uint32_t b : opts.size_class_bytes)
+            if (b > 0 && (bounds_.empty() || b > bounds_.back())) bounds_.push_back(b);
+        if (bounds_.size() >= kMaxClasses) bounds_.resize(kMaxClasses - 1);
+        for (size_t c = 0; c <= bounds_.size(); ++c) {
+            classes_.push_back(make_inner());
+            bool express = c < bounds_.size() && bounds_[c] <= opts.size_express_bytes;
+            if (!express) bulk_mask_ |= 1u << c;
+        }
+        floor_.assign(classes_.size(), 0);
+    }
+
+    void set_users(int n) override {
+        for (auto& c : classes_) c.set_users(n);
+        busy_ = 0;
+        std::fill(floor_.begin(), floor_.end(), 0);
+        served_ = 0;
+    }
+
+    void set_weights(const std::vector<double>& w) override {
+        for (auto& c : classes_) c.set_weights(w);
+    }
+
+    void set_quantum(double q) override {
+        for (auto& c : classes_) c.set_quantum(q);
+    }
+
+    // A bulk class that was idle restarts at the stage's total, so it can't
+    // bank service while it had nothing queued.
+    void enqueue(const Request& r) override {
+        int c = class_of(r.size_bytes);
+        if (!(busy_ & (1u << c))) floor_[c] = std::max(floor_[c], served_);
+        classes_[c].enqueue(r);
+        busy_ |= 1u << c;
+    }
+
+    std::optional<int> pick_user(double now) override {
+        if (!busy_) return std::nullopt;
+        int behind = most_behind();
+        if (behind >= 0) {
+            if (auto uid = classes_[behind].pick_user(now)) {
+                picked_ = behind;
+                return uid;
+            }
+        }
+        // An inner stage holding work back passes the turn to the next
+        // larger class.
+        for (uint32_t bits = busy_; bits; bits &= bits - 1) {
+            int c = __builtin_ctz(bits);
+            if (c == behind) continue;
+            if (auto uid = classes_[c].pick_user(now)) {
+                picked_ = c;
+                return uid;
+            }
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Request> pop(int uid) override {
+        auto req = classes_[picked_].pop(uid);
+        if (classes_[picked_].empty()) busy_ &= ~(1u << picked_);
+        if (!req) return req;
+        served_ += VTag{req->size_bytes} << kVTimeFracBits;
+        if ((bulk_mask_ >> picked_) & 1) floor_[picked_] += bulk_share_.cost(req->size_bytes);
+        if (served_ >= kVTimeRebaseAt) rebase();
+        return req;
+    }
+
+    bool empty() const override {
+        return busy_ == 0;
+    }
+
+    double next_wakeup(double now) const override {
+        double next = std::numeric_limits<double>::infinity();
+        for (const auto& c : classes_) next = std::min(next, c.next_wakeup(now));
+        return next;
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        bool found = false;
+        for (auto& c : classes_) found = c.coordinate(tracker, device) || found;
+        return found;
+    }
+};
+
+// make_pipeline builds |spec| ("prio>tbf>drr>sgfs", "qfq", ...). Registered
+// combinations are fully static unless |force_dynamic| is set. Returns nullptr
+// when the spec is malformed or names an unknown stage.
+std::unique_ptr<Scheduler> make_pipeline(const std::string& spec,
+                                         const SchedulerOptions& opts,
+                                         bool force_dynamic = false);
+
+// is_static_pipeline reports whether |spec| has a fully inlined instantiation.
+bool is_static_pipeline(const std::string& spec);
+
+} // namespace ssd
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "scheduler.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace ssd {
+
+// Sampled simulation in the style of SimPoint: cut the trace into fixed
+// intervals, describe each by a workload feature vector, cluster the vectors
+// with k-means, simulate one representative interval per cluster and scale
+// its results by the cluster's size.
+
+// SamplingOptions configures run_sampled.
+struct SamplingOptions {
+    double interval_s = 1.0;   // simulated seconds per interval
+    int clusters = 8;          // k-means k, capped at the number of intervals
+    double warmup_s = 1.0;     // trace replayed before a representative, unmeasured
+    int threads = 0;           // representatives simulated in parallel; <= 0: all cores
+    int feature_tenants = 64;  // tenant-mix features, user IDs folded modulo this
+    uint64_t seed = 1;         // k-means++ seeding
+    SimOptions sim;            // event-loop options for every representative
+};
+
+// interval_features returns one feature vector per |interval_s| slice of
+// |trace| (sorted by arrival): request and byte rate (scaled to the busiest
+// interval), read fraction, a four-bucket size mix, and the share of requests
+// per tenant, folded into |feature_tenants| slots.
+std::vector<std::vector<double>> interval_features(const std::vector<Request>& trace,
+                                                   double interval_s, int feature_tenants);
+
+// kmeans clusters |points| into at most |k| groups (k-means++ seeding, Lloyd
+// iterations until assignments settle) and returns each point's cluster.
+std::vector<int> kmeans(const std::vector<std::vector<double>>& points, int k, uint64_t seed);
+
+// SampledRun is the extrapolated outcome of a sampled simulation.
+struct SampledRun {
+    size_t intervals = 0;
+    std::vector<int> cluster_of;           // per interval
+    std::vector<size_t> representatives;   // interval index per cluster
+    std::vector<size_t> cluster_sizes;     // intervals per cluster
+    size_t simulated_requests = 0;         // including warm-up replay
+    double wall_s = 0.0;
+
+    // Per-user totals scaled to the whole trace.
+    std::vector<double> completed;
+    std::vector<double> bytes;
+    std::vector<double> latency_sum_s;
+
+    double mean_latency(int user_id) const;
+    // overall_mean_latency is the request-weighted mean latency.
+    double overall_mean_latency() const;
+    // fairness_index is Jain's index over extrapolated bytes, like Metrics.
+    double fairness_index() const;
+};
+
+// run_sampled simulates the representatives of |trace| with schedulers from
+// |make_scheduler|, each on a fresh SSD built from |cfg|. A representative
+// first replays the preceding warmup_s of the trace so the device and queues
+// are loaded; only requests arriving inside the interval are measured, but
+// they are followed to completion.
+SampledRun run_sampled(const std::vector<Request>& trace, int num_users, const SimConfig& cfg,
+                       const std::function<std::unique_ptr<Scheduler>()>& make_scheduler,
+                       const std::vector<double>& weights, const SamplingOptions& opts);
+
+// SamplingError compares a sampled run with the full simulation of the trace.
+struct SamplingError {
+    double fairness_abs = 0.0;            // |sampled - full| Jain's index
+    double mean_latency_rel = 0.0;        // overall mean latency
+    double bytes_rel = 0.0;               // total bytes
+    double max_user_latency_rel = 0.0;    // worst per-user mean latency
+};
+
+SamplingError sampling_error(const SampledRun& sampled, const Metrics& full);
+
+} // namespace ssd
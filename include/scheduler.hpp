@@ -2,11 +2,14 @@
 
 #include "types.hpp"
 
+#include <limits>
 #include <optional>
 #include <vector>
 
 namespace ssd {
 
+class DmClockTracker;
+
 /**
  * Base scheduler interface implemented by all scheduling policies.
  *
@@ -32,6 +35,18 @@ public:
     virtual std::optional<int> pick_user(double virtual_time) = 0;
     virtual std::optional<Request> pop(int uid) = 0;
     virtual bool empty() const = 0;
+
+    // next_wakeup returns the earliest time after |now| at which a request the
+    // policy is holding back becomes eligible, so the driver can revisit the
+    // scheduler even without a completion. Work-conserving policies never hold.
+    virtual double next_wakeup(double /*now*/) const {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    // coordinate attaches every dmclock instance in the policy to |tracker|
+    // as |device| of an array (see dmclock.hpp). Stages forward it to what
+    // they wrap. Returns whether the policy contains a dmclock scheduler.
+    virtual bool coordinate(DmClockTracker* /*tracker*/, int /*device*/) { return false; }
 };
 
 } // namespace ssd
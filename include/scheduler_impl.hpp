@@ -1,42 +1,60 @@
 #pragma once
 
 #include "scheduler.hpp"
+#include "tenant_state.hpp"
+#include "vtime.hpp"
 
 #include <algorithm>
-#include <deque>
 #include <limits>
 #include <memory>
 #include <optional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace ssd {
 
 // RoundRobinScheduler cycles through users in order, skipping empty queues.
-class RoundRobinScheduler : public Scheduler {
-    std::vector<std::deque<Request>> queues_;
+class RoundRobinScheduler final : public Scheduler {
+    struct Hot {
+        uint32_t head = kNilIndex;  // kNilIndex when the tenant is idle
+        uint32_t tail = kNilIndex;
+    };
+    static_assert(sizeof(Hot) == 8, "RR hot record should stay packed");
+
+    std::vector<Hot> hot_;
+    std::vector<TenantCold> cold_;
+    RequestPool pool_;
+    size_t backlog_ = 0;
     int next_ = 0;
 
 public:
     void set_users(int n) override {
-        queues_.assign(std::max(n, 0), {});
+        hot_.assign(std::max(n, 0), {});
+        cold_.assign(hot_.size(), {});
+        pool_.clear();
+        backlog_ = 0;
         next_ = 0;
     }
 
     void enqueue(const Request& r) override {
-        if (r.user_id < 0 || r.user_id >= static_cast<int>(queues_.size()))
+        if (r.user_id < 0 || r.user_id >= static_cast<int>(hot_.size()))
             return;
-        queues_[r.user_id].push_back(r);
+        Hot& h = hot_[r.user_id];
+        pool_.push(h.head, h.tail, r);
+        ++cold_[r.user_id].enqueued;
+        ++backlog_;
     }
 
     // pick_user returns the next user id that has pending work.
     std::optional<int> pick_user(double) override {
-        if (queues_.empty()) return std::nullopt;
+        if (backlog_ == 0) return std::nullopt;
 
-        for (int i = 0; i < static_cast<int>(queues_.size()); ++i) {
-            int candidate = (next_ + i) % queues_.size();
-            if (!queues_[candidate].empty()) {
-                next_ = (candidate + 1) % queues_.size();
+        int n = static_cast<int>(hot_.size());
+        for (int i = 0; i < n; ++i) {
+            int candidate = next_ + i < n ? next_ + i : next_ + i - n;
+            if (hot_[candidate].head != kNilIndex) {
+                next_ = candidate + 1 < n ? candidate + 1 : 0;
                 return candidate;
             }
         }
@@ -44,146 +62,216 @@ public:
     }
 
     std::optional<Request> pop(int uid) override {
-        if (uid < 0 || uid >= static_cast<int>(queues_.size()) || queues_[uid].empty())
+        if (uid < 0 || uid >= static_cast<int>(hot_.size()) || hot_[uid].head == kNilIndex)
             return std::nullopt;
-        Request r = queues_[uid].front();
-        queues_[uid].pop_front();
+        Request r = pool_.pop(hot_[uid].head, hot_[uid].tail);
+        cold_[uid].served_bytes += r.size_bytes;
+        --backlog_;
         return r;
     }
 
     bool empty() const override {
-        for (const auto& q : queues_)
-            if (!q.empty()) return false;
-        return true;
+        return backlog_ == 0;
     }
 };
 
 // DeficitRoundRobinScheduler enforces byte-level fairness using deficit counters.
-class DeficitRoundRobinScheduler : public Scheduler {
-    std::vector<std::deque<Request>> queues_;
-    std::vector<int64_t> deficit_;
-    std::vector<double> weights_;
+class DeficitRoundRobinScheduler final : public Scheduler {
+    // The head request's size is cached so a visit that doesn't dispatch
+    // never leaves the hot array.
+    struct Hot {
+        int64_t deficit = 0;
+        int64_t quantum = 0;        // quantum_ * weight, precomputed
+        uint32_t head = kNilIndex;  // kNilIndex when the tenant is idle
+        uint32_t tail = kNilIndex;
+        uint32_t head_size = 0;
+        uint32_t reserved = 0;
+    };
+    static_assert(sizeof(Hot) == 32, "DRR hot record should fit half a cache line");
+
+    std::vector<Hot> hot_;
+    std::vector<TenantCold> cold_;
+    std::vector<uint64_t> active_;  // bit per tenant with a queued request
+    RequestPool pool_;
+    size_t backlog_ = 0;
     double quantum_ = 4096.0;
     int next_ = 0;
 
+    // next_active returns the first backlogged tenant at or after |from|,
+    // wrapping around, so a visit skips idle tenants 64 at a time.
+    int next_active(int from) const {
+        size_t w = static_cast<size_t>(from) >> 6;
+        uint64_t bits = w < active_.size() ? active_[w] & (~0ull << (from & 63)) : 0;
+        for (size_t seen = 0; seen <= active_.size(); ++seen) {
+            if (bits) return static_cast<int>(w * 64 + __builtin_ctzll(bits));
+            w = w + 1 < active_.size() ? w + 1 : 0;
+            bits = active_[w];
+        }
+        return -1;
+    }
+
+    // refresh_quanta keeps every quantum at least one byte; pick_user grants
+    // rounds until a head fits, so a zero quantum would never return.
+    void refresh_quanta() {
+        for (size_t i = 0; i < hot_.size(); ++i) {
+            int64_t quantum = static_cast<int64_t>(quantum_ * cold_[i].weight);
+            if (quantum <= 0) quantum = static_cast<int64_t>(quantum_);
+            hot_[i].quantum = std::max<int64_t>(quantum, 1);
+        }
+    }
+
 public:
     void set_users(int n) override {
-        queues_.assign(std::max(n, 0), {});
-        deficit_.assign(queues_.size(), 0);
-        weights_.assign(queues_.size(), 1.0);
+        hot_.assign(std::max(n, 0), {});
+        cold_.assign(hot_.size(), {});
+        active_.assign((hot_.size() + 63) / 64, 0);
+        pool_.clear();
+        backlog_ = 0;
         next_ = 0;
+        refresh_quanta();
     }
 
     void set_quantum(double q) override {
         if (q > 0.0) quantum_ = q;
+        refresh_quanta();
     }
 
     void set_weights(const std::vector<double>& w) override {
-        if (queues_.empty()) return;
-        weights_.assign(queues_.size(), 1.0);
-        for (size_t i = 0; i < weights_.size() && i < w.size(); ++i)
-            weights_[i] = std::max(w[i], 0.0);
+        if (hot_.empty()) return;
+        for (size_t i = 0; i < cold_.size(); ++i)
+            cold_[i].weight = i < w.size() ? std::max(w[i], 0.0) : 1.0;
+        refresh_quanta();
     }
 
     void enqueue(const Request& r) override {
-        if (r.user_id < 0 || r.user_id >= static_cast<int>(queues_.size()))
+        if (r.user_id < 0 || r.user_id >= static_cast<int>(hot_.size()))
             return;
-        queues_[r.user_id].push_back(r);
+        Hot& h = hot_[r.user_id];
+        if (h.head == kNilIndex) {
+            h.head_size = r.size_bytes;
+            active_[r.user_id >> 6] |= 1ull << (r.user_id & 63);
+        }
+        pool_.push(h.head, h.tail, r);
+        ++cold_[r.user_id].enqueued;
+        ++backlog_;
     }
 
-    // pick_user adds quantum credit and selects the first user whose request fits.
+    // pick_user adds quantum credit and selects the first user whose request fits,
+    // visiting backlogged users in index order from where the last pick left
+    // off. Rounds repeat until some head fits, so a backlog never yields
+    // nullopt even when requests are larger than the quantum.
     std::optional<int> pick_user(double) override {
-        if (queues_.empty()) return std::nullopt;
-
-        for (int i = 0; i < static_cast<int>(queues_.size()); ++i) {
-            int uid = (next_ + i) % queues_.size();
-            if (queues_[uid].empty()) continue;
-
-            int64_t quantum = static_cast<int64_t>(quantum_ * weights_[uid]);
-            if (quantum <= 0) quantum = static_cast<int64_t>(quantum_);
-            deficit_[uid] += quantum;
-
-            const Request& r = queues_[uid].front();
-            if (deficit_[uid] >= static_cast<int64_t>(r.size_bytes)) {
-                next_ = (uid + 1) % queues_.size();
+        if (backlog_ == 0) return std::nullopt;
+
+        int n = static_cast<int>(hot_.size());
+        for (int uid = next_active(next_);; uid = next_active(uid + 1 < n ? uid + 1 : 0)) {
+            Hot& h = hot_[uid];
+            h.deficit += h.quantum;
+            if (h.deficit >= static_cast<int64_t>(h.head_size)) {
+                next_ = uid + 1 < n ? uid + 1 : 0;
                 return uid;
             }
         }
-        return std::nullopt;
     }
 
     std::optional<Request> pop(int uid) override {
-        if (uid < 0 || uid >= static_cast<int>(queues_.size()) || queues_[uid].empty())
+        if (uid < 0 || uid >= static_cast<int>(hot_.size()) || hot_[uid].head == kNilIndex)
             return std::nullopt;
 
-        Request r = queues_[uid].front();
-        queues_[uid].pop_front();
-        deficit_[uid] = std::max<int64_t>(0, deficit_[uid] - static_cast<int64_t>(r.size_bytes));
+        Hot& h = hot_[uid];
+        Request r = pool_.pop(h.head, h.tail);
+        if (h.head != kNilIndex)
+            h.head_size = pool_.at(h.head).req.size_bytes;
+        else
+            active_[uid >> 6] &= ~(1ull << (uid & 63));
+        h.deficit = std::max<int64_t>(0, h.deficit - static_cast<int64_t>(r.size_bytes));
+        cold_[uid].served_bytes += r.size_bytes;
+        --backlog_;
         return r;
     }
 
     bool empty() const override {
-        for (const auto& q : queues_) if (!q.empty()) return false;
-        return true;
+        return backlog_ == 0;
     }
 };
 
 // WeightedFairScheduler approximates WFQ by tagging requests with finish times.
-class WeightedFairScheduler : public Scheduler {
-    struct TaggedRequest {
-        Request req;
-        double finish_tag = 0.0;
+// Tags are fixed-point (see vtime.hpp) and the virtual clock is self-clocked:
+// it advances to the finish tag of each request handed out.
+class WeightedFairScheduler final : public Scheduler {
+    struct Hot {
+        VTag head_tag = 0;          // finish tag of the queued head
+        VTag last_finish = 0;       // finish tag of the newest request
+        uint32_t head = kNilIndex;  // kNilIndex when the tenant is idle
+        uint32_t tail = kNilIndex;
     };
-
-    std::vector<std::deque<TaggedRequest>> queues_;
-    std::vector<double> weights_;
-    std::vector<double> last_finish_;
-    double virtual_time_ = 0.0;
-    int active_flows_ = 0;
+    static_assert(sizeof(Hot) == 24, "WFQ hot record should stay packed");
+
+    std::vector<Hot> hot_;
+    std::vector<TenantCold> cold_;
+    std::vector<ReciprocalWeight> recip_;  // cold: read on enqueue only
+    RequestPool pool_;
+    size_t backlog_ = 0;
+    VTag virtual_time_ = 0;
+
+    // rebase shifts every live tag down by the current virtual time. Queued
+    // tags never lie below it; idle flows' stale tags clamp to zero, which is
+    // where max(last_finish, virtual_time) would have put them anyway.
+    void rebase() {
+        VTag base = virtual_time_;
+        for (auto& h : hot_) {
+            for (uint32_t i = h.head; i != kNilIndex; i = pool_.at(i).next)
+                pool_.at(i).key -= base;
+            if (h.head != kNilIndex) h.head_tag -= base;
+            h.last_finish = h.last_finish > base ? h.last_finish - base : 0;
+        }
+        virtual_time_ = 0;
+    }
 
 public:
     void set_users(int n) override {
-        queues_.assign(std::max(n, 0), {});
-        weights_.assign(queues_.size(), 1.0);
-        last_finish_.assign(queues_.size(), 0.0);
-        active_flows_ = 0;
+        hot_.assign(std::max(n, 0), {});
+        cold_.assign(hot_.size(), {});
+        recip_.assign(hot_.size(), ReciprocalWeight(1.0));
+        pool_.clear();
+        backlog_ = 0;
+        virtual_time_ = 0;
     }
 
     void set_weights(const std::vector<double>& w) override {
-        if (queues_.empty()) return;
-        for (size_t i = 0; i < queues_.size(); ++i) {
-            if (i < w.size())
-                weights_[i] = std::max(w[i], 1e-9);
-            else
-                weights_[i] = 1.0;
+        if (hot_.empty()) return;
+        for (size_t i = 0; i < hot_.size(); ++i) {
+            cold_[i].weight = i < w.size() ? w[i] : 1.0;
+            recip_[i] = ReciprocalWeight(cold_[i].weight);
         }
     }
 
     void enqueue(const Request& r) override {
-        if (r.user_id < 0 || r.user_id >= static_cast<int>(queues_.size()))
+        if (r.user_id < 0 || r.user_id >= static_cast<int>(hot_.size()))
             return;
-
-        double weight = weights_[r.user_id];
-        double start_tag = std::max(last_finish_[r.user_id], virtual_time_);
-        double finish_tag = start_tag + static_cast<double>(r.size_bytes) / weight;
-        last_finish_[r.user_id] = finish_tag;
-
-        bool was_empty = queues_[r.user_id].empty();
-        queues_[r.user_id].push_back(TaggedRequest{r, finish_tag});
-        if (was_empty) ++active_flows_;
+        if (virtual_time_ >= kVTimeRebaseAt) rebase();
+
+        Hot& h = hot_[r.user_id];
+        VTag start_tag = std::max(h.last_finish, virtual_time_);
+        VTag finish_tag = start_tag + recip_[r.user_id].cost(r.size_bytes);
+        h.last_finish = finish_tag;
+        if (h.head == kNilIndex) h.head_tag = finish_tag;
+        pool_.push(h.head, h.tail, r, finish_tag);
+        ++cold_[r.user_id].enqueued;
+        ++backlog_;
     }
 
-    std::optional<int> pick_user(double now) override {
-        if (queues_.empty() || active_flows_ == 0) return std::nullopt;
-        virtual_time_ = std::max(virtual_time_, now);
+    // Ties go to the lowest user id; integer tags make that order stable.
+    std::optional<int> pick_user(double) override {
+        if (backlog_ == 0) return std::nullopt;
 
         int best_uid = -1;
-        double best_finish = std::numeric_limits<double>::infinity();
-        for (int uid = 0; uid < static_cast<int>(queues_.size()); ++uid) {
-            if (queues_[uid].empty()) continue;
-            double finish = queues_[uid].front().finish_tag;
-            if (finish < best_finish) {
-                best_finish = finish;
+        VTag best_finish = std::numeric_limits<VTag>::max();
+        for (int uid = 0; uid < static_cast<int>(hot_.size()); ++uid) {
+            const Hot& h = hot_[uid];
+            if (h.head == kNilIndex) continue;
+            if (best_uid < 0 || h.head_tag < best_finish) {
+                best_finish = h.head_tag;
                 best_uid = uid;
             }
         }
@@ -192,24 +280,51 @@ public:
     }
 
     std::optional<Request> pop(int uid) override {
-        if (uid < 0 || uid >= static_cast<int>(queues_.size()) || queues_[uid].empty())
+        if (uid < 0 || uid >= static_cast<int>(hot_.size()) || hot_[uid].head == kNilIndex)
             return std::nullopt;
-        TaggedRequest tagged = queues_[uid].front();
-        queues_[uid].pop_front();
-        if (queues_[uid].empty()) --active_flows_;
-        return tagged.req;
+        Hot& h = hot_[uid];
+        VTag finish_tag = h.head_tag;
+        Request r = pool_.pop(h.head, h.tail);
+        if (h.head != kNilIndex) h.head_tag = pool_.at(h.head).key;
+        virtual_time_ = std::max(virtual_time_, finish_tag);
+        cold_[uid].served_bytes += r.size_bytes;
+        --backlog_;
+        return r;
     }
 
     bool empty() const override {
-        for (const auto& q : queues_)
-            if (!q.empty()) return false;
-        return true;
+        return backlog_ == 0;
+    }
+};
+
+// SchedulerHandle adapts any Scheduler behind a pointer to the by-value stage
+// interface used by pipeline templates. It is the dynamic fallback: every call
+// through it is virtual.
+class SchedulerHandle final {
+    std::unique_ptr<Scheduler> impl_;
+
+public:
+    SchedulerHandle(std::unique_ptr<Scheduler> impl) : impl_(std::move(impl)) {}
+
+    void set_users(int n) { impl_->set_users(n); }
+    void set_weights(const std::vector<double>& w) { impl_->set_weights(w); }
+    void set_quantum(double q) { impl_->set_quantum(q); }
+    void enqueue(const Request& r) { impl_->enqueue(r); }
+    std::optional<int> pick_user(double now) { return impl_->pick_user(now); }
+    std::optional<Request> pop(int uid) { return impl_->pop(uid); }
+    bool empty() const { return impl_->empty(); }
+    double next_wakeup(double now) const { return impl_->next_wakeup(now); }
+    bool coordinate(DmClockTracker* tracker, int device) {
+        return impl_->coordinate(tracker, device);
     }
 };
 
-// StartGapScheduler rotates logical-to-physical user mapping to simulate SGFS.
-class StartGapScheduler : public Scheduler {
-    std::unique_ptr<Scheduler> base_;
+// RotateStage rotates the logical-to-physical user mapping of the decisions
+// made by |Inner| to simulate SGFS. |Inner| is held by value, so when it is a
+// concrete policy the forwarding calls inline.
+template <typename Inner>
+class RotateStage final : public Scheduler {
+    Inner base_;
     int rotate_every_ = 200;
     int gap_ = 1;
     int rotate_count_ = 0;
@@ -218,33 +333,32 @@ class StartGapScheduler : public Scheduler {
     std::unordered_map<int, int> remap_;
 
 public:
-    explicit StartGapScheduler(std::unique_ptr<Scheduler> base)
-        : base_(std::move(base)) {}
+    explicit RotateStage(Inner base = Inner()) : base_(std::move(base)) {}
 
     void set_users(int n) override {
         users_ = std::max(n, 0);
-        base_->set_users(users_);
+        base_.set_users(users_);
         remap_.clear();
         rotate_count_ = 0;
         start_ = 0;
     }
 
     void set_weights(const std::vector<double>& w) override {
-        base_->set_weights(w);
+        base_.set_weights(w);
     }
 
     void set_quantum(double q) override {
-        base_->set_quantum(q);
+        base_.set_quantum(q);
     }
 
     void enqueue(const Request& r) override {
-        base_->enqueue(r);
+        base_.enqueue(r);
     }
 
     std::optional<int> pick_user(double now) override {
         if (users_ == 0) return std::nullopt;
 
-        auto uid = base_->pick_user(now);
+        auto uid = base_.pick_user(now);
         if (!uid) return std::nullopt;
 
         if (rotate_every_ > 0 && ++rotate_count_ >= rotate_every_) {
@@ -264,11 +378,19 @@ public:
             actual = it->second;
             remap_.erase(it);
         }
-        return base_->pop(actual);
+        return base_.pop(actual);
     }
 
     bool empty() const override {
-        return base_->empty();
+        return base_.empty();
+    }
+
+    double next_wakeup(double now) const override {
+        return base_.next_wakeup(now);
+    }
+
+    bool coordinate(DmClockTracker* tracker, int device) override {
+        return base_.coordinate(tracker, device);
     }
 
     void set_start_gap(int rotate_every, int gap) {
@@ -277,4 +399,41 @@ public:
     }
 };
 
+// StartGapScheduler is SGFS rotation over an arbitrary, type-erased policy.
+using StartGapScheduler = RotateStage<SchedulerHandle>;
+
+// RwArbitration decides between a tenant set's read and write domains.
+enum class RwArbitration {
+    ReadPriority,  // reads first, one write after rw_max_read_streak reads
+    Proportional,  // bytes split rw_read_share : 1 - rw_read_share
+};
+
+// SchedulerOptions carries the CLI knobs needed to construct a policy.
+struct SchedulerOptions {
+    double quantum = 4096.0;
+    int sgfs_rotate_every = 200;
+    int sgfs_gap = 1;
+    std::vector<int> priorities;  // prio stage: class per user, 0 = highest
+    double tbf_rate_MBps = 0.0;   // tbf stage: aggregate rate split by weight
+    double tbf_burst_bytes = 1 << 20;
+    RwArbitration rw_arbitration = RwArbitration::ReadPriority;  // rw stage
+    int rw_max_read_streak = 8;    // reads in a row while writes wait
+    double rw_read_share = 0.5;    // proportional: read fraction of bytes
+    std::vector<double> write_weights;  // rw stage: write-domain weights
+    std::vector<double> reservations_MBps;  // dmclock: per-tenant floor, 0 = none
+    std::vector<double> limits_MBps;        // dmclock: per-tenant cap, 0 = none
+    // size stage: class upper bounds in bytes (the last class is unbounded),
+    // the largest request size in the express lane, and the bulk byte floor.
+    std::vector<uint32_t> size_class_bytes = { 4096, 16384, 65536, 262144, 1048576 };
+    uint32_t size_express_bytes = 16384;
+    double size_bulk_share = 0.2;
+};
+
+// make_scheduler builds the policy or pipeline named |name|: a base policy
+// (rr, drr, qfq, dmclock), "sgfs" (qfq with rotation), or a pipeline such as
+// "prio>tbf>drr>sgfs" (see pipeline.hpp). Returns nullptr for unknown names
+// so callers can report the error.
+std::unique_ptr<Scheduler> make_scheduler(const std::string& name,
+                                          const SchedulerOptions& opts);
+
 } // namespace ssd
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "events.hpp"
+#include "metrics.hpp"
+#include "scheduler.hpp"
+#include "ssd.hpp"
+#include "starvation.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace ssd {
+
+// SimOptions toggles optional behavior of the direct-attached event loop.
+struct SimOptions {
+    // charge_overhead measures the wall-clock cost of every scheduler call and
+    // delays dispatch by that cost (times overhead_scale) on a single
+    // simulated host CPU, so slow policies lose throughput.
+    bool charge_overhead = false;
+    double overhead_scale = 1.0;  // simulated seconds per measured second
+};
+
+// SimStats reports loop-level counters gathered during a run.
+struct SimStats {
+    size_t admitted = 0;
+    size_t dispatched = 0;
+    size_t completed = 0;
+    double end_time = 0.0;          // simulated time of the last completion
+    double scheduler_cpu_s = 0.0;   // measured time in enqueue/pick_user/pop
+    double host_cpu_busy_s = 0.0;   // simulated host CPU charged for it
+
+    // iops_ceiling is the request rate one host core could sustain running
+    // only the scheduler (0 when overhead was not measured).
+    double iops_ceiling() const {
+        return scheduler_cpu_s > 0.0 ? static_cast<double>(dispatched) / scheduler_cpu_s : 0.0;
+    }
+    // achieved_iops is the completed request rate over simulated time.
+    double achieved_iops() const {
+        return end_time > 0.0 ? static_cast<double>(completed) / end_time : 0.0;
+    }
+};
+
+// Simulator owns the discrete-event loop that moves requests from the
+// scheduler onto SSD channels and feeds completions to Metrics. It can replay
+// a whole trace with run(), or be driven incrementally with admit()/advance_to()
+// for sources that produce requests over time.
+class Simulator {
+public:
+    Simulator(Scheduler& scheduler, SSD& device, Metrics& metrics,
+              const SimOptions& opts = {});
+
+    // run replays |trace| (sorted by arrival) until every request completes.
+    void run(const std::vector<Request>& trace);
+    // run replays |count| requests starting at |trace|, e.g. a mapped image.
+    void run(const Request* trace, size_t count);
+
+    // admit advances the clock to |r.arrival_ts| and enqueues |r|. Requests
+    // arriving in the past are enqueued at the current time.
+    void admit(const Request& r);
+    // advance_to processes every completion up to |t| and moves the clock there.
+    // Dispatch decisions for the current instant are deferred until time moves
+    // on, so that all arrivals sharing a timestamp are visible to the policy.
+    void advance_to(double t);
+    // drain runs until the scheduler and device are both empty.
+    void drain();
+    // step is one iteration of drain: it dispatches what can start now and
+    // processes the next event. Returns false once there is nothing left.
+    bool step();
+    // poll dispatches whatever can start at the current time and returns when
+    // the loop next has work (infinity when idle), so several loops can be
+    // stepped together with advance_to.
+    double poll();
+
+    // set_completion_hook registers |hook| to observe every completed request
+    // after Metrics has recorded it (e.g. for windowed reporting).
+    void set_completion_hook(std::function<void(const Request&)> hook) {
+        completion_hook_ = std::move(hook);
+    }
+
+    // defer_completions makes the loop append finished requests to |out|
+    // instead of recording them in Metrics and the completion hook, so another
+    // thread can do that work (see staged.hpp). nullptr restores inline
+    // recording.
+    void defer_completions(std::vector<Request>* out) { deferred_ = out; }
+
+    // set_starvation_detector makes the loop report every enqueue and
+    // dispatch to |detector| and let it check its thresholds at each event
+    // time. nullptr (the default) detaches it.
+    void set_starvation_detector(StarvationDetector* detector) { starvation_ = detector; }
+
+    double now() const { return now_; }
+    const SimStats& stats() const { return stats_; }
+
+private:
+    void dispatch_ready();
+    void complete_at_now();
+    double next_event_time() const;
+    double charge(double measured_s, double ready_at);
+
+    Scheduler& scheduler_;
+    SSD& device_;
+    Metrics& metrics_;
+    SimOptions opts_;
+    EventQueue events_;
+    SimStats stats_;
+    std::function<void(const Request&)> completion_hook_;
+    std::vector<Request>* deferred_ = nullptr;
+    StarvationDetector* starvation_ = nullptr;
+    double now_ = 0.0;
+    double cpu_free_at_ = 0.0;  // simulated host CPU availability
+
+    // dispatch_ready scratch, kept to avoid per-call allocation.
+    std::vector<Event> batch_;
+};
+
+} // namespace ssd
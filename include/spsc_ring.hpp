@@ -0,0 +1,67 @@
+#pragma once
+
+#include "concurrent_metrics.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ssd {
+
+// SpscRing is a bounded lock-free queue between exactly one producer thread
+// and one consumer thread. Each side owns its index on a separate cache line
+// and caches the other side's index, so the shared lines only move when the
+// cached view says the ring looks full (producer) or empty (consumer).
+template <typename T>
+class SpscRing {
+public:
+    // |capacity| is rounded up to a power of two.
+    explicit SpscRing(size_t capacity) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        slots_.resize(n);
+        mask_ = n - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return slots_.size(); }
+
+    // try_push moves |v| in and returns true unless the ring is full.
+    // Producer thread only.
+    bool try_push(T& v) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_cache_ == slots_.size()) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (tail - head_cache_ == slots_.size()) return false;
+        }
+        slots_[tail & mask_] = std::move(v);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // try_pop moves the oldest element into |out| and returns true unless the
+    // ring is empty. Consumer thread only.
+    bool try_pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_cache_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (head == tail_cache_) return false;
+        }
+        out = std::move(slots_[head & mask_]);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::vector<T> slots_;
+    size_t mask_ = 0;
+    alignas(kCacheLineBytes) std::atomic<size_t> head_{ 0 };  // next slot to pop
+    size_t tail_cache_ = 0;                                    // consumer's view of tail_
+    alignas(kCacheLineBytes) std::atomic<size_t> tail_{ 0 };  // next slot to push
+    size_t head_cache_ = 0;                                    // producer's view of head_
+};
+
+} // namespace ssd
@@ -1,32 +1,63 @@
 #pragma once
 
+#include "events.hpp"
+#include "ftl.hpp"
+#include "thermal.hpp"
 #include "types.hpp"
 
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 namespace ssd {
 
 // ChannelState tracks when an SSD channel becomes available again.
 struct ChannelState {
-    double free_at = 0.0;  // Absolute time when the channel frees up.
+    double free_at = 0.0;        // Absolute time when the channel frees up.
+    double read_s_per_byte = 0.0;   // Current read cost including throttling.
+    double write_s_per_byte = 0.0;  // Current write cost including throttling.
+};
+
+// ThermalStats attributes heat generation and throttling cost to a tenant.
+struct ThermalStats {
+    double busy_s = 0.0;            // channel time consumed (heat contributed)
+    double throttle_delay_s = 0.0;  // extra service time paid while throttled
+    double wake_delay_s = 0.0;      // power-state exit latency paid
+    double ftl_stall_s = 0.0;       // foreground GC/wear-leveling time (not heat attribution)
 };
 
 // SSD models a simple multi-channel flash device with per-channel service time.
+// Service time is size over per-channel bandwidth, or, for an oracle device
+// (cfg.oracle), the time the captured device took for that request.
 class SSD {
 public:
     explicit SSD(const SimConfig& cfg);
 
     // Dispatches |r| onto |channel_idx| at time |now| and returns completion time.
-    double dispatch(int channel_idx, const Request& r, double now);
+    // With the FTL on, |r|'s nsid is stamped from the tenant map.
+    double dispatch(int channel_idx, Request& r, double now);
+
+    // dispatch_batch dispatches each batch[i].request onto batch[i].channel,
+    // in order and no earlier than its start_ts, and stores the completion in
+    // both batch[i].time and finish_ts, ready for EventQueue::push_batch.
+    // Equivalent to n dispatch() calls. Unless throttling can change the rate
+    // mid-batch, service times are computed up front in one branch-free pass.
+    void dispatch_batch(Event* batch, size_t n);
 
-    // first_free_channel scans for the earliest channel that is idle at |now|.
-    int first_free_channel(double now) const;
+    // first_free_channel scans for the earliest channel at or after |from|
+    // that is idle at |now|.
+    int first_free_channel(double now, int from = 0) const;
 
     // read_service_time_s returns the service time for a read of |bytes|.
     double read_service_time_s(uint32_t bytes) const;
     // write_service_time_s returns the service time for a write of |bytes|.
     double write_service_time_s(uint32_t bytes) const;
 
+    // set_rate_scale rescales every channel's bandwidth relative to the
+    // configured rates. Cost is O(channels) and independent of queued work.
+    void set_rate_scale(double scale);
+    double rate_scale() const { return rate_scale_; }
+
     // is_free reports whether channel |idx| is available at |now|.
     bool is_free(int idx, double now) const;
     // free_at returns the timestamp when channel |idx| becomes idle.
@@ -35,9 +66,37 @@ public:
 
     int num_channels() const { return static_cast<int>(channels_.size()); }
 
+    // thermal exposes the heat model; inert unless cfg.thermal.enabled.
+    const ThermalModel& thermal() const { return thermal_; }
+    // thermal_stats returns per-user heat/throttle attribution.
+    const std::vector<ThermalStats>& thermal_stats() const { return thermal_stats_; }
+
+    // ftl returns the flash translation layer, or nullptr unless
+    // cfg.ftl.enabled. Writes then also pay their GC/wear-leveling time.
+    const Ftl* ftl() const { return ftl_.get(); }
+
+    // oracle reports whether service times are replayed from a capture.
+    bool oracle() const { return oracle_ != nullptr; }
+
 private:
+    double oracle_service_s(const Request& r);
+
     SimConfig cfg_;
     std::vector<ChannelState> channels_;
+    double nominal_read_s_per_byte_ = 0.0;
+    double nominal_write_s_per_byte_ = 0.0;
+    double rate_scale_ = 1.0;
+    double busy_until_ = 0.0;  // latest completion across all channels
+    std::vector<double> service_;  // dispatch_batch scratch
+
+    ThermalModel thermal_;
+    std::vector<ThermalStats> thermal_stats_;
+
+    std::unique_ptr<Ftl> ftl_;
+
+    const float* oracle_ = nullptr;  // cfg_.oracle_s_per_byte, 4 bytes per slot
+    size_t oracle_size_ = 0;
+    uint64_t oracle_dispatches_ = 0;
 };
 
 } // namespace ssd
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "simulator.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+namespace ssd {
+
+// Staged runs split a trace replay across three threads connected by SPSC
+// rings of request batches: a loader that parses the trace, the simulation
+// loop, and a sink that records completions in Metrics, the per-request hook
+// and windowed reports. Batches are recycled through return rings, so the
+// steady state allocates nothing and each stage runs on its own core.
+
+// StagedOptions configures run_staged.
+struct StagedOptions {
+    size_t batch = 4096;            // requests per batch, both directions
+    size_t ring_batches = 16;       // batches in flight per link
+    double reorder_slack_s = 0.5;   // CSV input: reorder window, like LiveOptions
+    int max_users = 256;            // user IDs beyond this fold modulo max_users
+    double window_s = 0.0;          // > 0: windowed CSV rows to the window stream
+};
+
+// StagedStats reports what each stage did. cpu_s is the stage thread's CPU
+// time (including brief spins on a ring); wait_s is wall time spent blocked on
+// a ring. With a core per stage, wall_s approaches the largest cpu_s.
+struct StagedStats {
+    size_t requests = 0;
+    size_t late = 0;      // CSV arrivals older than an already released one
+    size_t folded = 0;    // requests whose user ID was folded into range
+    size_t windows = 0;   // window rows emitted
+    double loader_cpu_s = 0.0;
+    double sim_cpu_s = 0.0;
+    double sink_cpu_s = 0.0;
+    double loader_wait_s = 0.0;
+    double sim_wait_s = 0.0;
+    double sink_wait_s = 0.0;
+    double wall_s = 0.0;
+};
+
+// run_staged replays |trace_path| (columnar archive or CSV/blkparse text)
+// through |sim|, which must have been built over |metrics|. Archives are
+// already sorted; CSV is ordered through a reorder buffer of
+// |reorder_slack_s|, so unless requests arrive late the run matches
+// load_trace followed by Simulator::run. |on_complete| and the window rows
+// (written to |window_out|) run on the sink thread after Metrics. The first
+// exception thrown by any stage stops all three and is rethrown.
+StagedStats run_staged(const std::string& trace_path, const StagedOptions& opts,
+                       Simulator& sim, Metrics& metrics,
+                       const std::function<void(const Request&)>& on_complete,
+                       std::ostream& window_out);
+
+} // namespace ssd
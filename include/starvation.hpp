@@ -0,0 +1,126 @@
+#pragma once
+
+#include "metrics.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace ssd {
+
+// StarvationOptions sets the thresholds above which a backlogged tenant is
+// reported as starved.
+struct StarvationOptions {
+    double gap_threshold_s = 0.05;  // no dispatch for this long while backlogged
+    double age_threshold_s = 0.10;  // oldest queued request at least this old
+};
+
+// Kinds of starvation episode.
+enum class StarvationKind : uint8_t {
+    Gap = 0,  // the tenant went gap_threshold_s without a dispatch
+    Age = 1,  // the tenant's oldest queued request aged past age_threshold_s
+};
+
+// StarvationEvent is one episode. It opens when the detector first sees the
+// threshold crossed and closes when the condition clears.
+struct StarvationEvent {
+    int user_id = 0;
+    StarvationKind kind = StarvationKind::Gap;
+    double start_ts = 0.0;     // last service / backlog start, or the old request's arrival
+    double detected_ts = 0.0;  // simulated time the crossing was observed
+    double end_ts = 0.0;       // next dispatch, or when the oldest request got young enough
+    double duration_s() const { return end_ts - start_ts; }
+};
+
+// TenantStarvation is a tenant's service-gap distribution and worst cases.
+struct TenantStarvation {
+    LogHistogram gap_ns;    // backlogged time before each dispatch
+    double max_gap_s = 0.0;
+    double max_wait_s = 0.0;  // longest any dispatched request had queued
+    uint64_t gap_events = 0;
+    uint64_t age_events = 0;
+    double starved_s = 0.0;   // time spent inside gap episodes
+};
+
+// StarvationDetector watches enqueues and dispatches online. Per tenant it
+// knows when it was last served while backlogged and the arrival of its
+// oldest queued request. Two indexed min-heaps keyed by those times hold the
+// tenants not yet flagged, so a check is O(1) unless a threshold was crossed.
+// A dispatch costs O(log n) heap updates and an O(log q) removal from the
+// tenant's ordered arrivals, even when a pipeline serves it out of order.
+// Flagged tenants leave the heaps until their episode closes.
+class StarvationDetector {
+public:
+    explicit StarvationDetector(int num_users = 0, const StarvationOptions& opts = {});
+
+    // on_enqueue records |r| joining its tenant's queue at |now|.
+    void on_enqueue(const Request& r, double now);
+    // on_dispatch records |r| leaving its tenant's queue for the device at |now|.
+    void on_dispatch(const Request& r, double now);
+    // check opens an episode for every tenant past a threshold at |now|.
+    void check(double now);
+    // finish closes episodes still open at |now| (tenants left backlogged).
+    void finish(double now);
+
+    const StarvationOptions& options() const { return opts_; }
+    int num_users() const { return static_cast<int>(tenants_.size()); }
+    const TenantStarvation& tenant(int user) const { return stats_[user]; }
+    // events returns every closed episode in order of closing.
+    const std::vector<StarvationEvent>& events() const { return events_; }
+    // peak_starving is the most tenants inside a gap episode at once.
+    size_t peak_starving() const { return peak_starving_; }
+
+    // write_events_csv writes events() to |path|.
+    bool write_events_csv(const std::string& path) const;
+
+private:
+    // Heap is a min-heap of tenants keyed by a time, indexed by tenant so a
+    // key can change or a tenant leave in O(log n).
+    class Heap {
+    public:
+        bool empty() const { return items_.empty(); }
+        int top() const { return items_[0]; }
+        double top_key() const { return keys_[items_[0]]; }
+        bool contains(int u) const { return u < static_cast<int>(pos_.size()) && pos_[u] >= 0; }
+        // set inserts |u| or moves it to |key|.
+        void set(int u, double key);
+        void erase(int u);
+
+    private:
+        void sift_up(size_t i);
+        void sift_down(size_t i);
+        void place(size_t i, int u);
+
+        std::vector<int> items_;
+        std::vector<int64_t> pos_;   // tenant -> heap position, -1 when absent
+        std::vector<double> keys_;   // tenant -> key
+    };
+
+    struct Tenant {
+        std::multiset<double> queued;  // arrival times
+        double since = 0.0;         // gap start: last dispatch or backlog start
+        bool gap_flagged = false;
+        bool age_flagged = false;
+        double gap_detected = 0.0;
+        double age_start = 0.0;
+        double age_detected = 0.0;
+    };
+
+    void ensure(int user);
+    void close_gap(int user, double now);
+    void close_age(int user, double now);
+
+    StarvationOptions opts_;
+    std::vector<Tenant> tenants_;
+    std::vector<TenantStarvation> stats_;
+    Heap gap_heap_;  // backlogged, unflagged tenants by |since|
+    Heap age_heap_;  // backlogged, unflagged tenants by oldest arrival
+    std::vector<StarvationEvent> events_;
+    size_t starving_ = 0;
+    size_t peak_starving_ = 0;
+};
+
+} // namespace ssd
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ssd {
+
+// SweepItem is one configuration of a parameter sweep, stored as key=value
+// lines. Recognized keys: scheduler, quantum, channels, read_bw, write_bw,
+// weights (comma-separated), overhead (0/1). Missing keys use CLI defaults.
+struct SweepItem {
+    std::string id;
+    std::map<std::string, std::string> params;
+
+    // describe returns "k1=v1;k2=v2" for result files.
+    std::string describe() const;
+};
+
+// SweepResult is one line of sweep output.
+struct SweepResult {
+    double fairness_index = 0.0;
+    size_t completed = 0;
+    double sim_end_s = 0.0;
+    double mean_latency_s = 0.0;
+    double wall_s = 0.0;
+};
+
+// expand_sweep_grid turns "scheduler=rr,drr;channels=4,8" into the cartesian
+// product of its axes, numbering items in row-major order.
+std::vector<SweepItem> expand_sweep_grid(const std::string& grid);
+
+// run_sweep_item simulates |item| over |count| requests starting at |trace|.
+SweepResult run_sweep_item(const SweepItem& item, const Request* trace, size_t count,
+                           int num_users);
+
+// SweepQueue is a work queue kept entirely in a local directory, so any number
+// of worker processes can share it without a coordinator:
+//
+//   queue/<id>.item          pending
+//   claimed/<id>.item.<pid>  being run by process <pid>
+//   done/<id>.item           finished; its result is in results/<id>.csv
+//   failed/<id>.item         the simulation threw; see the worker's stderr
+//
+// Every transition is a rename(2) within one filesystem, so exactly one worker
+// wins each claim and a crash leaves each item in a single, recoverable state.
+class SweepQueue {
+public:
+    explicit SweepQueue(std::string dir);
+
+    // init creates the layout and enqueues |items|. Items already in any state
+    // (queued, claimed, done, or failed) are kept as they are.
+    void init(const std::vector<SweepItem>& items);
+
+    // recover_stale returns items claimed by processes that no longer exist to
+    // the queue (or to done/ if their result was already published). Returns
+    // the number of items recovered.
+    size_t recover_stale();
+
+    // claim moves the next pending item into claimed/ for this process.
+    std::optional<SweepItem> claim();
+    // complete publishes |result| for |item| and marks it done.
+    void complete(const SweepItem& item, const SweepResult& result);
+    // fail parks |item| in failed/ so it is not retried.
+    void fail(const SweepItem& item);
+
+    // collect writes every published result as one CSV to |out|, ordered by id.
+    size_t collect(std::ostream& out) const;
+
+    size_t pending() const;
+    const std::string& dir() const { return dir_; }
+    std::string trace_path() const { return dir_ + "/trace.bin"; }
+
+private:
+    std::string claimed_name(const std::string& id) const;
+
+    std::string dir_;
+};
+
+// run_sweep_worker claims and runs items from |dir| until the queue is empty
+// and returns how many it completed. The request image is mapped once.
+size_t run_sweep_worker(const std::string& dir);
+
+// run_sweep forks |workers| processes running run_sweep_worker and waits for
+// them. Safe to rerun after a crash: finished items are never repeated.
+// Returns the number of workers that failed.
+int run_sweep(const std::string& dir, int workers);
+
+} // namespace ssd
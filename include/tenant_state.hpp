@@ -0,0 +1,85 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace ssd {
+
+// Per-tenant scheduler state is split in two. Each policy keeps a small hot
+// record per tenant holding what a dispatch decision reads: the queue ends,
+// plus the head tag or deficit. Weights, configuration and statistics live in
+// a separate cold record. Queued requests live in a shared RequestPool,
+// linked through 32-bit indices, so a scan over tenants walks one dense array
+// and never touches a request it doesn't dispatch.
+
+constexpr uint32_t kNilIndex = UINT32_MAX;
+
+// TenantCold holds per-tenant data read only on enqueue/pop or by reports.
+struct TenantCold {
+    double weight = 1.0;
+    uint64_t enqueued = 0;
+    uint64_t served_bytes = 0;
+};
+
+// RequestPool stores queued requests in a slab with a free list. Each tenant's
+// FIFO is an intrusive singly linked list threaded through |next|; |key| is
+// policy-defined (e.g. a WFQ finish tag).
+class RequestPool {
+public:
+    struct Node {
+        Request req;
+        uint64_t key = 0;
+        uint32_t next = kNilIndex;
+    };
+
+    // push appends |r| to the FIFO (|head|, |tail|) and returns its index.
+    uint32_t push(uint32_t& head, uint32_t& tail, const Request& r, uint64_t key = 0) {
+        uint32_t idx;
+        if (free_ != kNilIndex) {
+            idx = free_;
+            free_ = nodes_[idx].next;
+        } else {
+            idx = static_cast<uint32_t>(nodes_.size());
+            nodes_.emplace_back();
+        }
+        Node& n = nodes_[idx];
+        n.req = r;
+        n.key = key;
+        n.next = kNilIndex;
+        if (tail == kNilIndex)
+            head = idx;
+        else
+            nodes_[tail].next = idx;
+        tail = idx;
+        return idx;
+    }
+
+    // pop removes the head of (|head|, |tail|) and returns its request.
+    // The FIFO must be non-empty.
+    Request pop(uint32_t& head, uint32_t& tail) {
+        uint32_t idx = head;
+        Node& n = nodes_[idx];
+        head = n.next;
+        if (head == kNilIndex) tail = kNilIndex;
+        n.next = free_;
+        free_ = idx;
+        return n.req;
+    }
+
+    const Node& at(uint32_t idx) const { return nodes_[idx]; }
+    Node& at(uint32_t idx) { return nodes_[idx]; }
+
+    // clear drops every node; indices held by callers become invalid.
+    void clear() {
+        nodes_.clear();
+        free_ = kNilIndex;
+    }
+
+private:
+    std::vector<Node> nodes_;
+    uint32_t free_ = kNilIndex;
+};
+
+} // namespace ssd
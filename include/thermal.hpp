@@ -0,0 +1,47 @@
+#pragma once
+
+#include "types.hpp"
+
+namespace ssd {
+
+// ThermalModel tracks a normalized device heat accumulator driven by channel
+// busy time. Heat relaxes exponentially toward the fraction of channels kept
+// busy, so a device saturated for several time constants approaches 1.0.
+class ThermalModel {
+public:
+    ThermalModel() = default;
+    ThermalModel(const ThermalConfig& cfg, int num_channels);
+
+    // on_busy charges |busy_s| seconds of channel activity starting at |now|.
+    // Returns true when the throttle level changed as a result.
+    bool on_busy(double now, double busy_s);
+
+    // heat returns the accumulator value decayed to |now|.
+    double heat(double now) const;
+    // peak_heat returns the highest heat observed so far.
+    double peak_heat() const { return peak_; }
+
+    // rate_scale returns the bandwidth multiplier for the current level.
+    double rate_scale() const;
+    // level returns the active throttle level (0 == unthrottled).
+    int level() const { return level_; }
+    // transitions counts how many times the throttle level changed.
+    size_t transitions() const { return transitions_; }
+
+    // wake_latency returns the delay a command pays after the device has been
+    // idle for |idle_s| seconds, including any unfinished state entry.
+    double wake_latency(double idle_s) const;
+
+private:
+    int level_for(double heat) const;
+
+    ThermalConfig cfg_;
+    double per_busy_second_ = 0.0;  // heat added per channel-busy second
+    double heat_ = 0.0;
+    double peak_ = 0.0;
+    double updated_at_ = 0.0;
+    int level_ = 0;
+    size_t transitions_ = 0;
+};
+
+} // namespace ssd
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace util {
+
+// ArchiveBlockInfo is one footer index entry describing a compressed block.
+struct ArchiveBlockInfo {
+    uint64_t offset = 0;  // file offset of the block payload
+    uint32_t bytes = 0;   // payload length
+    uint32_t count = 0;   // requests in the block
+    int64_t min_ns = 0;   // earliest arrival in the block
+    int64_t max_ns = 0;   // latest arrival in the block
+};
+
+// write_trace_archive stores |trace| in the columnar archive format: blocks of
+// |block_size| requests whose columns are delta+varint timestamps,
+// dictionary-coded users, and RLE ops and size classes, followed by a footer
+// index of block time ranges. Throws std::runtime_error on I/O failure.
+void write_trace_archive(const std::string& path, const std::vector<Request>& trace,
+                         size_t block_size = 65536);
+
+// is_trace_archive reports whether |path| starts with the archive magic.
+bool is_trace_archive(const std::string& path);
+
+// TraceArchiveReader gives random access to an archive through its footer
+// index. Blocks decode independently, so reads may run on several threads.
+class TraceArchiveReader {
+public:
+    explicit TraceArchiveReader(const std::string& path);
+
+    const std::vector<ArchiveBlockInfo>& blocks() const { return blocks_; }
+    size_t num_requests() const { return num_requests_; }
+    uint64_t file_bytes() const { return file_bytes_; }
+
+    // read_block decodes block |index|. Safe to call concurrently.
+    std::vector<Request> read_block(size_t index) const;
+
+    // first_block_at returns the first block whose range may hold arrivals at or
+    // after |t_seconds|, by binary search over the index (O(log blocks)).
+    size_t first_block_at(double t_seconds) const;
+
+    // read_range decodes requests with arrival in [t0, t1) using |threads|.
+    std::vector<Request> read_range(double t0, double t1, int threads = 1) const;
+    // read_all decodes every block; |threads| <= 0 picks hardware concurrency.
+    std::vector<Request> read_all(int threads = 0) const;
+
+private:
+    std::vector<Request> read_blocks(size_t first, size_t last, int threads) const;
+
+    std::string path_;
+    uint32_t version_ = 0;
+    std::vector<ArchiveBlockInfo> blocks_;
+    size_t num_requests_ = 0;
+    uint64_t file_bytes_ = 0;
+};
+
+} // namespace util
@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 // Timestamp type used across the project (microseconds since epoch)
 using timestamp_t = int64_t;
@@ -10,17 +12,95 @@ enum class OpType : uint8_t { READ=0, WRITE=1 };
 struct Request {
   int user_id;          // tenant id
   OpType op;
+  bool qos_reserved{false};  // dmClock: served in the reservation phase
+  uint16_t nsid{0};          // namespace, stamped by the SSD from the tenant map
   double arrival_ts;    // seconds
   uint32_t size_bytes;  // request size (bytes)
+  uint32_t slot{0};     // position in the source trace file, set by the parser
+  uint64_t address{0};  // starting byte offset on the device
   // runtime:
   double start_ts{0.0};
   double finish_ts{0.0};
 };
 
+// ThrottleLevel scales channel bandwidth once device heat reaches |heat|.
+struct ThrottleLevel {
+  double heat = 1.0;        // normalized heat (1.0 == all channels busy forever)
+  double rate_scale = 1.0;  // multiplier applied to per-channel bandwidth
+};
+
+// PowerState models an NVMe autonomous (APST) idle power state.
+struct PowerState {
+  double idle_after_s = 0.0;     // device idle time before entry begins
+  double entry_latency_s = 0.0;  // time needed to enter the state
+  double exit_latency_s = 0.0;   // wake-up cost paid by the next command
+};
+
+struct ThermalConfig {
+  bool enabled = false;
+  double time_constant_s = 2.0;       // heating/cooling time constant
+  double hysteresis = 0.05;           // heat margin before leaving a level
+  std::vector<ThrottleLevel> levels;  // ascending by heat
+  std::vector<PowerState> power_states;  // ascending by idle_after_s
+};
+
+enum class WearLeveling : uint8_t { None=0, Dynamic=1, Static=2 };
+
+// Precondition selects the steady state an FTL starts in instead of empty.
+enum class Precondition : uint8_t { None=0, Sequential=1, Random=2 };
+
+// GcPolicy picks the block garbage collection reclaims.
+enum class GcPolicy : uint8_t { Greedy=0, Fifo=1 };
+
+// NamespaceConfig sizes one NVMe namespace of the FTL. Shares are relative to
+// the other namespaces; the namespace exports share / (1 + over_provisioning)
+// of the physical capacity as logical space.
+struct NamespaceConfig {
+  double share = 1.0;               // relative share of the physical blocks
+  double over_provisioning = 0.07;  // (physical share - logical) / logical
+  GcPolicy gc = GcPolicy::Greedy;   // victim choice for GC its writes trigger
+};
+
+// FtlConfig describes the optional page-mapped flash translation layer.
+struct FtlConfig {
+  bool enabled = false;
+  uint64_t physical_bytes = 1ull << 30;  // raw flash capacity
+  uint32_t page_bytes = 16384;
+  uint32_t pages_per_block = 256;
+  double over_provisioning = 0.07;       // (physical - logical) / logical
+  uint32_t gc_threshold_blocks = 4;      // foreground GC below this many free blocks
+  uint32_t pe_cycles = 3000;             // rated program/erase cycles per block
+  double dwpd = 1.0;                     // rated drive writes per day
+  WearLeveling wear_leveling = WearLeveling::Dynamic;
+  uint32_t static_wl_gap = 100;          // erase-count spread that triggers static WL
+  double page_read_s = 60e-6;            // background copy: read ...
+  double page_program_s = 600e-6;        // ... then program
+  double block_erase_s = 3e-3;
+  Precondition precondition = Precondition::None;
+  double precondition_fill = 1.0;        // fraction of the logical space mapped
+  uint64_t precondition_seed = 1;
+  std::string snapshot_path;             // load this state instead of preconditioning
+  std::vector<NamespaceConfig> namespaces;  // empty: one namespace, over_provisioning above
+  bool partition_blocks = false;         // per-namespace block pools instead of one shared pool
+  std::vector<int> tenant_namespace;     // tenant -> namespace; default tenant % namespaces
+};
+
+// OracleMode selects how an oracle device charges a dispatched request from
+// the service times a blkparse capture recorded (see util::ServiceTimes).
+enum class OracleMode : uint8_t {
+  Off=0,
+  Request=1,   // the request's own observed D->C time
+  Position=2,  // the k-th dispatch gets the k-th capture request's rate, scaled to its size
+};
+
 struct SimConfig {
   int num_users = 4;
   int num_channels = 8;
   double read_bw_MBps = 1200.0;   // aggregate device BW assumption
   double write_bw_MBps = 800.0;   // aggregate
   // simple: service time = size / (agg_BW / num_channels)
+  ThermalConfig thermal;          // optional throttling / power-state model
+  FtlConfig ftl;                  // optional FTL / wear model
+  OracleMode oracle = OracleMode::Off;  // replay observed service times instead
+  std::shared_ptr<const std::vector<float>> oracle_s_per_byte;  // by trace slot
 };
@@ -2,13 +2,93 @@
 
 #include "types.hpp"
 
+#include <cstddef>
+#include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace util {
 
+// ServiceTimes holds how long the captured device took per request: the
+// seconds per byte between its blktrace dispatch (D) and completion (C),
+// indexed by Request::slot. Requests without a matched D/C pair (merged into
+// another request, or cut off by the capture) get the median rate of their
+// op type, so every slot has a value.
+struct ServiceTimes {
+    std::vector<float> s_per_byte;
+    size_t observed = 0;  // slots with their own D->C time
+};
+
+// TraceParser turns individual trace lines (CSV or blkparse text) into
+// Requests. It keeps the process -> user ID mapping and header state across
+// calls, so input can be parsed incrementally as it arrives.
+class TraceParser {
+public:
+    // parse_line returns true and fills |out| when |line| yields a request.
+    // Blank lines, comments, headers and non-queue blktrace events return
+    // false; malformed input throws std::runtime_error.
+    bool parse_line(const std::string& line, Request& out);
+
+    // track_service_times makes blkparse input record each request's D->C
+    // time; take_service_times then returns them (see ServiceTimes).
+    void track_service_times(bool on) { track_service_ = on; }
+    ServiceTimes take_service_times();
+
+    // cap_users bounds the label map for unbounded input such as --live.
+    // After |max_users| labels, a new label is not remembered: it gets an ID
+    // at or above |max_users| chosen by hashing the label, which callers fold
+    // modulo |max_users|, and a new CSV process is no longer checked for
+    // conflicting user IDs. 0 (the default) keeps every label.
+    void cap_users(int max_users) { max_users_ = max_users; }
+
+    // line_number returns how many lines have been seen so far.
+    size_t line_number() const { return line_no_; }
+    // num_users returns how many user IDs have been auto-assigned.
+    int num_users() const { return next_auto_user_id_; }
+
+private:
+    bool parse_csv6(const std::vector<std::string>& tokens, Request& out);
+    bool parse_csv5(const std::vector<std::string>& tokens, Request& out);
+    bool parse_blktrace(const std::string& text, Request& out, bool& produced);
+    int user_for(const std::string& label);
+    bool full() const {
+        return max_users_ > 0 && process_user_ids_.size() >= static_cast<size_t>(max_users_);
+    }
+    void track_event(const std::string& device, const std::string& action, double ts,
+                     std::stringstream& rest);
+
+    std::unordered_map<std::string, int> process_user_ids_;
+    int next_auto_user_id_ = 0;
+    int max_users_ = 0;
+    size_t line_no_ = 0;
+    bool saw_data_line_ = false;
+    uint32_t next_slot_ = 0;
+
+    // D/C join state, only used while tracking service times. In-flight
+    // requests are keyed by device and start sector.
+    struct Dispatched {
+        uint32_t slot;
+        double ts;
+        uint64_t bytes;
+    };
+    bool track_service_ = false;
+    std::unordered_map<uint64_t, uint32_t> queued_;
+    std::unordered_map<uint64_t, Dispatched> dispatched_;
+    std::vector<float> service_;
+    std::vector<bool> service_write_;
+};
+
 // load_trace_csv parses the provided trace (legacy/new CSV or blkparse output)
-// and returns requests sorted by arrival timestamp.
-std::vector<Request> load_trace_csv(const std::string& path);
+// and returns requests sorted by arrival timestamp. With |service|, the same
+// pass also fills in the requests' per-slot service times, and throws
+// std::runtime_error when the capture holds no matched dispatch/completion
+// events.
+std::vector<Request> load_trace_csv(const std::string& path, ServiceTimes* service = nullptr);
+
+// load_trace loads |path| as a columnar trace archive when it carries the
+// archive magic (see trace_archive.hpp) and as CSV/blkparse text otherwise.
+// Archives keep no D/C events, so |service| needs a text trace.
+std::vector<Request> load_trace(const std::string& path, ServiceTimes* service = nullptr);
 
 } // namespace util
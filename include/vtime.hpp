@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+namespace ssd {
+
+// VTag is a fixed-point virtual-time tag: kVTimeFracBits fractional bits of
+// bytes-per-unit-weight service. Tags are plain unsigned integers, so sums
+// are exact and comparisons don't depend on how far the clock has advanced.
+// Because new tags never fall below the current virtual time, the keys a
+// policy extracts are monotone, which is the invariant a radix heap needs.
+using VTag = uint64_t;
+
+constexpr int kVTimeFracBits = 16;
+constexpr int kRecipShift = 32;
+
+// Weights are clamped so the reciprocal fits in 64 bits and keeps at least
+// 16 significant bits.
+constexpr double kMinVWeight = 1.0 / 65536.0;
+constexpr double kMaxVWeight = 4294967296.0;
+
+// Once the clock passes kVTimeRebaseAt, policies subtract a common base from
+// every live tag. That leaves 2^62 units of headroom for in-flight tags.
+constexpr VTag kVTimeRebaseAt = VTag{1} << 62;
+
+// ReciprocalWeight turns "bytes / weight" into a multiply and a shift:
+// cost = (bytes * recip) >> kRecipShift, with
+// recip = round(2^(kVTimeFracBits + kRecipShift) / weight).
+class ReciprocalWeight {
+public:
+    ReciprocalWeight() : ReciprocalWeight(1.0) {}
+    explicit ReciprocalWeight(double weight) {
+        weight = std::clamp(weight, kMinVWeight, kMaxVWeight);
+        double scale = static_cast<double>(uint64_t{1} << (kVTimeFracBits + kRecipShift));
+        double r = scale / weight + 0.5;
+        recip_ = r >= 18446744073709551615.0 ? UINT64_MAX : static_cast<uint64_t>(r);
+    }
+
+    // cost returns the virtual service of |bytes|; exact to within one unit.
+    VTag cost(uint64_t bytes) const {
+        __extension__ typedef unsigned __int128 u128;
+        return static_cast<VTag>((static_cast<u128>(bytes) * recip_) >> kRecipShift);
+    }
+
+    uint64_t raw() const { return recip_; }
+
+private:
+    uint64_t recip_ = 0;
+};
+
+// vtag_to_bytes converts a tag back to normalized bytes for reporting.
+inline double vtag_to_bytes(VTag tag) {
+    return static_cast<double>(tag) / static_cast<double>(uint64_t{1} << kVTimeFracBits);
+}
+
+} // namespace ssd
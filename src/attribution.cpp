@@ -0,0 +1,186 @@
+#include "attribution.hpp"
+#include "metrics.hpp"
+#include "ssd.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <exception>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace ssd {
+
+namespace {
+
+constexpr size_t kMaxTenants = 64;
+
+uint64_t bit(int player) {
+    return uint64_t{1} << player;
+}
+
+// rank returns |player|'s position among the members of |mask|.
+size_t rank(uint64_t mask, int player) {
+    return std::bitset<64>(mask & (bit(player) - 1)).count();
+}
+
+// orderings returns every ordering of |n| players when there are at most
+// |wanted| of them, else |wanted| uniformly random ones (Fisher-Yates).
+std::vector<std::vector<int>> orderings(int n, int wanted, uint64_t seed, bool& exact) {
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    uint64_t count = 1;
+    for (int i = 2; i <= n && count <= static_cast<uint64_t>(wanted); ++i) count *= i;
+    exact = count <= static_cast<uint64_t>(wanted);
+
+    std::vector<std::vector<int>> out;
+    if (exact) {
+        do out.push_back(order);
+        while (std::next_permutation(order.begin(), order.end()));
+        return out;
+    }
+    std::mt19937_64 rng(seed);
+    for (int p = 0; p < wanted; ++p) {
+        for (int i = n - 1; i > 0; --i) std::swap(order[i], order[rng() % (i + 1)]);
+        out.push_back(order);
+    }
+    return out;
+}
+
+} // namespace
+
+// Each ordering of the tenants induces, for victim v, the chain {v},
+// {v, j1}, {v, j1, j2}, ... over the others in that order; j's marginal
+// contribution is the step it adds. Chains of different victims meet once
+// the victim's own position in the ordering is passed, and orderings share
+// short prefixes, so the memo removes most repeated simulations.
+Attribution attribute_interference(const std::vector<Request>& trace, int num_users,
+                                   const SimConfig& cfg,
+                                   const std::function<std::unique_ptr<Scheduler>()>& make_scheduler,
+                                   const std::vector<double>& weights,
+                                   const AttributionOptions& opts) {
+    auto t_start = std::chrono::steady_clock::now();
+    Attribution out;
+    num_users = std::max(num_users, 0);
+    std::vector<int> player_of(num_users, -1);
+    for (const Request& r : trace)
+        if (r.user_id >= 0 && r.user_id < num_users) player_of[r.user_id] = 0;
+    for (int u = 0; u < num_users; ++u) {
+        if (player_of[u] < 0) continue;
+        player_of[u] = static_cast<int>(out.tenants.size());
+        out.tenants.push_back(u);
+    }
+    const int n = static_cast<int>(out.tenants.size());
+    if (n > static_cast<int>(kMaxTenants))
+        throw std::invalid_argument("Interference attribution supports at most 64 active tenants");
+    if (n == 0) return out;
+
+    auto perms = orderings(n, std::max(opts.permutations, 1), opts.seed, out.exact);
+    out.permutations = perms.size();
+
+    // Register every coalition the chains visit, once.
+    std::unordered_map<uint64_t, size_t> memo;
+    std::vector<uint64_t> masks;
+    auto need = [&](uint64_t mask) {
+        if (memo.emplace(mask, masks.size()).second) masks.push_back(mask);
+    };
+    for (const auto& order : perms) {
+        for (int v = 0; v < n; ++v) {
+            uint64_t coalition = bit(v);
+            need(coalition);
+            for (int j : order) {
+                if (j == v) continue;
+                coalition |= bit(j);
+                need(coalition);
+            }
+        }
+    }
+    out.coalitions = masks.size();
+
+    // values[c][k] holds the measures of the k-th member of masks[c].
+    std::vector<std::vector<MeasureValues>> values(masks.size());
+    auto simulate = [&](size_t c) {
+        uint64_t mask = masks[c];
+        auto scheduler = make_scheduler();
+        scheduler->set_users(num_users);
+        if (!weights.empty()) scheduler->set_weights(weights);
+        SSD device(cfg);
+        Metrics metrics(num_users);
+        metrics.track_quantiles(true);
+        Simulator sim(*scheduler, device, metrics, opts.sim);
+        for (const Request& r : trace) {
+            if (r.user_id < 0 || r.user_id >= num_users) continue;
+            int p = player_of[r.user_id];
+            if (p >= 0 && (mask & bit(p))) sim.admit(r);
+        }
+        sim.drain();
+        auto& vals = values[c];
+        for (int p = 0; p < n; ++p) {
+            if (!(mask & bit(p))) continue;
+            int u = out.tenants[p];
+            vals.push_back({ metrics.avg_latency(u), metrics.latency_quantile(u, 0.99),
+                             metrics.avg_slowdown(u), metrics.slowdown_quantile(u, 0.99) });
+        }
+    };
+
+    int threads = opts.threads > 0 ? opts.threads
+                                   : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = static_cast<int>(std::min<size_t>(threads, masks.size()));
+    if (threads <= 1) {
+        for (size_t c = 0; c < masks.size(); ++c) simulate(c);
+    } else {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(threads);
+        for (int w = 0; w < threads; ++w) {
+            workers.emplace_back([&, w]() {
+                try {
+                    for (size_t c = next++; c < masks.size(); c = next++) simulate(c);
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& t : workers) t.join();
+        for (auto& e : errors)
+            if (e) std::rethrow_exception(e);
+    }
+
+    auto value = [&](uint64_t mask, int v) -> const MeasureValues& {
+        ++out.lookups;
+        return values[memo.at(mask)][rank(mask, v)];
+    };
+    out.shapley.assign(n, std::vector<MeasureValues>(n, MeasureValues{}));
+    for (const auto& order : perms) {
+        for (int v = 0; v < n; ++v) {
+            uint64_t prev = bit(v);
+            for (int j : order) {
+                if (j == v) continue;
+                uint64_t cur = prev | bit(j);
+                const MeasureValues& before = value(prev, v);
+                const MeasureValues& after = value(cur, v);
+                for (size_t m = 0; m < kInterferenceMeasures; ++m)
+                    out.shapley[v][j][m] += after[m] - before[m];
+                prev = cur;
+            }
+        }
+    }
+    double scale = 1.0 / static_cast<double>(perms.size());
+    for (auto& row : out.shapley)
+        for (auto& cell : row)
+            for (double& x : cell) x *= scale;
+
+    uint64_t all = n == static_cast<int>(kMaxTenants) ? ~uint64_t{0} : bit(n) - 1;
+    for (int v = 0; v < n; ++v) {
+        out.alone.push_back(value(bit(v), v));
+        out.shared.push_back(value(all, v));
+    }
+    out.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    return out;
+}
+
+} // namespace ssd
@@ -0,0 +1,100 @@
+#include "concurrent_metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+// latency_bucket returns floor(log2(ns)) via a count-leading-zeros.
+int latency_bucket(uint64_t ns) {
+    return 63 - __builtin_clzll(ns | 1);
+}
+
+} // namespace
+
+namespace ssd {
+
+ConcurrentMetrics::ConcurrentMetrics(int num_users, int num_shards)
+    : num_users_(std::max(num_users, 0)) {
+    shards_.reserve(std::max(num_shards, 1));
+    for (int i = 0; i < std::max(num_shards, 1); ++i)
+        shards_.push_back(std::make_unique<Shard>(num_users_));
+}
+
+void ConcurrentMetrics::on_finish(int shard, const Request& req) {
+    // A bad shard has no dropped counter of its own, and borrowing another's
+    // would break its single-writer rule.
+    if (shard < 0 || shard >= static_cast<int>(shards_.size()))
+        throw std::out_of_range("Invalid metrics shard");
+    Shard& s = *shards_[shard];
+    if (req.user_id < 0 || req.user_id >= num_users_) {
+        bump(s.dropped, 1);
+        return;
+    }
+    double latency = req.finish_ts - req.arrival_ts;
+    uint64_t ns = latency > 0.0 ? static_cast<uint64_t>(latency * 1e9) : 0;
+
+    UserCounters& u = s.users[req.user_id];
+    bump(u.completed, 1);
+    bump(u.latency_ns, ns);
+    bump(u.bytes, req.size_bytes);
+    bump(s.histogram[latency_bucket(ns)], 1);
+}
+
+MetricsSnapshot ConcurrentMetrics::snapshot() const {
+    MetricsSnapshot snap;
+    snap.completed.assign(num_users_, 0);
+    snap.latency_ns.assign(num_users_, 0);
+    snap.bytes.assign(num_users_, 0);
+    for (const auto& shard : shards_) {
+        const Shard& s = *shard;
+        for (int u = 0; u < num_users_; ++u) {
+            snap.completed[u] += s.users[u].completed.load(std::memory_order_relaxed);
+            snap.latency_ns[u] += s.users[u].latency_ns.load(std::memory_order_relaxed);
+            snap.bytes[u] += s.users[u].bytes.load(std::memory_order_relaxed);
+        }
+        for (int b = 0; b < MetricsSnapshot::kLatencyBuckets; ++b)
+            snap.latency_histogram[b] += s.histogram[b].load(std::memory_order_relaxed);
+        snap.dropped += s.dropped.load(std::memory_order_relaxed);
+    }
+    return snap;
+}
+
+double MetricsSnapshot::avg_latency(int user_id) const {
+    if (user_id < 0 || user_id >= static_cast<int>(completed.size()) || completed[user_id] == 0)
+        return 0.0;
+    return static_cast<double>(latency_ns[user_id]) * 1e-9 /
+           static_cast<double>(completed[user_id]);
+}
+
+double MetricsSnapshot::latency_quantile(double q) const {
+    uint64_t total = 0;
+    for (uint64_t c : latency_histogram) total += c;
+    if (total == 0) return 0.0;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * total));
+    uint64_t seen = 0;
+    for (int b = 0; b < kLatencyBuckets; ++b) {
+        seen += latency_histogram[b];
+        if (seen >= rank && seen > 0) return std::ldexp(1.0, b + 1) * 1e-9;
+    }
+    return std::ldexp(1.0, kLatencyBuckets) * 1e-9;
+}
+
+// fairness_index mirrors Metrics::fairness_index so both collectors agree.
+double MetricsSnapshot::fairness_index() const {
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    size_t participants = 0;
+    for (uint64_t b : bytes) {
+        if (b == 0) continue;
+        participants += 1;
+        double x = static_cast<double>(b);
+        sum += x;
+        sum_sq += x * x;
+    }
+    if (participants == 0 || sum_sq == 0.0) return 0.0;
+    return (sum * sum) / (participants * sum_sq);
+}
+
+} // namespace ssd
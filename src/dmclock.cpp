@@ -0,0 +1,215 @@
+#include "dmclock.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace ssd {
+
+namespace {
+
+constexpr double kInf = std::numeric_limits<double>::infinity();
+constexpr double kBytesPerMB = 1024.0 * 1024.0;
+constexpr VTag kNever = std::numeric_limits<VTag>::max();
+// R and L tags count microseconds with kVTimeFracBits fractional bits, which
+// covers about two years of simulated time.
+constexpr double kTagsPerSecond = 1e6 * static_cast<double>(uint64_t{1} << kVTimeFracBits);
+
+double rate_Bps(const std::vector<double>& MBps, size_t i) {
+    return i < MBps.size() && MBps[i] > 0.0 ? MBps[i] * kBytesPerMB : 0.0;
+}
+
+VTag time_tag(double s) {
+    return s > 0.0 ? static_cast<VTag>(s * kTagsPerSecond) : 0;
+}
+
+double tag_seconds(VTag t) {
+    return static_cast<double>(t) / kTagsPerSecond;
+}
+
+// rate_recip turns a rate in bytes/s into the reciprocal that maps bytes to
+// time-tag units, i.e. a weight in bytes per microsecond.
+ReciprocalWeight rate_recip(double Bps) {
+    return ReciprocalWeight(Bps / 1e6);
+}
+
+} // namespace
+
+DmClockScheduler::DmClockScheduler(const SchedulerOptions& opts)
+    : reservations_MBps_(opts.reservations_MBps), limits_MBps_(opts.limits_MBps) {}
+
+void DmClockScheduler::refresh_rates() {
+    for (size_t i = 0; i < cold_.size(); ++i) {
+        double reservation = rate_Bps(reservations_MBps_, i);
+        double limit = rate_Bps(limits_MBps_, i);
+        cold_[i].reserves = reservation > 0.0;
+        cold_[i].limited = limit > 0.0;
+        cold_[i].reservation = rate_recip(reservation);
+        cold_[i].limit = rate_recip(limit);
+    }
+}
+
+void DmClockScheduler::set_users(int n) {
+    hot_.assign(std::max(n, 0), {});
+    cold_.assign(hot_.size(), {});
+    pool_.clear();
+    backlog_ = 0;
+    vtime_ = 0;
+    picked_ = -1;
+    refresh_rates();
+}
+
+void DmClockScheduler::set_weights(const std::vector<double>& w) {
+    for (size_t i = 0; i < cold_.size(); ++i)
+        cold_[i].weight = ReciprocalWeight(i < w.size() && w[i] > 0.0 ? w[i] : 1.0);
+}
+
+// rebase shifts every P tag down by the virtual time, as WFQ does. R and L
+// tags are absolute times and stay put.
+void DmClockScheduler::rebase() {
+    for (size_t i = 0; i < hot_.size(); ++i) {
+        if (hot_[i].head_idx != kNilIndex) hot_[i].head.p -= vtime_;
+        VTag& last = cold_[i].last.p;
+        last = last > vtime_ ? last - vtime_ : 0;
+    }
+    vtime_ = 0;
+}
+
+// tag_head tags |uid|'s new head with the tenant's remote service since its
+// last head plus the head's own size: R advances by rho at the reservation
+// rate, P by delta over the weight and L by delta at the limit rate. R and L
+// never start before the head's arrival, so an idle tenant banks no credit
+// while a backlogged one keeps what it is owed; P restarts from the virtual
+// time for the same reason.
+void DmClockScheduler::tag_head(int uid) {
+    Hot& h = hot_[uid];
+    Cold& c = cold_[uid];
+    const Request& head = pool_.at(h.head_idx).req;
+    uint64_t delta = head.size_bytes;
+    uint64_t rho = head.size_bytes;
+    if (tracker_) {
+        auto remote = tracker_->next(device_, uid);
+        delta += remote.first;
+        rho += remote.second;
+    }
+    if (vtime_ >= kVTimeRebaseAt) rebase();
+
+    const VTag arrival = time_tag(head.arrival_ts);
+    Tags& t = h.head;
+    t.r = c.reserves ? std::max(c.last.r + c.reservation.cost(rho), arrival) : kNever;
+    t.p = std::max(c.last.p, vtime_) + c.weight.cost(delta);
+    t.l = c.limited ? std::max(c.last.l + c.limit.cost(delta), arrival) : 0;
+    c.last = t;
+}
+
+void DmClockScheduler::enqueue(const Request& r) {
+    if (r.user_id < 0 || r.user_id >= static_cast<int>(hot_.size()))
+        return;
+    Hot& h = hot_[r.user_id];
+    bool was_idle = h.head_idx == kNilIndex;
+    pool_.push(h.head_idx, h.tail_idx, r);
+    if (was_idle) tag_head(r.user_id);
+    ++cold_[r.user_id].enqueued;
+    ++backlog_;
+}
+
+// pick_user serves the earliest due reservation, else the smallest P tag of
+// a tenant under its limit. Ties go to the lowest user id.
+std::optional<int> DmClockScheduler::pick_user(double now) {
+    if (backlog_ == 0) return std::nullopt;
+
+    const VTag now_tag = time_tag(now);
+    int best_r = -1, best_p = -1;
+    VTag best_r_tag = kNever, best_p_tag = kNever;
+    for (int uid = 0; uid < static_cast<int>(hot_.size()); ++uid) {
+        const Hot& h = hot_[uid];
+        if (h.head_idx == kNilIndex) continue;
+        if (h.head.r <= now_tag && h.head.r < best_r_tag) {
+            best_r_tag = h.head.r;
+            best_r = uid;
+        }
+        if (h.head.l <= now_tag && (best_p < 0 || h.head.p < best_p_tag)) {
+            best_p_tag = h.head.p;
+            best_p = uid;
+        }
+    }
+    picked_reserved_ = best_r >= 0;
+    picked_ = picked_reserved_ ? best_r : best_p;
+    if (picked_ < 0) return std::nullopt;
+    return picked_;
+}
+
+// pop hands out |uid|'s head. A head served in the weight phase doesn't count
+// toward the reservation, so its size comes back off the R tag.
+std::optional<Request> DmClockScheduler::pop(int uid) {
+    if (uid < 0 || uid >= static_cast<int>(hot_.size()) || hot_[uid].head_idx == kNilIndex)
+        return std::nullopt;
+    Hot& h = hot_[uid];
+    Cold& c = cold_[uid];
+    bool reserved = uid == picked_ && picked_reserved_;
+    picked_ = -1;
+
+    VTag p = h.head.p;
+    Request r = pool_.pop(h.head_idx, h.tail_idx);
+    r.qos_reserved = reserved;
+    if (reserved) {
+        c.reserved_bytes += r.size_bytes;
+    } else {
+        vtime_ = std::max(vtime_, p);
+        if (c.reserves) {
+            VTag step = c.reservation.cost(r.size_bytes);
+            c.last.r = c.last.r > step ? c.last.r - step : 0;
+        }
+    }
+    if (h.head_idx != kNilIndex) tag_head(uid);
+    c.served_bytes += r.size_bytes;
+    --backlog_;
+    return r;
+}
+
+// next_wakeup only matters when every queued head is over its limit; then
+// the earliest of their L tags and due reservations releases one.
+double DmClockScheduler::next_wakeup(double now) const {
+    const VTag now_tag = time_tag(now);
+    VTag next = kNever;
+    for (const Hot& h : hot_) {
+        if (h.head_idx == kNilIndex) continue;
+        if (h.head.l <= now_tag) return kInf;
+        next = std::min(next, h.head.l);
+        if (h.head.r > now_tag) next = std::min(next, h.head.r);
+    }
+    // One unit past the tag so that the wakeup converts back to at least it.
+    return next == kNever ? kInf : tag_seconds(next + 1);
+}
+
+DmClockTracker::DmClockTracker(int tenants, int devices)
+    : devices_(std::max(devices, 1)),
+      global_(std::max(tenants, 0)),
+      links_(global_.size() * devices_) {}
+
+void DmClockTracker::on_complete(int device, const Request& r) {
+    if (r.user_id < 0 || r.user_id >= static_cast<int>(global_.size()) ||
+        device < 0 || device >= devices_)
+        return;
+    Counters& g = global_[r.user_id];
+    Counters& local = links_[static_cast<size_t>(r.user_id) * devices_ + device].local;
+    g.done += r.size_bytes;
+    local.done += r.size_bytes;
+    if (r.qos_reserved) {
+        g.reserved += r.size_bytes;
+        local.reserved += r.size_bytes;
+    }
+}
+
+std::pair<uint64_t, uint64_t> DmClockTracker::next(int device, int user) {
+    if (user < 0 || user >= static_cast<int>(global_.size()) || device < 0 || device >= devices_)
+        return { 0, 0 };
+    const Counters& g = global_[user];
+    Link& k = links_[static_cast<size_t>(user) * devices_ + device];
+    uint64_t delta = (g.done - k.seen_global.done) - (k.local.done - k.seen_local.done);
+    uint64_t rho = (g.reserved - k.seen_global.reserved) - (k.local.reserved - k.seen_local.reserved);
+    k.seen_global = g;
+    k.seen_local = k.local;
+    return { delta, rho };
+}
+
+} // namespace ssd
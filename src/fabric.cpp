@@ -0,0 +1,178 @@
+#include "fabric.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr double kBytesPerMB = 1024.0 * 1024.0;
+
+} // namespace
+
+namespace ssd {
+
+FabricConfig fabric_preset(const std::string& transport) {
+    FabricConfig cfg;
+    if (transport == "rdma") {
+        // 100 Gb/s RoCE/InfiniBand: wide link, kernel-bypass capsules.
+        cfg.link_MBps = 12000.0;
+        cfg.capsule_overhead_s = 3e-6;
+        cfg.queue_depth = 128;
+    } else {
+        // 25 GbE NVMe/TCP: PDU processing dominates small commands.
+        cfg.link_MBps = 3000.0;
+        cfg.capsule_overhead_s = 15e-6;
+        cfg.queue_depth = 32;
+    }
+    return cfg;
+}
+
+FabricSimulator::FabricSimulator(const FabricConfig& cfg,
+                                 const SchedulerFactory& make_scheduler,
+                                 int num_users, const std::vector<double>& weights,
+                                 SSD& device, Metrics& metrics)
+    : cfg_(cfg), device_(device), metrics_(metrics) {
+    cfg_.num_hosts = std::max(cfg_.num_hosts, 1);
+    cfg_.queue_depth = std::max(cfg_.queue_depth, 1);
+    if (cfg_.link_MBps > 0.0) link_s_per_byte_ = 1.0 / (cfg_.link_MBps * kBytesPerMB);
+
+    hosts_.resize(cfg_.num_hosts);
+    stats_.assign(cfg_.num_hosts, {});
+    for (auto& host : hosts_) {
+        host.scheduler = make_scheduler();
+        host.scheduler->set_users(num_users);
+        if (!weights.empty()) host.scheduler->set_weights(weights);
+    }
+}
+
+int FabricSimulator::host_of(int user_id) const {
+    return std::max(user_id, 0) % cfg_.num_hosts;
+}
+
+double FabricSimulator::wire_time(uint32_t payload_bytes) const {
+    return static_cast<double>(cfg_.capsule_bytes + payload_bytes) * link_s_per_byte_;
+}
+
+// dispatch_hosts lets every host issue commands until its connection is full.
+// Write data travels with the command capsule (in-capsule / R2T collapsed).
+void FabricSimulator::dispatch_hosts(double now) {
+    for (int h = 0; h < cfg_.num_hosts; ++h) {
+        Host& host = hosts_[h];
+        while (host.inflight < cfg_.queue_depth) {
+            auto uid = host.scheduler->pick_user(now);
+            if (!uid) break;
+            auto req = host.scheduler->pop(*uid);
+            if (!req) break;
+
+            req->start_ts = now;
+            uint32_t payload = req->op == OpType::WRITE ? req->size_bytes : 0;
+            double tx_start = std::max(now, host.tx_free_at);
+            host.tx_free_at = tx_start + wire_time(payload);
+            double arrival = host.tx_free_at + cfg_.capsule_overhead_s;
+
+            ++host.inflight;
+            stats_[h].max_inflight = std::max(stats_[h].max_inflight, host.inflight);
+            events_.push({ arrival, EventKind::TargetArrival, h, *req, now });
+        }
+    }
+}
+
+// dispatch_target arbitrates among per-connection submission queues whenever
+// an SSD channel is free: round-robin across connections, or global FIFO by
+// capsule arrival time.
+void FabricSimulator::dispatch_target(double now) {
+    while (true) {
+        int chan = device_.first_free_channel(now);
+        if (chan < 0) return;
+
+        int chosen = -1;
+        if (cfg_.arbitration == "fifo") {
+            double oldest = std::numeric_limits<double>::infinity();
+            for (int h = 0; h < cfg_.num_hosts; ++h) {
+                const auto& q = hosts_[h].target_queue;
+                if (!q.empty() && q.front().arrived_at < oldest) {
+                    oldest = q.front().arrived_at;
+                    chosen = h;
+                }
+            }
+        } else {
+            for (int i = 0; i < cfg_.num_hosts; ++i) {
+                int h = (next_target_host_ + i) % cfg_.num_hosts;
+                if (!hosts_[h].target_queue.empty()) {
+                    chosen = h;
+                    next_target_host_ = (h + 1) % cfg_.num_hosts;
+                    break;
+                }
+            }
+        }
+        if (chosen < 0) return;
+
+        PendingCommand cmd = hosts_[chosen].target_queue.front();
+        hosts_[chosen].target_queue.pop_front();
+        stats_[chosen].target_wait_s += now - cmd.arrived_at;
+
+        double done = device_.dispatch(chan, cmd.request, now);
+        events_.push({ done, EventKind::DeviceComplete, chosen, cmd.request, now });
+    }
+}
+
+void FabricSimulator::handle(const FabricEvent& ev) {
+    Host& host = hosts_[ev.host];
+    HostFabricStats& st = stats_[ev.host];
+    switch (ev.kind) {
+    case EventKind::TargetArrival:
+        st.link_s += ev.time - ev.stamp;
+        host.target_queue.push_back({ ev.request, ev.time });
+        break;
+    case EventKind::DeviceComplete: {
+        st.device_s += ev.time - ev.stamp;
+        uint32_t payload = ev.request.op == OpType::READ ? ev.request.size_bytes : 0;
+        double rx_start = std::max(ev.time, host.rx_free_at);
+        host.rx_free_at = rx_start + wire_time(payload);
+        double done = host.rx_free_at + cfg_.capsule_overhead_s;
+        events_.push({ done, EventKind::HostComplete, ev.host, ev.request, ev.time });
+        break;
+    }
+    case EventKind::HostComplete: {
+        st.link_s += ev.time - ev.stamp;
+        st.completed += 1;
+        --host.inflight;
+        Request done = ev.request;
+        done.finish_ts = ev.time;
+        metrics_.on_finish(done);
+        break;
+    }
+    }
+}
+
+void FabricSimulator::run(const std::vector<Request>& trace) {
+    size_t i = 0;
+    double now = 0.0;
+    while (true) {
+        while (i < trace.size() && trace[i].arrival_ts <= now) {
+            hosts_[host_of(trace[i].user_id)].scheduler->enqueue(trace[i]);
+            ++i;
+        }
+
+        dispatch_hosts(now);
+        dispatch_target(now);
+
+        double next = std::numeric_limits<double>::infinity();
+        if (!events_.empty()) next = events_.top().time;
+        if (i < trace.size()) next = std::min(next, trace[i].arrival_ts);
+        for (const auto& host : hosts_) {
+            double wake = host.scheduler->next_wakeup(now);
+            if (wake > now) next = std::min(next, wake);
+        }
+        if (next == std::numeric_limits<double>::infinity()) break;
+
+        now = std::max(now, next);
+        while (!events_.empty() && events_.top().time <= now) {
+            FabricEvent ev = events_.top();
+            events_.pop();
+            handle(ev);
+        }
+    }
+}
+
+} // namespace ssd
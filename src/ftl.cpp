@@ -0,0 +1,696 @@
+#include "ftl.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace ssd {
+
+Ftl::Ftl(const FtlConfig& cfg, int num_users) : cfg_(cfg) {
+    cfg_.page_bytes = std::max<uint32_t>(cfg_.page_bytes, 512);
+    cfg_.pages_per_block = std::max<uint32_t>(cfg_.pages_per_block, 1);
+    cfg_.gc_threshold_blocks = std::max<uint32_t>(cfg_.gc_threshold_blocks, 2);
+    cfg_.over_provisioning = std::max(cfg_.over_provisioning, 0.0);
+    if (cfg_.namespaces.empty())
+        cfg_.namespaces.push_back({ 1.0, cfg_.over_provisioning, GcPolicy::Greedy });
+    if (cfg_.namespaces.size() > UINT16_MAX)
+        throw std::invalid_argument("Too many FTL namespaces");
+    for (const auto& ns : cfg_.namespaces)
+        if (!(ns.share > 0.0) || !(ns.over_provisioning >= 0.0))
+            throw std::invalid_argument("FTL namespace needs a positive share and non-negative OP");
+    for (int ns : cfg_.tenant_namespace)
+        if (ns >= static_cast<int>(cfg_.namespaces.size()))
+            throw std::invalid_argument("Tenant mapped to an undefined FTL namespace");
+
+    const uint64_t ppb = cfg_.pages_per_block;
+    uint64_t num_blocks = cfg_.physical_bytes / cfg_.page_bytes / ppb;
+    if (num_blocks * ppb >= kNone)
+        throw std::invalid_argument("FTL capacity exceeds 32-bit page addressing");
+    blocks_.assign(num_blocks, {});
+    layout(num_blocks);
+
+    l2p_.assign(logical_pages_, kNone);
+    p2l_.assign(num_blocks * ppb, kNone);
+    owner_.assign(logical_pages_, -1);
+    wear_.assign(std::max(num_users, 0), {});
+    rebuild_from_mapping();
+
+    if (!cfg_.snapshot_path.empty())
+        load_snapshot(cfg_.snapshot_path);
+    else if (cfg_.precondition != Precondition::None)
+        precondition(cfg_.precondition, cfg_.precondition_fill, cfg_.precondition_seed);
+}
+
+// layout sizes the namespaces and their block pools. Shared blocks give every
+// namespace its share of the physical pages divided by (1 + OP), all drawing
+// on one pool; partitioned blocks split the blocks by share first, and each
+// pool then exports its own blocks over (1 + OP). Either way relocation needs
+// spare blocks beyond the GC threshold in every pool to make progress.
+void Ftl::layout(uint64_t num_blocks) {
+    const uint64_t ppb = cfg_.pages_per_block;
+    const uint64_t reserve_blocks = cfg_.gc_threshold_blocks + 2;
+    const auto& spec = cfg_.namespaces;
+    double total_share = 0.0;
+    for (const auto& ns : spec) total_share += ns.share;
+
+    namespaces_.assign(spec.size(), {});
+    for (size_t i = 0; i < spec.size(); ++i) namespaces_[i].gc = spec[i].gc;
+
+    if (!cfg_.partition_blocks || spec.size() == 1) {
+        if (num_blocks <= reserve_blocks)
+            throw std::invalid_argument("FTL capacity too small for its GC reserve");
+        uint64_t physical_pages = num_blocks * ppb;
+        uint64_t cap = (num_blocks - reserve_blocks) * ppb;
+        uint64_t total = 0;
+        for (size_t i = 0; i < spec.size(); ++i) {
+            namespaces_[i].logical_pages = static_cast<uint64_t>(
+                static_cast<double>(physical_pages) * (spec[i].share / total_share) /
+                (1.0 + spec[i].over_provisioning));
+            total += namespaces_[i].logical_pages;
+        }
+        for (auto& ns : namespaces_) {
+            if (total > cap) ns.logical_pages = ns.logical_pages * cap / total;
+            ns.logical_pages = std::max<uint64_t>(ns.logical_pages, 1);
+        }
+        pools_.assign(1, {});
+        pools_[0].num_blocks = static_cast<uint32_t>(num_blocks);
+    } else {
+        pools_.assign(spec.size(), {});
+        uint64_t assigned = 0;
+        for (size_t i = 0; i < spec.size(); ++i) {
+            pools_[i].num_blocks = static_cast<uint32_t>(
+                static_cast<double>(num_blocks) * (spec[i].share / total_share));
+            assigned += pools_[i].num_blocks;
+        }
+        // Rounding leftovers go to the first namespaces, one block each.
+        for (size_t i = 0; assigned < num_blocks; i = (i + 1) % spec.size(), ++assigned)
+            ++pools_[i].num_blocks;
+        for (size_t i = 0; i < spec.size(); ++i) {
+            uint64_t nb = pools_[i].num_blocks;
+            if (nb <= reserve_blocks)
+                throw std::invalid_argument("FTL namespace " + std::to_string(i) +
+                                            " too small for its GC reserve");
+            uint64_t logical = static_cast<uint64_t>(
+                static_cast<double>(nb * ppb) / (1.0 + spec[i].over_provisioning));
+            logical = std::min(logical, (nb - reserve_blocks) * ppb);
+            namespaces_[i].logical_pages = std::max<uint64_t>(logical, 1);
+            namespaces_[i].pool = static_cast<uint16_t>(i);
+        }
+    }
+
+    logical_pages_ = 0;
+    for (auto& ns : namespaces_) {
+        ns.first_lpn = logical_pages_;
+        logical_pages_ += ns.logical_pages;
+    }
+    uint32_t first_block = 0;
+    for (uint16_t p = 0; p < pools_.size(); ++p) {
+        Pool& pool = pools_[p];
+        pool.first_block = first_block;
+        first_block += pool.num_blocks;
+        pool.buckets.assign(ppb + 1, kNone);
+        for (uint32_t b = pool.first_block; b < first_block; ++b) blocks_[b].pool = p;
+    }
+    for (const auto& ns : namespaces_) {
+        Pool& pool = pools_[ns.pool];
+        if (pool.logical_pages == 0) pool.first_lpn = ns.first_lpn;
+        pool.logical_pages += ns.logical_pages;
+        if (ns.gc == GcPolicy::Fifo) pool.track_seal_order = true;
+    }
+}
+
+uint16_t Ftl::namespace_of(int user_id) const {
+    const int count = num_namespaces();
+    if (user_id < 0) return 0;
+    if (user_id < static_cast<int>(cfg_.tenant_namespace.size()) &&
+        cfg_.tenant_namespace[user_id] >= 0)
+        return static_cast<uint16_t>(cfg_.tenant_namespace[user_id]);
+    return static_cast<uint16_t>(user_id % count);
+}
+
+// namespace_of_lpn finds the namespace whose range holds |lpn|.
+uint16_t Ftl::namespace_of_lpn(uint32_t lpn) const {
+    if (namespaces_.size() == 1) return 0;
+    auto it = std::upper_bound(namespaces_.begin(), namespaces_.end(), lpn,
+                               [](uint32_t v, const Namespace& ns) { return v < ns.first_lpn; });
+    return static_cast<uint16_t>(it - namespaces_.begin() - 1);
+}
+
+namespace {
+
+// greedy_victim_valid returns the valid fraction |a| of the block greedy GC
+// reclaims once uniform random overwrites of |logical| pages on |physical|
+// pages of sealed blocks reach steady state. A page survives t host writes
+// with probability exp(-t/logical); blocks are sealed at a constant rate, so
+// the victim has aged T = physical * (1 - a) writes, which gives
+// a = exp(-(physical / logical) * (1 - a)). For many pages per block greedy
+// and FIFO cleaning converge to this fixed point (mean-field analysis of
+// garbage collection, Van Houdt 2013); WAF is 1 / (1 - a).
+double greedy_victim_valid(double physical, double logical) {
+    double alpha = physical / logical;
+    if (alpha <= 1.0 + 1e-9) return 1.0;
+    double lo = 0.0, hi = 1.0 - 1e-9;
+    for (int i = 0; i < 100; ++i) {
+        double mid = 0.5 * (lo + hi);
+        if (mid - std::exp(-alpha * (1.0 - mid)) < 0.0)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+constexpr char kSnapshotMagic[8] = { 'S', 'S', 'D', 'F', 'T', 'L', 'S', '2' };
+// Snapshots from before namespaces hold a single shared pool.
+constexpr char kSnapshotMagicV1[8] = { 'S', 'S', 'D', 'F', 'T', 'L', 'S', '1' };
+
+} // namespace
+
+// precondition lays the mapped pages of each pool out block by block and
+// leaves gc_threshold_blocks + 1 of its blocks free: the first block the host
+// opens brings the pool down to the threshold and the next one already has to
+// collect, as on an aged drive.
+void Ftl::precondition(Precondition pattern, double fill, uint64_t seed) {
+    std::fill(l2p_.begin(), l2p_.end(), kNone);
+    std::fill(p2l_.begin(), p2l_.end(), kNone);
+    std::fill(owner_.begin(), owner_.end(), -1);
+    std::mt19937_64 rng(seed);
+    for (Pool& pool : pools_) precondition_pool(pool, pattern, fill, rng);
+    rebuild_from_mapping();
+}
+
+void Ftl::precondition_pool(Pool& pool, Precondition pattern, double fill, std::mt19937_64& rng) {
+    const uint32_t ppb = cfg_.pages_per_block;
+    const uint32_t nb = pool.num_blocks;
+    const uint64_t logical = pool.logical_pages;
+    uint64_t mapped = static_cast<uint64_t>(
+        std::clamp(fill, 0.0, 1.0) * static_cast<double>(logical) + 0.5);
+    mapped = std::min(mapped, logical);
+
+    pool.active[kHostStream] = pool.active[kRelocStream] = kNone;
+    uint32_t sealed = pattern == Precondition::None ? 0 : nb - (cfg_.gc_threshold_blocks + 1);
+    for (uint32_t i = 0; i < nb; ++i) {
+        Block& blk = blocks_[pool.first_block + i];
+        blk.state = i < sealed ? BlockState::Sealed : BlockState::Free;
+        blk.write_ptr = i < sealed ? ppb : 0;
+    }
+
+    // Valid pages per sealed block, oldest last. Sequential overwrites leave
+    // whole blocks valid; random ones decay with block age as a^(age / T).
+    std::vector<uint32_t> valid(sealed, 0);
+    if (pattern == Precondition::Sequential) {
+        uint64_t left = mapped;
+        for (uint32_t i = 0; i < sealed && left > 0; ++i) {
+            valid[i] = static_cast<uint32_t>(std::min<uint64_t>(left, ppb));
+            left -= valid[i];
+        }
+    } else if (pattern == Precondition::Random && mapped > 0) {
+        double a = greedy_victim_valid(static_cast<double>(sealed) * ppb,
+                                       static_cast<double>(mapped));
+        std::vector<double> want(sealed);
+        double total = 0.0;
+        for (uint32_t i = 0; i < sealed; ++i) {
+            want[i] = ppb * std::pow(a, (i + 0.5) / sealed);
+            total += want[i];
+        }
+        // Round cumulatively so the counts add up to |mapped| exactly.
+        double scale = static_cast<double>(mapped) / total;
+        uint64_t placed = 0;
+        double cumulative = 0.0;
+        for (uint32_t i = 0; i < sealed; ++i) {
+            cumulative += want[i] * scale;
+            uint64_t upto = std::min<uint64_t>(static_cast<uint64_t>(cumulative + 0.5), mapped);
+            valid[i] = static_cast<uint32_t>(std::min<uint64_t>(upto - placed, ppb));
+            placed += valid[i];
+        }
+        for (uint32_t i = 0; i < sealed && placed < mapped; ++i) {
+            uint32_t room = static_cast<uint32_t>(std::min<uint64_t>(ppb - valid[i], mapped - placed));
+            valid[i] += room;
+            placed += room;
+        }
+    }
+
+    // Random data lands on a uniformly chosen set of logical pages in random
+    // order; sequential data is the first |mapped| pages in order.
+    std::vector<uint32_t> lpns(logical);
+    std::iota(lpns.begin(), lpns.end(), static_cast<uint32_t>(pool.first_lpn));
+    if (pattern == Precondition::Random) {
+        for (uint64_t i = 0; i < mapped; ++i) {
+            uint64_t j = i + rng() % (logical - i);
+            std::swap(lpns[i], lpns[j]);
+        }
+    }
+    uint64_t next = 0;
+    for (uint32_t i = 0; i < sealed; ++i) {
+        uint32_t base = (pool.first_block + i) * ppb;
+        for (uint32_t k = 0; k < valid[i]; ++k) {
+            uint32_t lpn = lpns[next++];
+            p2l_[base + k] = lpn;
+            l2p_[lpn] = base + k;
+        }
+    }
+}
+
+// rebuild_from_mapping recomputes everything derived from p2l_ and the block
+// states: valid counts, GC buckets, seal order and the free pools. Seal order
+// isn't stored, so it is taken to follow the precondition layout, which puts
+// the oldest blocks last.
+void Ftl::rebuild_from_mapping() {
+    const uint32_t ppb = cfg_.pages_per_block;
+    for (Pool& pool : pools_) {
+        std::fill(pool.buckets.begin(), pool.buckets.end(), kNone);
+        pool.min_bucket = 0;
+        pool.free_fifo.clear();
+        pool.free_by_wear = {};
+        pool.free_count = 0;
+        pool.sealed.clear();
+    }
+    max_erase_ = 0;
+    for (uint32_t b = 0; b < blocks_.size(); ++b) {
+        Block& blk = blocks_[b];
+        Pool& pool = pools_[blk.pool];
+        blk.valid = 0;
+        blk.prev = blk.next = kNone;
+        for (uint32_t i = 0; i < blk.write_ptr; ++i)
+            if (p2l_[b * ppb + i] != kNone) ++blk.valid;
+        max_erase_ = std::max(max_erase_, blk.erase_count);
+        if (blk.state == BlockState::Sealed) {
+            bucket_insert(b);
+        } else if (blk.state == BlockState::Free) {
+            if (cfg_.wear_leveling == WearLeveling::None)
+                pool.free_fifo.push_back(b);
+            else
+                pool.free_by_wear.emplace(blk.erase_count, b);
+            ++pool.free_count;
+        }
+    }
+    for (Pool& pool : pools_) {
+        if (!pool.track_seal_order) continue;
+        for (uint32_t b = pool.first_block + pool.num_blocks; b-- > pool.first_block;)
+            if (blocks_[b].state == BlockState::Sealed)
+                pool.sealed.emplace_back(b, blocks_[b].erase_count);
+    }
+}
+
+// A snapshot is the geometry (to refuse a mismatched device), each pool's
+// size and open blocks, per-block erase count / write pointer / state, and
+// then l2p_ and owner_; p2l_ and everything else is rebuilt on load.
+void Ftl::save_snapshot(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("Cannot create FTL snapshot: " + path);
+    auto put = [&](const auto& v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+    out.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+    put(cfg_.page_bytes);
+    put(cfg_.pages_per_block);
+    put(num_blocks());
+    put(logical_pages_);
+    put(static_cast<uint32_t>(pools_.size()));
+    for (const Pool& pool : pools_) {
+        put(pool.num_blocks);
+        put(pool.logical_pages);
+        put(pool.active[kHostStream]);
+        put(pool.active[kRelocStream]);
+    }
+    for (const Block& blk : blocks_) {
+        put(blk.erase_count);
+        put(blk.write_ptr);
+        put(blk.state);
+    }
+    out.write(reinterpret_cast<const char*>(l2p_.data()), l2p_.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(owner_.data()), owner_.size() * sizeof(int32_t));
+    if (!out) throw std::runtime_error("Failed writing FTL snapshot: " + path);
+}
+
+void Ftl::load_snapshot(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("Cannot open FTL snapshot: " + path);
+    auto get = [&](auto& v) { in.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+    char magic[sizeof(kSnapshotMagic)] = {};
+    uint32_t page_bytes = 0, ppb = 0, nb = 0;
+    uint64_t logical = 0;
+    in.read(magic, sizeof(magic));
+    get(page_bytes);
+    get(ppb);
+    get(nb);
+    get(logical);
+    bool v1 = std::memcmp(magic, kSnapshotMagicV1, sizeof(magic)) == 0;
+    if (!in || (!v1 && std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0))
+        throw std::runtime_error("Not an FTL snapshot: " + path);
+    uint32_t pools = 1;
+    if (!v1) get(pools);
+    if (page_bytes != cfg_.page_bytes || ppb != cfg_.pages_per_block || nb != num_blocks() ||
+        logical != logical_pages_ || pools != pools_.size())
+        throw std::runtime_error("FTL snapshot geometry doesn't match this device: " + path);
+
+    for (Pool& pool : pools_) {
+        uint32_t pool_blocks = pool.num_blocks;
+        uint64_t pool_logical = pool.logical_pages;
+        if (!v1) {
+            get(pool_blocks);
+            get(pool_logical);
+        }
+        if (pool_blocks != pool.num_blocks || pool_logical != pool.logical_pages)
+            throw std::runtime_error("FTL snapshot geometry doesn't match this device: " + path);
+        get(pool.active[kHostStream]);
+        get(pool.active[kRelocStream]);
+    }
+    for (Block& blk : blocks_) {
+        get(blk.erase_count);
+        get(blk.write_ptr);
+        get(blk.state);
+    }
+    in.read(reinterpret_cast<char*>(l2p_.data()), l2p_.size() * sizeof(uint32_t));
+    in.read(reinterpret_cast<char*>(owner_.data()), owner_.size() * sizeof(int32_t));
+    if (!in) throw std::runtime_error("Truncated FTL snapshot: " + path);
+
+    // Every field indexes something during the rebuild or later GC, so all of
+    // them are checked before anything trusts them. An open block must be the
+    // active block of exactly one stream, or nothing would fill and seal it.
+    for (const Block& blk : blocks_)
+        if (blk.write_ptr > ppb ||
+            static_cast<uint8_t>(blk.state) > static_cast<uint8_t>(BlockState::Sealed))
+            throw std::runtime_error("Corrupt FTL snapshot: " + path);
+    size_t active_blocks = 0;
+    for (const Pool& pool : pools_)
+        for (uint32_t b : pool.active) {
+            if (b == kNone) continue;
+            if (b < pool.first_block || b >= pool.first_block + pool.num_blocks ||
+                blocks_[b].state != BlockState::Open)
+                throw std::runtime_error("Corrupt FTL snapshot: " + path);
+            ++active_blocks;
+        }
+    size_t open_blocks = 0;
+    for (const Block& blk : blocks_) open_blocks += blk.state == BlockState::Open;
+    if (open_blocks != active_blocks)
+        throw std::runtime_error("Corrupt FTL snapshot: " + path);
+    // Owners index the per-tenant wear table, which grows to fit any ID.
+    const int32_t tenants = static_cast<int32_t>(wear_.size());
+    for (int32_t owner : owner_)
+        if (owner < -1 || owner >= tenants)
+            throw std::runtime_error("Corrupt FTL snapshot: " + path);
+
+    std::fill(p2l_.begin(), p2l_.end(), kNone);
+    for (uint32_t lpn = 0; lpn < l2p_.size(); ++lpn) {
+        uint32_t ppn = l2p_[lpn];
+        if (ppn == kNone) continue;
+        if (ppn >= p2l_.size() || blocks_[ppn / ppb].write_ptr <= ppn % ppb ||
+            p2l_[ppn] != kNone)
+            throw std::runtime_error("Corrupt FTL snapshot: " + path);
+        const Pool& pool = pools_[blocks_[ppn / ppb].pool];
+        if (lpn < pool.first_lpn || lpn >= pool.first_lpn + pool.logical_pages)
+            throw std::runtime_error("Corrupt FTL snapshot: " + path);
+        p2l_[ppn] = lpn;
+    }
+    rebuild_from_mapping();
+}
+
+FtlWork Ftl::write(int user_id, uint64_t address, uint32_t bytes, uint16_t nsid) {
+    FtlWork work;
+    uint64_t first = address / cfg_.page_bytes;
+    uint64_t last = (address + std::max<uint32_t>(bytes, 1) - 1) / cfg_.page_bytes;
+    TenantWear& tw = wear_for(user_id);
+    writer_ns_ = static_cast<uint16_t>(nsid % namespaces_.size());
+    Namespace& ns = namespaces_[writer_ns_];
+    Pool& pool = pools_[ns.pool];
+
+    for (uint64_t page = first; page <= last; ++page) {
+        uint32_t lpn = static_cast<uint32_t>(ns.first_lpn + page % ns.logical_pages);
+        if (l2p_[lpn] != kNone) invalidate(l2p_[lpn]);
+        owner_[lpn] = user_id;
+        program(lpn, pool, kHostStream, work);
+        ++work.host_pages;
+        ++host_pages_;
+        ++tw.host_pages;
+        ++ns.stats.host_pages;
+    }
+    return work;
+}
+
+double Ftl::background_time_s(const FtlWork& work) const {
+    double copies = static_cast<double>(work.gc_copies + work.wl_copies);
+    return copies * (cfg_.page_read_s + cfg_.page_program_s) +
+           static_cast<double>(work.erases) * cfg_.block_erase_s;
+}
+
+// program appends |lpn| to |pool|'s open block of |stream|, opening (and
+// possibly garbage collecting for) a fresh block when needed. Full blocks are
+// sealed immediately so they become GC candidates.
+uint32_t Ftl::program(uint32_t lpn, Pool& pool, Stream stream, FtlWork& work) {
+    if (pool.active[stream] == kNone) open_block(pool, stream, work);
+    uint32_t b = pool.active[stream];
+    Block& blk = blocks_[b];
+    uint32_t ppn = b * cfg_.pages_per_block + blk.write_ptr++;
+    p2l_[ppn] = lpn;
+    l2p_[lpn] = ppn;
+    ++blk.valid;
+    if (blk.write_ptr == cfg_.pages_per_block) {
+        seal(b);
+        pool.active[stream] = kNone;
+    }
+    return ppn;
+}
+
+void Ftl::invalidate(uint32_t ppn) {
+    uint32_t b = ppn / cfg_.pages_per_block;
+    p2l_[ppn] = kNone;
+    if (blocks_[b].state == BlockState::Sealed) {
+        bucket_remove(b);
+        --blocks_[b].valid;
+        bucket_insert(b);
+    } else {
+        --blocks_[b].valid;
+    }
+}
+
+// open_block runs foreground GC while |pool|'s free blocks are at or below
+// the threshold. Relocation itself never triggers GC (in_gc_), relying on the
+// reserve kept by layout().
+void Ftl::open_block(Pool& pool, Stream stream, FtlWork& work) {
+    // A single collect may free no block on net when its copies open a new
+    // relocation block, so keep going until a victim can't be found.
+    while (!in_gc_ && pool.free_count <= cfg_.gc_threshold_blocks) {
+        if (!collect(pool, work)) break;  // nothing reclaimable
+    }
+    uint32_t b = take_free_block(pool);
+    blocks_[b].state = BlockState::Open;
+    pool.active[stream] = b;
+}
+
+// seal makes |block| a GC candidate. Pools that keep seal order drop the
+// entries of since-erased blocks whenever the log doubles the pool's size.
+void Ftl::seal(uint32_t block) {
+    Block& blk = blocks_[block];
+    blk.state = BlockState::Sealed;
+    bucket_insert(block);
+    Pool& pool = pools_[blk.pool];
+    if (!pool.track_seal_order) return;
+    pool.sealed.emplace_back(block, blk.erase_count);
+    if (pool.sealed.size() > 2 * static_cast<size_t>(pool.num_blocks)) {
+        auto stale = [&](const std::pair<uint32_t, uint32_t>& e) {
+            return blocks_[e.first].state != BlockState::Sealed ||
+                   blocks_[e.first].erase_count != e.second;
+        };
+        pool.sealed.erase(std::remove_if(pool.sealed.begin(), pool.sealed.end(), stale),
+                          pool.sealed.end());
+    }
+}
+
+uint32_t Ftl::take_free_block(Pool& pool) {
+    if (pool.free_count == 0) throw std::runtime_error("FTL ran out of free blocks");
+    uint32_t b;
+    if (cfg_.wear_leveling == WearLeveling::None) {
+        b = pool.free_fifo.front();
+        pool.free_fifo.pop_front();
+    } else {
+        // Dynamic wear leveling: hand out the least-erased free block.
+        b = pool.free_by_wear.top().second;
+        pool.free_by_wear.pop();
+    }
+    --pool.free_count;
+    return b;
+}
+
+void Ftl::release_block(uint32_t block) {
+    Block& blk = blocks_[block];
+    Pool& pool = pools_[blk.pool];
+    blk.state = BlockState::Free;
+    blk.valid = 0;
+    blk.write_ptr = 0;
+    ++blk.erase_count;
+    ++total_erases_;
+    max_erase_ = std::max(max_erase_, blk.erase_count);
+    if (cfg_.wear_leveling == WearLeveling::None)
+        pool.free_fifo.push_back(block);
+    else
+        pool.free_by_wear.emplace(blk.erase_count, block);
+    ++pool.free_count;
+}
+
+// collect reclaims a sealed block of |pool|: the one with the fewest valid
+// pages (greedy), or the longest-sealed one that has any stale page (FIFO),
+// as the namespace whose write ran out of space asks. Returns false when
+// every sealed block is fully valid.
+bool Ftl::collect(Pool& pool, FtlWork& work) {
+    uint32_t victim = kNone;
+    if (namespaces_[writer_ns_].gc == GcPolicy::Fifo) {
+        victim = oldest_sealed(pool);
+    } else {
+        for (uint32_t v = pool.min_bucket; v < cfg_.pages_per_block; ++v) {
+            if (pool.buckets[v] != kNone) {
+                victim = pool.buckets[v];
+                pool.min_bucket = v;
+                break;
+            }
+        }
+    }
+    if (victim == kNone) return false;
+
+    in_gc_ = true;
+    relocate(victim, false, work);
+    in_gc_ = false;
+    maybe_static_wear_level(pool, work);
+    return true;
+}
+
+// oldest_sealed pops the longest-sealed block of |pool| with a stale page,
+// dropping entries of blocks erased since they were logged and rotating fully
+// valid ones to the back. Returns kNone when no sealed block qualifies.
+uint32_t Ftl::oldest_sealed(Pool& pool) {
+    for (size_t left = pool.sealed.size(); left > 0; --left) {
+        auto [b, erases] = pool.sealed.front();
+        pool.sealed.pop_front();
+        const Block& blk = blocks_[b];
+        if (blk.state != BlockState::Sealed || blk.erase_count != erases) continue;
+        if (blk.valid < cfg_.pages_per_block) return b;
+        pool.sealed.emplace_back(b, erases);
+    }
+    return kNone;
+}
+
+// relocate copies every valid page of |block| to its pool's relocation
+// stream, charging the copies to the owners of the data and to the namespace
+// whose write triggered them, then erases the block.
+void Ftl::relocate(uint32_t block, bool for_wear_leveling, FtlWork& work) {
+    Pool& pool = pools_[blocks_[block].pool];
+    NamespaceStats& trigger = namespaces_[writer_ns_].stats;
+    bucket_remove(block);
+    blocks_[block].state = BlockState::Open;  // keep it out of the buckets
+    uint32_t base = block * cfg_.pages_per_block;
+    for (uint32_t i = 0; i < cfg_.pages_per_block; ++i) {
+        uint32_t lpn = p2l_[base + i];
+        if (lpn == kNone) continue;
+        p2l_[base + i] = kNone;
+        --blocks_[block].valid;
+        program(lpn, pool, kRelocStream, work);
+
+        TenantWear& tw = wear_for(owner_[lpn]);
+        if (for_wear_leveling) {
+            ++work.wl_copies;
+            ++wl_pages_;
+            ++tw.wl_pages;
+        } else {
+            ++work.gc_copies;
+            ++gc_pages_;
+            ++tw.gc_pages;
+        }
+        uint16_t owner_ns = namespace_of_lpn(lpn);
+        ++namespaces_[owner_ns].stats.relocated_pages;
+        ++trigger.triggered_copies;
+        if (owner_ns != writer_ns_) ++trigger.foreign_copies;
+    }
+    release_block(block);
+    ++work.erases;
+    ++trigger.triggered_erases;
+}
+
+// maybe_static_wear_level moves the coldest sealed block of |pool| once the
+// erase-count spread exceeds the configured gap, so its low-wear block rejoins
+// the free pool. The O(pool blocks) scan runs at most once per 16 erases.
+void Ftl::maybe_static_wear_level(Pool& pool, FtlWork& work) {
+    if (cfg_.wear_leveling != WearLeveling::Static) return;
+    if (++erases_since_wl_check_ < 16) return;
+    erases_since_wl_check_ = 0;
+
+    uint32_t coldest = kNone;
+    for (uint32_t b = pool.first_block; b < pool.first_block + pool.num_blocks; ++b) {
+        if (blocks_[b].state != BlockState::Sealed) continue;
+        if (coldest == kNone || blocks_[b].erase_count < blocks_[coldest].erase_count)
+            coldest = b;
+    }
+    if (coldest == kNone) return;
+    if (max_erase_ - blocks_[coldest].erase_count < cfg_.static_wl_gap) return;
+    if (pool.free_count < 2) return;
+
+    in_gc_ = true;
+    relocate(coldest, true, work);
+    in_gc_ = false;
+}
+
+void Ftl::bucket_insert(uint32_t block) {
+    Block& blk = blocks_[block];
+    Pool& pool = pools_[blk.pool];
+    uint32_t v = blk.valid;
+    blk.prev = kNone;
+    blk.next = pool.buckets[v];
+    if (blk.next != kNone) blocks_[blk.next].prev = block;
+    pool.buckets[v] = block;
+    pool.min_bucket = std::min(pool.min_bucket, v);
+}
+
+void Ftl::bucket_remove(uint32_t block) {
+    Block& blk = blocks_[block];
+    if (blk.prev != kNone)
+        blocks_[blk.prev].next = blk.next;
+    else
+        pools_[blk.pool].buckets[blk.valid] = blk.next;
+    if (blk.next != kNone) blocks_[blk.next].prev = blk.prev;
+    blk.prev = blk.next = kNone;
+}
+
+TenantWear& Ftl::wear_for(int user_id) {
+    if (user_id < 0) return unowned_;
+    if (user_id >= static_cast<int>(wear_.size())) wear_.resize(user_id + 1);
+    return wear_[user_id];
+}
+
+uint64_t Ftl::tenant_physical_bytes(int user_id) const {
+    if (user_id < 0 || user_id >= static_cast<int>(wear_.size())) return 0;
+    return wear_[user_id].physical_pages() * cfg_.page_bytes;
+}
+
+double Ftl::tenant_waf(int user_id) const {
+    if (user_id < 0 || user_id >= static_cast<int>(wear_.size()) ||
+        wear_[user_id].host_pages == 0)
+        return 1.0;
+    return static_cast<double>(wear_[user_id].physical_pages()) /
+           static_cast<double>(wear_[user_id].host_pages);
+}
+
+uint32_t Ftl::min_erase_count() const {
+    uint32_t m = std::numeric_limits<uint32_t>::max();
+    for (const auto& b : blocks_) m = std::min(m, b.erase_count);
+    return blocks_.empty() ? 0 : m;
+}
+
+uint32_t Ftl::max_erase_count() const {
+    return max_erase_;
+}
+
+double Ftl::mean_erase_count() const {
+    if (blocks_.empty()) return 0.0;
+    return static_cast<double>(total_erases_) / static_cast<double>(blocks_.size());
+}
+
+double Ftl::projected_lifetime_s(double elapsed_s) const {
+    if (max_erase_ == 0 || elapsed_s <= 0.0) return std::numeric_limits<double>::infinity();
+    double rate = static_cast<double>(max_erase_) / elapsed_s;
+    return static_cast<double>(cfg_.pe_cycles) / rate;
+}
+
+} // namespace ssd
@@ -0,0 +1,222 @@
+#include "heavy_hitters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <random>
+
+namespace ssd {
+
+namespace {
+
+// mix is the splitmix64 finalizer, spreading consecutive tenant IDs evenly.
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+SpaceSaving::SpaceSaving(size_t k) : capacity_(k) {
+    slots_.reserve(k);
+    heap_.reserve(k);
+    heap_pos_.reserve(k);
+    index_.reserve(k);
+}
+
+SpaceSaving::AddResult SpaceSaving::add(int key, double weight) {
+    total_ += weight;
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        slots_[it->second].count += weight;
+        sift_down(heap_pos_[it->second]);
+        return { it->second, false };
+    }
+    if (capacity_ == 0) return { 0, false };
+    if (slots_.size() < capacity_) {
+        uint32_t s = static_cast<uint32_t>(slots_.size());
+        slots_.push_back({ key, weight, 0.0 });
+        heap_.push_back(s);
+        heap_pos_.push_back(s);
+        index_.emplace(key, s);
+        sift_up(s);
+        return { s, true };
+    }
+    // Take over the lightest slot; its count becomes the newcomer's error.
+    uint32_t s = heap_[0];
+    Slot& victim = slots_[s];
+    index_.erase(victim.key);
+    victim.key = key;
+    victim.error = victim.count;
+    victim.count += weight;
+    index_.emplace(key, s);
+    sift_down(0);
+    return { s, true };
+}
+
+int64_t SpaceSaving::find(int key) const {
+    auto it = index_.find(key);
+    return it == index_.end() ? -1 : static_cast<int64_t>(it->second);
+}
+
+std::vector<uint32_t> SpaceSaving::ranked() const {
+    std::vector<uint32_t> order(slots_.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (slots_[a].count != slots_[b].count) return slots_[a].count > slots_[b].count;
+        return slots_[a].key < slots_[b].key;
+    });
+    return order;
+}
+
+void SpaceSaving::swap_heap(uint32_t a, uint32_t b) {
+    std::swap(heap_[a], heap_[b]);
+    heap_pos_[heap_[a]] = a;
+    heap_pos_[heap_[b]] = b;
+}
+
+void SpaceSaving::sift_down(uint32_t pos) {
+    const uint32_t n = static_cast<uint32_t>(heap_.size());
+    while (true) {
+        uint32_t l = 2 * pos + 1, r = l + 1, m = pos;
+        if (l < n && slots_[heap_[l]].count < slots_[heap_[m]].count) m = l;
+        if (r < n && slots_[heap_[r]].count < slots_[heap_[m]].count) m = r;
+        if (m == pos) return;
+        swap_heap(pos, m);
+        pos = m;
+    }
+}
+
+void SpaceSaving::sift_up(uint32_t pos) {
+    while (pos > 0) {
+        uint32_t parent = (pos - 1) / 2;
+        if (slots_[heap_[parent]].count <= slots_[heap_[pos]].count) return;
+        swap_heap(pos, parent);
+        pos = parent;
+    }
+}
+
+CountMinSketch::CountMinSketch(size_t width, size_t depth, uint64_t seed)
+    : width_(std::max<size_t>(width, 1)), depth_(std::max<size_t>(depth, 1)),
+      counts_(width_ * depth_, 0) {
+    std::mt19937_64 rng(seed);
+    for (size_t d = 0; d < depth_; ++d) salts_.push_back(rng() | 1);
+}
+
+// cell hashes |key| for |row|: a multiply by the row's odd salt, then mixed.
+size_t CountMinSketch::cell(size_t row, int key) const {
+    uint64_t h = (static_cast<uint64_t>(static_cast<uint32_t>(key)) + 1) * salts_[row];
+    return row * width_ + static_cast<size_t>(mix(h) % width_);
+}
+
+// add raises only the counters below the new lower bound for |key|, which
+// keeps every estimate an upper bound while overcounting less.
+void CountMinSketch::add(int key, uint64_t amount) {
+    total_ += amount;
+    uint64_t target = estimate(key) + amount;
+    for (size_t d = 0; d < depth_; ++d) {
+        uint64_t& c = counts_[cell(d, key)];
+        c = std::max(c, target);
+    }
+}
+
+uint64_t CountMinSketch::estimate(int key) const {
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    for (size_t d = 0; d < depth_; ++d) best = std::min(best, counts_[cell(d, key)]);
+    return best;
+}
+
+double CountMinSketch::error_bound() const {
+    return std::exp(1.0) / static_cast<double>(width_) * static_cast<double>(total_);
+}
+
+HeavyHitterTracker::HeavyHitterTracker(const TopKOptions& opts)
+    : opts_(opts),
+      sk_requests_(opts.sketch_width, opts.sketch_depth, opts.seed),
+      sk_bytes_(opts.sketch_width, opts.sketch_depth, opts.seed + 1),
+      sk_latency_ns_(opts.sketch_width, opts.sketch_depth, opts.seed + 2),
+      distinct_((std::max<size_t>(opts.distinct_bits, 64) + 63) / 64, 0) {
+    for (size_t b = 0; b < kTopKBases; ++b) {
+        rankings_[b] = SpaceSaving(opts.k);
+        summaries_[b].resize(opts.k);
+    }
+}
+
+void HeavyHitterTracker::on_finish(const Request& r) {
+    double latency = std::max(r.finish_ts - r.arrival_ts, 0.0);
+    uint64_t latency_ns = static_cast<uint64_t>(latency * 1e9);
+    ++requests_;
+    bytes_ += r.size_bytes;
+    latency_ns_.record(latency_ns);
+
+    // A newcomer that has to evict someone is tail traffic; one that finds a
+    // free slot is tracked exactly from its first completion.
+    const SpaceSaving& by_bytes = rankings_[static_cast<size_t>(TopKBasis::Bytes)];
+    if (by_bytes.size() == by_bytes.capacity() && by_bytes.find(r.user_id) < 0) {
+        ++tail_requests_;
+        tail_bytes_ += r.size_bytes;
+        tail_latency_s_ += latency;
+        tail_latency_ns_.record(latency_ns);
+    }
+    const double weights[kTopKBases] = { static_cast<double>(r.size_bytes), 1.0, latency };
+    for (size_t b = 0; b < kTopKBases; ++b) {
+        if (opts_.k == 0) break;
+        auto added = rankings_[b].add(r.user_id, weights[b]);
+        TenantSummary& s = summaries_[b][added.slot];
+        if (added.replaced) s = TenantSummary{};
+        ++s.requests;
+        s.bytes += r.size_bytes;
+        s.latency_sum_s += latency;
+        s.latency_ns.record(latency_ns);
+    }
+
+    sk_requests_.add(r.user_id, 1);
+    sk_bytes_.add(r.user_id, r.size_bytes);
+    sk_latency_ns_.add(r.user_id, latency_ns);
+
+    size_t bit = static_cast<size_t>(mix(static_cast<uint32_t>(r.user_id)) % (distinct_.size() * 64));
+    distinct_[bit / 64] |= uint64_t{1} << (bit % 64);
+}
+
+// distinct_tenants is linear counting: with V of m bits still clear, about
+// m ln(m / V) distinct tenants set the others.
+double HeavyHitterTracker::distinct_tenants() const {
+    double m = static_cast<double>(distinct_.size() * 64);
+    size_t set = 0;
+    for (uint64_t w : distinct_) set += static_cast<size_t>(__builtin_popcountll(w));
+    double clear = m - static_cast<double>(set);
+    if (clear <= 0.0) return m * std::log(m);  // saturated: a lower bound
+    return m * std::log(m / clear);
+}
+
+bool HeavyHitterTracker::write_csv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    const char* names[kTopKBases] = { "bytes", "requests", "load" };
+    out << "ranking,rank,user_id,estimate,error,requests,MB,mean_latency_s,p99_latency_s,"
+           "sketch_requests,sketch_MB\n";
+    for (size_t b = 0; b < kTopKBases; ++b) {
+        const SpaceSaving& ss = rankings_[b];
+        auto order = ss.ranked();
+        for (size_t i = 0; i < order.size(); ++i) {
+            const SpaceSaving::Slot& slot = ss.slot(order[i]);
+            const TenantSummary& s = summaries_[b][order[i]];
+            double n = static_cast<double>(std::max<uint64_t>(s.requests, 1));
+            out << names[b] << "," << i + 1 << "," << slot.key << "," << slot.count << ","
+                << slot.error << "," << s.requests << "," << s.bytes / (1024.0 * 1024.0) << ","
+                << s.latency_sum_s / n << "," << s.latency_ns.quantile(0.99) * 1e-9 << ","
+                << sk_requests_.estimate(slot.key) << ","
+                << sk_bytes_.estimate(slot.key) / (1024.0 * 1024.0) << "\n";
+        }
+    }
+    double n = static_cast<double>(std::max<uint64_t>(tail_requests_, 1));
+    out << "tail,," << "," << distinct_tenants() << ",," << tail_requests_ << ","
+        << tail_bytes_ / (1024.0 * 1024.0) << "," << tail_latency_s_ / n << ","
+        << tail_latency_ns_.quantile(0.99) * 1e-9 << ",,\n";
+    return static_cast<bool>(out);
+}
+
+} // namespace ssd
@@ -0,0 +1,108 @@
+#include "live.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ssd {
+
+WindowReporter::WindowReporter(double window_s, int num_users, std::ostream& out)
+    : window_s_(window_s > 0.0 ? window_s : 1.0), out_(out), window_(num_users),
+      num_users_(num_users) {
+    window_.track_quantiles(true);
+    out_ << "window_start_s,window_end_s,completed,bytes,avg_latency_s,fairness,"
+            "latency_jain,p99_latency_jain,p99_slowdown_jain\n";
+    out_.flush();
+}
+
+void WindowReporter::on_finish(const Request& r) {
+    double index = std::floor(r.finish_ts / window_s_);
+    if (index != current_) {
+        flush();
+        current_ = index;
+    }
+    window_.on_finish(r);
+}
+
+void WindowReporter::flush() {
+    size_t completed = 0;
+    uint64_t bytes = 0;
+    double latency = 0.0;
+    for (int u = 0; u < window_.num_users(); ++u) {
+        completed += window_.completed(u);
+        bytes += window_.total_bytes(u);
+        latency += window_.avg_latency(u) * static_cast<double>(window_.completed(u));
+    }
+    if (completed > 0) {
+        out_ << current_ * window_s_ << "," << (current_ + 1.0) * window_s_ << ","
+             << completed << "," << bytes << ","
+             << latency / static_cast<double>(completed) << ","
+             << window_.fairness_index() << ","
+             << window_.latency_fairness(LatencyBasis::MeanLatency).jain << ","
+             << window_.latency_fairness(LatencyBasis::P99Latency).jain << ","
+             << window_.latency_fairness(LatencyBasis::P99Slowdown).jain << "\n";
+        out_.flush();
+        ++rows_;
+    }
+    window_.reset(num_users_);
+}
+
+LiveStats run_live(std::istream& in, const LiveOptions& opts, Simulator& sim,
+                   std::ostream& out) {
+    LiveStats stats;
+    int max_users = std::max(opts.max_users, 1);
+    WindowReporter windows(opts.window_s, max_users, out);
+    sim.set_completion_hook([&windows](const Request& r) { windows.on_finish(r); });
+
+    util::TraceParser parser;
+    parser.cap_users(max_users);
+    std::priority_queue<Request, std::vector<Request>, ArrivalLater> buffer;
+    double latest = 0.0;    // newest arrival seen
+    double released = 0.0;  // newest arrival handed to the simulator
+
+    auto release_front = [&]() {
+        const Request& r = buffer.top();
+        released = std::max(released, r.arrival_ts);
+        sim.admit(r);
+        buffer.pop();
+    };
+
+    std::string line;
+    Request req{};
+    while (std::getline(in, line)) {
+        ++stats.lines;
+        try {
+            if (!parser.parse_line(line, req)) continue;
+        } catch (const std::exception&) {
+            ++stats.skipped;
+            continue;
+        }
+        ++stats.requests;
+        if (req.user_id >= max_users) {
+            req.user_id %= max_users;
+            ++stats.folded;
+        }
+        if (req.arrival_ts < released) ++stats.late;
+        latest = std::max(latest, req.arrival_ts);
+        buffer.push(req);
+
+        double watermark = latest - opts.reorder_slack_s;
+        while (!buffer.empty() &&
+               (buffer.top().arrival_ts <= watermark || buffer.size() > opts.max_buffered))
+            release_front();
+        sim.advance_to(watermark);
+    }
+
+    while (!buffer.empty()) release_front();
+    sim.drain();
+    windows.flush();
+    sim.set_completion_hook(nullptr);
+    stats.windows = windows.rows();
+    return stats;
+}
+
+} // namespace ssd
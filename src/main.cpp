@@ -2,24 +2,113 @@
 // Main simulation driver for the SSD fairness scheduling simulator.
 
 #include "types.hpp"
+#include "attribution.hpp"
+#include "trace_archive.hpp"
 #include "util.hpp"
 #include "scheduler.hpp"
 #include "scheduler_impl.hpp"
 #include "ssd.hpp"
+#include "device_array.hpp"
+#include "endurance.hpp"
 #include "events.hpp"
+#include "fabric.hpp"
+#include "heavy_hitters.hpp"
+#include "live.hpp"
 #include "metrics.hpp"
+#include "sampling.hpp"
+#include "simulator.hpp"
+#include "staged.hpp"
+#include "starvation.hpp"
+#include "sweep.hpp"
+#include "mapped_trace.hpp"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <limits>
 #include <fstream>
+#include <functional>
 #include <sstream>
 #include <string>
 #include <memory>
 #include <getopt.h>
+#include <unistd.h>
+
+namespace {
+
+// Long-only options use values outside the short-option character range.
+enum LongOnlyOption {
+    kOptThermal = 256,
+    kOptThermalTau,
+    kOptApst,
+    kOptFabric,
+    kOptHosts,
+    kOptFabricQd,
+    kOptFabricArb,
+    kOptOverhead,
+    kOptOverheadScale,
+    kOptOverheadSweep,
+    kOptLive,
+    kOptLiveSlack,
+    kOptWindow,
+    kOptArchiveOut,
+    kOptTimeRange,
+    kOptFtl,
+    kOptFtlCapacity,
+    kOptOverProvisioning,
+    kOptWearLeveling,
+    kOptPeCycles,
+    kOptDwpd,
+    kOptEnduranceThrottle,
+    kOptSweep,
+    kOptSweepGrid,
+    kOptSweepWorkers,
+    kOptPriorities,
+    kOptTbfRate,
+    kOptTbfBurst,
+    kOptWriteWeights,
+    kOptRwArbitration,
+    kOptRwReadStreak,
+    kOptRwReadShare,
+    kOptSizeClasses,
+    kOptExpressKb,
+    kOptBulkShare,
+    kOptSample,
+    kOptSampleClusters,
+    kOptSampleWarmup,
+    kOptSampleThreads,
+    kOptSampleValidate,
+    kOptPrecondition,
+    kOptFtlSnapshotSave,
+    kOptFtlSnapshotLoad,
+    kOptStaged,
+    kOptRequestLog,
+    kOptDevices,
+    kOptStripeKb,
+    kOptDeviceSpread,
+    kOptReservations,
+    kOptLimits,
+    kOptDmclockLocal,
+    kOptNamespaces,
+    kOptNsBlocks,
+    kOptTenantNs,
+    kOptOracleDevice,
+    kOptAttribution,
+    kOptAttributionThreads,
+    kOptTopK,
+    kOptTopKWidth,
+    kOptTopKDepth,
+    kOptStarvationGap,
+    kOptStarvationAge,
+    kOptStarvationEvents,
+};
+
+} // namespace
 
 int main(int argc, char** argv) {
     // ==== Configuration Parameters ====
     std::string trace_path = "traces/example.csv";   // Path to request trace
-    std::string policy_str = "qfq";                  // Scheduler type: rr, drr, qfq, sgfs
+    std::string policy_str = "qfq";                  // Scheduler or pipeline: rr, drr, qfq, sgfs, prio>tbf>drr, ...
     double quantum = 4096.0;                         // DRR quantum (bytes)
     std::string weights_str;                         // Comma-separated weights string
     int override_users = -1;
@@ -28,6 +117,51 @@ int main(int argc, char** argv) {
     double write_bw = 1200;      // Default write bandwidth (MB/s)
     int sgfs_rotate_every = 200; // SGFS rotation interval
     int sgfs_gap = 1;            // SGFS rotation stride
+    bool thermal = false;        // Enable heat accumulator + throttling
+    double thermal_tau = 2.0;    // Heating/cooling time constant (s)
+    bool apst = false;           // Enable NVMe idle power states
+    bool use_fabric = false;     // Route commands through an NVMe-oF stage
+    ssd::FabricConfig fabric_cfg = ssd::fabric_preset("tcp");
+    int fabric_hosts = 1;        // Hosts sharing the target
+    int fabric_qd = -1;          // Per-connection queue depth override
+    ssd::SimOptions sim_opts;    // Overhead-in-the-loop settings
+    bool overhead_sweep = false; // Compare every policy's overhead and exit
+    bool live = false;           // Stream the trace from a pipe/FIFO/stdin ("-")
+    ssd::LiveOptions live_opts;  // Reorder slack and reporting window
+    std::string archive_out;     // Write the loaded trace as a columnar archive
+    double range_begin = -1.0;   // Optional [begin, end) arrival window (s)
+    double range_end = -1.0;
+    FtlConfig ftl_cfg;           // Page-mapped FTL with GC and wear tracking
+    bool endurance_throttle = false; // Hold writes of tenants over their DWPD share
+    std::string ftl_snapshot_save;   // Write the device's starting FTL state here
+    bool staged = false;         // Loader, simulation and metrics on three threads
+    bool window_given = false;   // --window also asks staged runs for window rows
+    std::string request_log;     // Per-request CSV of every completion
+    ssd::ArrayOptions array_opts;    // Stripe the trace over several devices
+    std::string spread_str;          // Comma-separated devices per tenant
+    std::string reservations_str;    // Comma-separated dmclock reservations (MB/s)
+    std::string limits_str;          // Comma-separated dmclock limits (MB/s)
+    std::string sweep_dir;       // Work-queue directory for a multi-process sweep
+    std::string sweep_grid;      // "key=v1,v2;key2=..." axes to enqueue
+    int sweep_workers = 0;       // Worker processes (default: one per core)
+    std::string priorities_str;  // Comma-separated priority class per user (prio stage)
+    double tbf_rate = 0.0;       // Aggregate token-bucket rate in MB/s (tbf stage)
+    double tbf_burst = 1 << 20;  // Token-bucket depth in bytes
+    std::string write_weights_str;  // Write-domain weights for the rw stage
+    ssd::SchedulerOptions rw_opts;  // rw stage arbitration settings
+    std::string size_classes_str;   // size stage: comma-separated class bounds (KiB)
+    ssd::SchedulerOptions size_opts;  // size stage express lane and bulk floor
+    OracleMode oracle = OracleMode::Off;  // Replay the capture's D->C service times
+    ssd::AttributionOptions attribution_opts;  // Shapley interference attribution
+    bool attribution = false;
+    ssd::TopKOptions topk_opts;  // Bounded-memory per-tenant summaries
+    bool topk = false;
+    ssd::StarvationOptions starvation_opts;  // Online per-tenant service-gap tracking
+    std::string starvation_events;           // CSV of every starvation episode
+    bool starvation = false;
+    ssd::SamplingOptions sample_opts;  // Representative-interval simulation
+    bool sample = false;
+    bool sample_validate = false;  // Also run the full trace and report error
 
     // Parse command line options
     static option longopts[] = {
@@ -39,6 +173,69 @@ int main(int argc, char** argv) {
         {"read-bw", required_argument, 0, 'r'},
         {"write-bw", required_argument, 0, 'w'},
         {"weights", required_argument, 0, 'W'},
+        {"thermal", no_argument, 0, kOptThermal},
+        {"thermal-tau", required_argument, 0, kOptThermalTau},
+        {"apst", no_argument, 0, kOptApst},
+        {"fabric", required_argument, 0, kOptFabric},
+        {"hosts", required_argument, 0, kOptHosts},
+        {"fabric-qd", required_argument, 0, kOptFabricQd},
+        {"fabric-arb", required_argument, 0, kOptFabricArb},
+        {"overhead", no_argument, 0, kOptOverhead},
+        {"overhead-scale", required_argument, 0, kOptOverheadScale},
+        {"overhead-sweep", no_argument, 0, kOptOverheadSweep},
+        {"live", no_argument, 0, kOptLive},
+        {"live-slack", required_argument, 0, kOptLiveSlack},
+        {"window", required_argument, 0, kOptWindow},
+        {"archive-out", required_argument, 0, kOptArchiveOut},
+        {"time-range", required_argument, 0, kOptTimeRange},
+        {"ftl", no_argument, 0, kOptFtl},
+        {"ftl-capacity-mb", required_argument, 0, kOptFtlCapacity},
+        {"op", required_argument, 0, kOptOverProvisioning},
+        {"wear-leveling", required_argument, 0, kOptWearLeveling},
+        {"pe-cycles", required_argument, 0, kOptPeCycles},
+        {"dwpd", required_argument, 0, kOptDwpd},
+        {"endurance-throttle", no_argument, 0, kOptEnduranceThrottle},
+        {"sweep", required_argument, 0, kOptSweep},
+        {"sweep-grid", required_argument, 0, kOptSweepGrid},
+        {"sweep-workers", required_argument, 0, kOptSweepWorkers},
+        {"priorities", required_argument, 0, kOptPriorities},
+        {"tbf-rate", required_argument, 0, kOptTbfRate},
+        {"tbf-burst", required_argument, 0, kOptTbfBurst},
+        {"write-weights", required_argument, 0, kOptWriteWeights},
+        {"rw-arbitration", required_argument, 0, kOptRwArbitration},
+        {"rw-read-streak", required_argument, 0, kOptRwReadStreak},
+        {"rw-read-share", required_argument, 0, kOptRwReadShare},
+        {"size-classes", required_argument, 0, kOptSizeClasses},
+        {"express-kb", required_argument, 0, kOptExpressKb},
+        {"bulk-share", required_argument, 0, kOptBulkShare},
+        {"sample", required_argument, 0, kOptSample},
+        {"sample-clusters", required_argument, 0, kOptSampleClusters},
+        {"sample-warmup", required_argument, 0, kOptSampleWarmup},
+        {"sample-threads", required_argument, 0, kOptSampleThreads},
+        {"sample-validate", no_argument, 0, kOptSampleValidate},
+        {"precondition", required_argument, 0, kOptPrecondition},
+        {"ftl-snapshot-save", required_argument, 0, kOptFtlSnapshotSave},
+        {"ftl-snapshot-load", required_argument, 0, kOptFtlSnapshotLoad},
+        {"staged", no_argument, 0, kOptStaged},
+        {"request-log", required_argument, 0, kOptRequestLog},
+        {"devices", required_argument, 0, kOptDevices},
+        {"stripe-kb", required_argument, 0, kOptStripeKb},
+        {"device-spread", required_argument, 0, kOptDeviceSpread},
+        {"reservations", required_argument, 0, kOptReservations},
+        {"limits", required_argument, 0, kOptLimits},
+        {"dmclock-local", no_argument, 0, kOptDmclockLocal},
+        {"namespaces", required_argument, 0, kOptNamespaces},
+        {"ns-blocks", required_argument, 0, kOptNsBlocks},
+        {"tenant-ns", required_argument, 0, kOptTenantNs},
+        {"oracle-device", required_argument, 0, kOptOracleDevice},
+        {"attribution", required_argument, 0, kOptAttribution},
+        {"attribution-threads", required_argument, 0, kOptAttributionThreads},
+        {"topk", required_argument, 0, kOptTopK},
+        {"topk-width", required_argument, 0, kOptTopKWidth},
+        {"topk-depth", required_argument, 0, kOptTopKDepth},
+        {"starvation-gap", required_argument, 0, kOptStarvationGap},
+        {"starvation-age", required_argument, 0, kOptStarvationAge},
+        {"starvation-events", required_argument, 0, kOptStarvationEvents},
         {0,0,0,0}
     };
 
@@ -52,112 +249,856 @@ int main(int argc, char** argv) {
         else if (opt=='r') read_bw = atof(optarg);
         else if (opt=='w') write_bw = atof(optarg);
         else if (opt=='W') weights_str = optarg;
+        else if (opt==kOptThermal) thermal = true;
+        else if (opt==kOptThermalTau) { thermal = true; thermal_tau = atof(optarg); }
+        else if (opt==kOptApst) apst = true;
+        else if (opt==kOptFabric) {
+            std::string arb = fabric_cfg.arbitration;
+            use_fabric = true;
+            fabric_cfg = ssd::fabric_preset(optarg);
+            fabric_cfg.arbitration = arb;
+        }
+        else if (opt==kOptHosts) { use_fabric = true; fabric_hosts = atoi(optarg); }
+        else if (opt==kOptFabricQd) { use_fabric = true; fabric_qd = atoi(optarg); }
+        else if (opt==kOptFabricArb) { use_fabric = true; fabric_cfg.arbitration = optarg; }
+        else if (opt==kOptOverhead) sim_opts.charge_overhead = true;
+        else if (opt==kOptOverheadScale) {
+            sim_opts.charge_overhead = true;
+            sim_opts.overhead_scale = atof(optarg);
+        }
+        else if (opt==kOptOverheadSweep) overhead_sweep = true;
+        else if (opt==kOptLive) live = true;
+        else if (opt==kOptLiveSlack) live_opts.reorder_slack_s = atof(optarg);
+        else if (opt==kOptWindow) { live_opts.window_s = atof(optarg); window_given = true; }
+        else if (opt==kOptArchiveOut) archive_out = optarg;
+        else if (opt==kOptTimeRange) {
+            std::string range = optarg;
+            auto colon = range.find(':');
+            range_begin = atof(range.substr(0, colon).c_str());
+            range_end = colon == std::string::npos ? -1.0 : atof(range.substr(colon + 1).c_str());
+        }
+        else if (opt==kOptFtl) ftl_cfg.enabled = true;
+        else if (opt==kOptFtlCapacity) {
+            ftl_cfg.enabled = true;
+            ftl_cfg.physical_bytes = static_cast<uint64_t>(atof(optarg) * 1024.0 * 1024.0);
+        }
+        else if (opt==kOptOverProvisioning) { ftl_cfg.enabled = true; ftl_cfg.over_provisioning = atof(optarg); }
+        else if (opt==kOptWearLeveling) {
+            std::string wl = optarg;
+            ftl_cfg.enabled = true;
+            if (wl == "none") ftl_cfg.wear_leveling = WearLeveling::None;
+            else if (wl == "dynamic") ftl_cfg.wear_leveling = WearLeveling::Dynamic;
+            else if (wl == "static") ftl_cfg.wear_leveling = WearLeveling::Static;
+            else {
+                std::cerr << "Unknown wear leveling mode: " << wl << "\n";
+                return 1;
+            }
+        }
+        else if (opt==kOptPeCycles) { ftl_cfg.enabled = true; ftl_cfg.pe_cycles = static_cast<uint32_t>(atoi(optarg)); }
+        else if (opt==kOptDwpd) { ftl_cfg.enabled = true; ftl_cfg.dwpd = atof(optarg); }
+        else if (opt==kOptEnduranceThrottle) { ftl_cfg.enabled = true; endurance_throttle = true; }
+        else if (opt==kOptSweep) sweep_dir = optarg;
+        else if (opt==kOptSweepGrid) sweep_grid = optarg;
+        else if (opt==kOptSweepWorkers) sweep_workers = atoi(optarg);
+        else if (opt==kOptPriorities) priorities_str = optarg;
+        else if (opt==kOptTbfRate) tbf_rate = atof(optarg);
+        else if (opt==kOptTbfBurst) tbf_burst = atof(optarg);
+        else if (opt==kOptWriteWeights) write_weights_str = optarg;
+        else if (opt==kOptRwArbitration) {
+            std::string arb = optarg;
+            if (arb == "read-priority") rw_opts.rw_arbitration = ssd::RwArbitration::ReadPriority;
+            else if (arb == "proportional") rw_opts.rw_arbitration = ssd::RwArbitration::Proportional;
+            else {
+                std::cerr << "Unknown read/write arbitration: " << arb << "\n";
+                return 1;
+            }
+        }
+        else if (opt==kOptRwReadStreak) rw_opts.rw_max_read_streak = atoi(optarg);
+        else if (opt==kOptRwReadShare) rw_opts.rw_read_share = atof(optarg);
+        else if (opt==kOptSizeClasses) size_classes_str = optarg;
+        else if (opt==kOptExpressKb) size_opts.size_express_bytes = static_cast<uint32_t>(atof(optarg) * 1024.0);
+        else if (opt==kOptBulkShare) size_opts.size_bulk_share = atof(optarg);
+        else if (opt==kOptSample) { sample = true; sample_opts.interval_s = atof(optarg); }
+        else if (opt==kOptSampleClusters) { sample = true; sample_opts.clusters = atoi(optarg); }
+        else if (opt==kOptSampleWarmup) { sample = true; sample_opts.warmup_s = atof(optarg); }
+        else if (opt==kOptSampleThreads) { sample = true; sample_opts.threads = atoi(optarg); }
+        else if (opt==kOptSampleValidate) { sample = true; sample_validate = true; }
+        else if (opt==kOptPrecondition) {
+            std::string spec = optarg;
+            auto colon = spec.find(':');
+            std::string pattern = spec.substr(0, colon);
+            ftl_cfg.enabled = true;
+            if (colon != std::string::npos) ftl_cfg.precondition_fill = atof(spec.substr(colon + 1).c_str());
+            if (pattern == "random") ftl_cfg.precondition = Precondition::Random;
+            else if (pattern == "sequential") ftl_cfg.precondition = Precondition::Sequential;
+            else if (pattern == "none") ftl_cfg.precondition = Precondition::None;
+            else {
+                std::cerr << "Unknown precondition pattern: " << pattern << "\n";
+                return 1;
+            }
+        }
+        else if (opt==kOptFtlSnapshotSave) { ftl_cfg.enabled = true; ftl_snapshot_save = optarg; }
+        else if (opt==kOptFtlSnapshotLoad) { ftl_cfg.enabled = true; ftl_cfg.snapshot_path = optarg; }
+        else if (opt==kOptStaged) staged = true;
+        else if (opt==kOptRequestLog) request_log = optarg;
+        else if (opt==kOptDevices) array_opts.devices = atoi(optarg);
+        else if (opt==kOptStripeKb) array_opts.stripe_bytes = static_cast<uint64_t>(atof(optarg) * 1024.0);
+        else if (opt==kOptDeviceSpread) spread_str = optarg;
+        else if (opt==kOptReservations) reservations_str = optarg;
+        else if (opt==kOptLimits) limits_str = optarg;
+        else if (opt==kOptDmclockLocal) array_opts.coordinate = false;
+        else if (opt==kOptNamespaces) {
+            // share:op[:greedy|fifo] per namespace, comma-separated.
+            ftl_cfg.enabled = true;
+            ftl_cfg.namespaces.clear();
+            std::stringstream ss(optarg);
+            std::string item;
+            while (std::getline(ss, item, ',')) {
+                if (item.empty()) continue;
+                NamespaceConfig ns;
+                std::stringstream fields(item);
+                std::string field;
+                if (std::getline(fields, field, ':')) ns.share = atof(field.c_str());
+                if (std::getline(fields, field, ':')) ns.over_provisioning = atof(field.c_str());
+                if (std::getline(fields, field, ':')) {
+                    if (field == "greedy") ns.gc = GcPolicy::Greedy;
+                    else if (field == "fifo") ns.gc = GcPolicy::Fifo;
+                    else {
+                        std::cerr << "Unknown namespace GC policy: " << field << "\n";
+                        return 1;
+                    }
+                }
+                ftl_cfg.namespaces.push_back(ns);
+            }
+        }
+        else if (opt==kOptNsBlocks) {
+            std::string mode = optarg;
+            ftl_cfg.enabled = true;
+            if (mode == "shared") ftl_cfg.partition_blocks = false;
+            else if (mode == "partitioned") ftl_cfg.partition_blocks = true;
+            else {
+                std::cerr << "Unknown --ns-blocks mode: " << mode << "\n";
+                return 1;
+            }
+        }
+        else if (opt==kOptAttribution) { attribution = true; attribution_opts.permutations = atoi(optarg); }
+        else if (opt==kOptAttributionThreads) { attribution = true; attribution_opts.threads = atoi(optarg); }
+        else if (opt==kOptTopK) { topk = true; topk_opts.k = static_cast<size_t>(std::max(atoi(optarg), 1)); }
+        else if (opt==kOptTopKWidth) { topk = true; topk_opts.sketch_width = static_cast<size_t>(std::max(atoi(optarg), 1)); }
+        else if (opt==kOptTopKDepth) { topk = true; topk_opts.sketch_depth = static_cast<size_t>(std::max(atoi(optarg), 1)); }
+        else if (opt==kOptStarvationGap) { starvation = true; starvation_opts.gap_threshold_s = atof(optarg) / 1000.0; }
+        else if (opt==kOptStarvationAge) { starvation = true; starvation_opts.age_threshold_s = atof(optarg) / 1000.0; }
+        else if (opt==kOptStarvationEvents) { starvation = true; starvation_events = optarg; }
+        else if (opt==kOptOracleDevice) {
+            std::string mode = optarg;
+            if (mode == "request") oracle = OracleMode::Request;
+            else if (mode == "position") oracle = OracleMode::Position;
+            else {
+                std::cerr << "Unknown --oracle-device mode: " << mode << "\n";
+                return 1;
+            }
+        }
+        else if (opt==kOptTenantNs) {
+            ftl_cfg.enabled = true;
+            ftl_cfg.tenant_namespace.clear();
+            std::stringstream ss(optarg);
+            std::string item;
+            while (std::getline(ss, item, ','))
+                if (!item.empty()) ftl_cfg.tenant_namespace.push_back(atoi(item.c_str()));
+        }
+    }
+
+    if (endurance_throttle && ftl_cfg.dwpd <= 0.0) {
+        std::cerr << "--endurance-throttle needs a positive --dwpd\n";
+        return 1;
+    }
+    if (sim_opts.charge_overhead && use_fabric) {
+        std::cerr << "--overhead cannot be combined with fabric mode\n";
+        return 1;
+    }
+    if (endurance_throttle && use_fabric) {
+        std::cerr << "--endurance-throttle cannot be combined with fabric mode\n";
+        return 1;
+    }
+
+    if (fabric_qd > 0) fabric_cfg.queue_depth = fabric_qd;
+
+    if (live && (use_fabric || overhead_sweep)) {
+        std::cerr << "--live cannot be combined with fabric mode or --overhead-sweep\n";
+        return 1;
+    }
+
+    if (staged && (live || use_fabric || overhead_sweep || sample || !sweep_dir.empty() ||
+                   !archive_out.empty() || range_begin >= 0.0)) {
+        std::cerr << "--staged streams the trace itself and cannot be combined with --live, "
+                     "fabric mode, --overhead-sweep, --sample, --sweep, --archive-out or --time-range\n";
+        return 1;
+    }
+
+    if (!request_log.empty() && (live || use_fabric)) {
+        std::cerr << "--request-log needs a direct-attached, non-live run\n";
+        return 1;
     }
 
-    // ==== Load trace ====
-    auto trace = util::load_trace_csv(trace_path);
+    bool array = array_opts.devices > 1;
+    if (array && (live || use_fabric || staged || overhead_sweep || sample ||
+                  !sweep_dir.empty() || endurance_throttle)) {
+        std::cerr << "--devices cannot be combined with --live, fabric mode, --staged, "
+                     "--overhead-sweep, --sample, --sweep or --endurance-throttle\n";
+        return 1;
+    }
+
+    if (oracle != OracleMode::Off &&
+        (live || staged || !sweep_dir.empty() || thermal || apst || ftl_cfg.enabled ||
+         util::is_trace_archive(trace_path))) {
+        std::cerr << "--oracle-device replays a blkparse text trace and cannot be combined with "
+                     "--live, --staged, --sweep, the thermal model or the FTL\n";
+        return 1;
+    }
+
+    if (attribution && (live || use_fabric || staged || overhead_sweep || sample || array ||
+                        !sweep_dir.empty() || endurance_throttle)) {
+        std::cerr << "--attribution cannot be combined with --live, fabric mode, --staged, "
+                     "--overhead-sweep, --sample, --devices, --sweep or --endurance-throttle\n";
+        return 1;
+    }
+
+    if (topk && (live || use_fabric || overhead_sweep || sample || attribution ||
+                 !sweep_dir.empty())) {
+        std::cerr << "--topk cannot be combined with --live, fabric mode, --overhead-sweep, "
+                     "--sample, --attribution or --sweep\n";
+        return 1;
+    }
+
+    if (starvation && (use_fabric || array || overhead_sweep || sample || attribution ||
+                       !sweep_dir.empty())) {
+        std::cerr << "--starvation-* cannot be combined with fabric mode, --devices, "
+                     "--overhead-sweep, --sample, --attribution or --sweep\n";
+        return 1;
+    }
+
+    if (sample && (use_fabric || endurance_throttle)) {
+        std::cerr << "--sample cannot be combined with fabric mode or --endurance-throttle\n";
+        return 1;
+    }
+
+    if (!sweep_grid.empty() && sweep_dir.empty()) {
+        std::cerr << "--sweep-grid needs --sweep DIR\n";
+        return 1;
+    }
+
+    // ==== Load trace (live mode streams it during the run instead; a resumed
+    // sweep reuses the request image already in its directory) ====
+    std::vector<Request> trace;
+    util::ServiceTimes service_times;  // oracle device only, filled while loading
+    bool resume_sweep = !sweep_dir.empty() && sweep_grid.empty();
+    if (!live && !resume_sweep && !staged) {
+        bool ranged = range_begin >= 0.0 && range_end > range_begin;
+        if (ranged && util::is_trace_archive(trace_path)) {
+            // Archives seek straight to the window through the block index.
+            trace = util::TraceArchiveReader(trace_path).read_range(range_begin, range_end, 0);
+        } else {
+            trace = util::load_trace(trace_path,
+                                     oracle != OracleMode::Off ? &service_times : nullptr);
+            if (ranged) {
+                trace.erase(std::remove_if(trace.begin(), trace.end(),
+                                           [&](const Request& r) {
+                                               return r.arrival_ts < range_begin ||
+                                                      r.arrival_ts >= range_end;
+                                           }),
+                            trace.end());
+            }
+        }
+    }
+
+    if (!archive_out.empty()) {
+        util::write_trace_archive(archive_out, trace);
+        std::cout << "Wrote " << trace.size() << " requests to " << archive_out << "\n";
+    }
 
     // ==== Determine number of users from trace or override ====
     int num_users = override_users > 0 ? override_users : 0;
+    if (live || staged) {
+        if (num_users <= 0) num_users = live_opts.max_users;
+        live_opts.max_users = num_users;
+    }
     for (const auto& r : trace)
         if (r.user_id + 1 > num_users)
             num_users = r.user_id + 1;
 
+    // ==== Sweep mode: enqueue the grid once, then run worker processes ====
+    if (!sweep_dir.empty()) {
+        ssd::SweepQueue queue(sweep_dir);
+        if (!sweep_grid.empty()) {
+            auto items = ssd::expand_sweep_grid(sweep_grid);
+            queue.init(items);
+            // Keep the original image on rerun so resumed items see the same trace.
+            std::ifstream existing(queue.trace_path());
+            if (!existing.good())
+                util::write_request_image(queue.trace_path(), trace, num_users);
+            std::cout << "Sweep: " << items.size() << " items, " << queue.pending()
+                      << " pending in " << sweep_dir << "\n";
+        }
+        int workers = sweep_workers > 0 ? sweep_workers
+                                        : static_cast<int>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+        int failed = ssd::run_sweep(sweep_dir, workers);
+        std::ofstream merged(sweep_dir + "/sweep.csv");
+        size_t n = queue.collect(merged);
+        std::cout << "Sweep: " << n << " results in " << sweep_dir << "/sweep.csv, "
+                  << queue.pending() << " pending, " << failed << " failed workers\n";
+        return failed == 0 ? 0 : 1;
+    }
+
     // ==== Setup simulation config ====
     int num_channels = override_channels > 0 ? override_channels : 8;
-    SimConfig sim_cfg { num_users, num_channels, read_bw, write_bw };
+    SimConfig sim_cfg;
+    sim_cfg.num_users = num_users;
+    sim_cfg.num_channels = num_channels;
+    sim_cfg.read_bw_MBps = read_bw;
+    sim_cfg.write_bw_MBps = write_bw;
+    sim_cfg.ftl = ftl_cfg;
+    if (oracle != OracleMode::Off) {
+        std::cout << "Oracle device: " << service_times.observed << " of "
+                  << service_times.s_per_byte.size()
+                  << " requests have observed D->C times, the rest use their op's median rate\n";
+        sim_cfg.oracle = oracle;
+        sim_cfg.oracle_s_per_byte =
+            std::make_shared<const std::vector<float>>(std::move(service_times.s_per_byte));
+    }
+    if (thermal || apst) {
+        // Defaults follow a typical client NVMe drive: a light throttle step
+        // and a heavy one that halves bandwidth, plus APST PS3/PS4.
+        sim_cfg.thermal.enabled = true;
+        sim_cfg.thermal.time_constant_s = thermal_tau;
+        if (thermal)
+            sim_cfg.thermal.levels = { {0.7, 0.75}, {0.9, 0.5} };
+        if (apst)
+            sim_cfg.thermal.power_states = { {0.010, 0.002, 0.0012},
+                                             {0.100, 0.005, 0.0100} };
+    }
+    if (!ftl_snapshot_save.empty()) {
+        // Every device of the run starts from this state, so save it once up front.
+        ssd::Ftl(ftl_cfg, num_users).save_snapshot(ftl_snapshot_save);
+        std::cout << "Saved FTL snapshot to " << ftl_snapshot_save << "\n";
+    }
+
+    // ==== Parse weights if provided ====
+    std::vector<double> weights;
+    if (!weights_str.empty()) {
+        std::stringstream ss(weights_str);
+        std::string token;
+        while (std::getline(ss, token, ',')) {
+            weights.push_back(std::stod(token));
+        }
+    }
 
     // ==== Create scheduler based on requested policy ====
-    std::unique_ptr<ssd::Scheduler> scheduler;
-    if (policy_str == "rr") {
-        scheduler = std::make_unique<ssd::RoundRobinScheduler>();
-    } else if (policy_str == "drr") {
-        auto drr = std::make_unique<ssd::DeficitRoundRobinScheduler>();
-        drr->set_quantum(quantum);
-        scheduler = std::move(drr);
-    } else if (policy_str == "qfq") {
-        scheduler = std::make_unique<ssd::WeightedFairScheduler>();
-    } else if (policy_str == "sgfs") {
-        // SGFS wraps a base scheduler and rotates mappings
-        auto base = std::make_unique<ssd::WeightedFairScheduler>();
-        auto sgfs = std::make_unique<ssd::StartGapScheduler>(std::move(base));
-        sgfs->set_start_gap(sgfs_rotate_every, sgfs_gap);
-        scheduler = std::move(sgfs);
-    } else {
+    ssd::SchedulerOptions sched_opts;
+    sched_opts.quantum = quantum;
+    sched_opts.sgfs_rotate_every = sgfs_rotate_every;
+    sched_opts.sgfs_gap = sgfs_gap;
+    sched_opts.tbf_rate_MBps = tbf_rate;
+    sched_opts.tbf_burst_bytes = tbf_burst;
+    sched_opts.rw_arbitration = rw_opts.rw_arbitration;
+    sched_opts.rw_max_read_streak = rw_opts.rw_max_read_streak;
+    sched_opts.rw_read_share = rw_opts.rw_read_share;
+    sched_opts.size_express_bytes = size_opts.size_express_bytes;
+    sched_opts.size_bulk_share = size_opts.size_bulk_share;
+    if (!size_classes_str.empty()) {
+        std::stringstream ss(size_classes_str);
+        std::string token;
+        sched_opts.size_class_bytes.clear();
+        while (std::getline(ss, token, ','))
+            sched_opts.size_class_bytes.push_back(static_cast<uint32_t>(std::stod(token) * 1024.0));
+    }
+    if (!write_weights_str.empty()) {
+        std::stringstream ss(write_weights_str);
+        std::string token;
+        while (std::getline(ss, token, ','))
+            sched_opts.write_weights.push_back(std::stod(token));
+    }
+    if (!priorities_str.empty()) {
+        std::stringstream ss(priorities_str);
+        std::string token;
+        while (std::getline(ss, token, ','))
+            sched_opts.priorities.push_back(std::stoi(token));
+    }
+    if (!reservations_str.empty()) {
+        std::stringstream ss(reservations_str);
+        std::string token;
+        while (std::getline(ss, token, ','))
+            sched_opts.reservations_MBps.push_back(std::stod(token));
+    }
+    if (!limits_str.empty()) {
+        std::stringstream ss(limits_str);
+        std::string token;
+        while (std::getline(ss, token, ','))
+            sched_opts.limits_MBps.push_back(std::stod(token));
+    }
+    if (!spread_str.empty()) {
+        std::stringstream ss(spread_str);
+        std::string token;
+        while (std::getline(ss, token, ','))
+            array_opts.spread.push_back(std::stoi(token));
+    }
+    std::unique_ptr<ssd::Scheduler> scheduler = ssd::make_scheduler(policy_str, sched_opts);
+    if (!scheduler) {
         std::cerr << "Unknown scheduler policy: " << policy_str << "\n";
         return 1;
     }
 
     // ==== Initialize scheduler and set weights if provided ====
     scheduler->set_users(num_users);
-    scheduler->set_quantum(quantum);
+    if (!weights.empty())
+        scheduler->set_weights(weights);
 
-    if (!weights_str.empty()) {
-        std::vector<double> weights;
-        std::stringstream ss(weights_str);
-        std::string token;
-        while (std::getline(ss, token, ',')) {
-            weights.push_back(std::stod(token));
+    // ==== Overhead sweep: charge each policy's real CPU cost and compare ====
+    if (overhead_sweep) {
+        ssd::SimOptions sweep_opts = sim_opts;
+        sweep_opts.charge_overhead = true;
+        std::cout << "policy,ns_per_request,iops_ceiling,achieved_iops,fairness\n";
+        for (const char* name : { "rr", "drr", "qfq", "sgfs" }) {
+            auto policy = ssd::make_scheduler(name, sched_opts);
+            policy->set_users(num_users);
+            if (!weights.empty()) policy->set_weights(weights);
+            ssd::SSD sweep_device(sim_cfg);
+            ssd::Metrics sweep_metrics(num_users);
+            ssd::Simulator sim(*policy, sweep_device, sweep_metrics, sweep_opts);
+            sim.run(trace);
+            const auto& st = sim.stats();
+            double ns = st.dispatched > 0 ? st.scheduler_cpu_s * 1e9 / st.dispatched : 0.0;
+            std::cout << name << "," << ns << "," << st.iops_ceiling() << ","
+                      << st.achieved_iops() << "," << sweep_metrics.fairness_index() << "\n";
         }
-        scheduler->set_weights(weights);
+        return 0;
     }
 
-    // ==== Initialize SSD, event queue, and metrics tracker ====
-    ssd::SSD device(sim_cfg);
-    ssd::EventQueue queue;
-    ssd::Metrics metrics(num_users);
+    // ==== Sampled mode: simulate one representative interval per cluster ====
+    if (sample) {
+        sample_opts.sim = sim_opts;
+        auto make_policy = [&]() { return ssd::make_scheduler(policy_str, sched_opts); };
+        ssd::SampledRun run = ssd::run_sampled(trace, num_users, sim_cfg, make_policy,
+                                               weights, sample_opts);
+        std::cout << "Sampled: " << run.intervals << " intervals of " << sample_opts.interval_s
+                  << " s, " << run.representatives.size() << " clusters, simulated "
+                  << run.simulated_requests << " of " << trace.size() << " requests, wall "
+                  << run.wall_s << " s\n";
+        std::cout << "cluster,representative,intervals\n";
+        for (size_t c = 0; c < run.representatives.size(); ++c)
+            std::cout << c << "," << run.representatives[c] << "," << run.cluster_sizes[c] << "\n";
+        std::cout << "Fairness Index: " << run.fairness_index() << "\n";
+        std::cout << "Mean latency: " << run.overall_mean_latency() << " s\n";
 
-    // ==== Main Simulation Loop ====
-    size_t i = 0;       // Index into trace
-    double now = 0.0;   // Current simulation time
+        if (sample_validate) {
+            auto t0 = std::chrono::steady_clock::now();
+            ssd::SSD full_device(sim_cfg);
+            ssd::Metrics full(num_users);
+            ssd::Simulator sim(*scheduler, full_device, full, sim_opts);
+            sim.run(trace);
+            double full_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            ssd::SamplingError err = ssd::sampling_error(run, full);
+            std::cout << "Full run: wall " << full_s << " s, speedup "
+                      << (run.wall_s > 0.0 ? full_s / run.wall_s : 0.0) << "x, fairness "
+                      << full.fairness_index() << "\n";
+            std::cout << "Error: fairness " << err.fairness_abs << " abs, mean latency "
+                      << err.mean_latency_rel * 100.0 << "%, bytes " << err.bytes_rel * 100.0
+                      << "%, worst user latency " << err.max_user_latency_rel * 100.0 << "%\n";
+        }
+        return 0;
+    }
 
-    // Drive the event loop until all requests have been admitted and completed.
-    while (i < trace.size() || !scheduler->empty() || !queue.empty()) {
-        // 1. Admit all trace arrivals with timestamp <= now.
-        while (i < trace.size() && trace[i].arrival_ts <= now) {
-            scheduler->enqueue(trace[i]);
-            ++i;
+    // ==== Attribution mode: Shapley shares of each tenant's interference ====
+    if (attribution) {
+        attribution_opts.sim = sim_opts;
+        auto make_policy = [&]() { return ssd::make_scheduler(policy_str, sched_opts); };
+        ssd::Attribution att = ssd::attribute_interference(trace, num_users, sim_cfg, make_policy,
+                                                           weights, attribution_opts);
+        std::cout << "Attribution: " << att.tenants.size() << " tenants, " << att.permutations
+                  << (att.exact ? " orderings (all), " : " sampled orderings, ") << att.coalitions
+                  << " coalitions simulated for " << att.lookups << " lookups, wall " << att.wall_s
+                  << " s\n";
+        std::cout << "user_id,alone_mean_latency_s,shared_mean_latency_s,alone_p99_latency_s,"
+                     "shared_p99_latency_s,alone_mean_slowdown,shared_mean_slowdown,"
+                     "alone_p99_slowdown,shared_p99_slowdown\n";
+        for (size_t v = 0; v < att.tenants.size(); ++v) {
+            std::cout << att.tenants[v];
+            for (size_t m = 0; m < ssd::kInterferenceMeasures; ++m)
+                std::cout << "," << att.alone[v][m] << "," << att.shared[v][m];
+            std::cout << "\n";
         }
+        // Each row is how much |neighbour| adds to |victim|'s measure.
+        std::cout << "victim,neighbour,mean_latency_s,p99_latency_s,mean_slowdown,p99_slowdown\n";
+        for (size_t v = 0; v < att.tenants.size(); ++v) {
+            for (size_t j = 0; j < att.tenants.size(); ++j) {
+                if (j == v) continue;
+                std::cout << att.tenants[v] << "," << att.tenants[j];
+                for (double x : att.shapley[v][j]) std::cout << "," << x;
+                std::cout << "\n";
+            }
+        }
+        return 0;
+    }
 
-        // 2. Dispatch requests while channels are free. Each dispatch both
-        // dequeues a request and schedules a corresponding completion event.
-        while (true) {
-            int chan = device.first_free_channel(now);
-            if (chan < 0) break;  // No free channels
+    // ==== Initialize SSD and metrics tracker ====
+    ssd::SSD device(sim_cfg);
+    // Staged runs don't know the tenants up front; Metrics grows to the IDs seen.
+    ssd::Metrics metrics(staged && override_users <= 0 ? 0 : num_users);
+    // Per-tenant histograms are what --topk avoids; its summaries keep the tails.
+    metrics.track_quantiles(!topk);
+    metrics.set_weights(weights);
 
-            auto uid = scheduler->pick_user(now);
-            if (!uid) break;
+    // ==== Endurance budget: split the device's DWPD across tenants by weight ====
+    ssd::EnduranceThrottleScheduler* endurance = nullptr;
+    if (endurance_throttle) {
+        auto wrapped = std::make_unique<ssd::EnduranceThrottleScheduler>(
+            std::move(scheduler), device.ftl(), ftl_cfg.dwpd,
+            static_cast<double>(device.ftl()->logical_bytes()));
+        wrapped->set_users(num_users);
+        if (!weights.empty()) wrapped->set_weights(weights);
+        endurance = wrapped.get();
+        scheduler = std::move(wrapped);
+    }
 
-            auto req = scheduler->pop(*uid);
-            if (!req) break;
+    // ==== Fabric mode: hosts share the SSD through NVMe-oF connections ====
+    if (use_fabric) {
+        fabric_cfg.num_hosts = std::max(fabric_hosts, 1);
+        auto make_host_scheduler = [&]() {
+            return ssd::make_scheduler(policy_str, sched_opts);
+        };
+        ssd::FabricSimulator fabric(fabric_cfg, make_host_scheduler, num_users,
+                                    weights, device, metrics);
+        fabric.run(trace);
 
-            req->start_ts = now;
-            req->finish_ts = device.dispatch(chan, *req, now);
-            queue.push({ req->finish_ts, chan, *req });
+        std::cout << "host,completed,avg_link_s,avg_target_wait_s,avg_device_s,max_inflight\n";
+        const auto& hs = fabric.host_stats();
+        for (size_t h = 0; h < hs.size(); ++h) {
+            double n = hs[h].completed > 0 ? static_cast<double>(hs[h].completed) : 1.0;
+            std::cout << h << "," << hs[h].completed << ","
+                      << hs[h].link_s / n << ","
+                      << hs[h].target_wait_s / n << ","
+                      << hs[h].device_s / n << ","
+                      << hs[h].max_inflight << "\n";
         }
+    }
 
-        // 3. Process next event (completion) when work is in-flight.
-        if (!queue.empty()) {
-            now = queue.top().time;             // Advance to next event time
-            auto ev = queue.pop();              // Pop event
-            metrics.on_finish(ev.request);      // Log stats
+    // ==== Main Simulation Loop (direct-attached) ====
+    ssd::SimStats sim_stats;
+    std::ofstream request_log_out;
+    std::function<void(const Request&)> log_request;
+    if (!request_log.empty()) {
+        request_log_out.open(request_log);
+        if (!request_log_out.is_open()) {
+            std::cerr << "Failed to open request log: " << request_log << "\n";
+            return 1;
+        }
+        request_log_out << "user_id,op,size_bytes,arrival_ts,start_ts,finish_ts\n";
+        log_request = [&request_log_out](const Request& r) {
+            request_log_out << r.user_id << "," << (r.op == OpType::READ ? "R" : "W") << ","
+                            << r.size_bytes << "," << r.arrival_ts << "," << r.start_ts << ","
+                            << r.finish_ts << "\n";
+        };
+    }
+    std::unique_ptr<ssd::HeavyHitterTracker> heavy;
+    if (topk) {
+        heavy = std::make_unique<ssd::HeavyHitterTracker>(topk_opts);
+        auto log = std::move(log_request);
+        log_request = [tracker = heavy.get(), log](const Request& r) {
+            if (log) log(r);
+            tracker->on_finish(r);
+        };
+    }
+    std::unique_ptr<ssd::StarvationDetector> starved;
+    if (starvation) starved = std::make_unique<ssd::StarvationDetector>(num_users, starvation_opts);
+    if (live) {
+        ssd::Simulator sim(*scheduler, device, metrics, sim_opts);
+        sim.set_starvation_detector(starved.get());
+        std::ifstream fifo;
+        if (trace_path != "-") {
+            fifo.open(trace_path);
+            if (!fifo.is_open()) {
+                std::cerr << "Failed to open live input: " << trace_path << "\n";
+                return 1;
+            }
         }
-        // 4. Otherwise fast-forward to the next arrival if more requests exist.
-        else if (i < trace.size()) {
-            now = trace[i].arrival_ts;
+        std::istream& input = trace_path == "-" ? std::cin : fifo;
+        auto ls = ssd::run_live(input, live_opts, sim, std::cout);
+        sim_stats = sim.stats();
+        if (starved) starved->finish(sim.now());
+        std::cout << "Live input: " << ls.lines << " lines, " << ls.requests
+                  << " requests, " << ls.skipped << " skipped, " << ls.late
+                  << " late, " << ls.folded << " folded, " << ls.windows << " windows\n";
+    } else if (staged) {
+        ssd::Simulator sim(*scheduler, device, metrics, sim_opts);
+        sim.set_starvation_detector(starved.get());
+        ssd::StagedOptions staged_opts;
+        staged_opts.reorder_slack_s = live_opts.reorder_slack_s;
+        staged_opts.max_users = num_users;
+        staged_opts.window_s = window_given ? live_opts.window_s : 0.0;
+        auto st = ssd::run_staged(trace_path, staged_opts, sim, metrics, log_request, std::cout);
+        sim_stats = sim.stats();
+        if (starved) starved->finish(sim.now());
+        if (override_users <= 0) num_users = metrics.num_users();
+        std::cout << "Staged: " << st.requests << " requests, " << st.late << " late, "
+                  << st.folded << " folded, wall " << st.wall_s << " s\n";
+        std::cout << "stage,cpu_s,wait_s\n"
+                  << "loader," << st.loader_cpu_s << "," << st.loader_wait_s << "\n"
+                  << "simulation," << st.sim_cpu_s << "," << st.sim_wait_s << "\n"
+                  << "metrics," << st.sink_cpu_s << "," << st.sink_wait_s << "\n";
+    } else if (array) {
+        auto make_device_scheduler = [&]() {
+            return ssd::make_scheduler(policy_str, sched_opts);
+        };
+        ssd::ArraySimulator devices(array_opts, sim_cfg, make_device_scheduler, num_users,
+                                    weights, metrics, sim_opts);
+        if (log_request) devices.set_completion_hook(log_request);
+        devices.run(trace);
+        sim_stats.end_time = devices.end_time();
+
+        std::cout << "Array: " << array_opts.devices << " devices, stripe "
+                  << array_opts.stripe_bytes / 1024 << " KiB, dmClock coordination "
+                  << (devices.coordinated() ? "on" : "off") << "\n";
+        std::cout << "device,completed,MB,reserved_MB\n";
+        const auto& ds = devices.device_stats();
+        for (size_t d = 0; d < ds.size(); ++d)
+            std::cout << d << "," << ds[d].completed << ","
+                      << ds[d].bytes / (1024.0 * 1024.0) << ","
+                      << ds[d].reserved_bytes / (1024.0 * 1024.0) << "\n";
+        std::cout << "user_id,devices,MB,MBps\n";
+        for (int u = 0; u < num_users; ++u) {
+            uint64_t bytes = 0;
+            for (const auto& s : ds) bytes += s.user_bytes[u];
+            double mb = bytes / (1024.0 * 1024.0);
+            std::cout << u << "," << devices.spread(u) << "," << mb << ","
+                      << (sim_stats.end_time > 0.0 ? mb / sim_stats.end_time : 0.0) << "\n";
         }
-        // 5. Done
-        else break;
+    } else if (!use_fabric) {
+        ssd::Simulator sim(*scheduler, device, metrics, sim_opts);
+        if (log_request) sim.set_completion_hook(log_request);
+        sim.set_starvation_detector(starved.get());
+        sim.run(trace);
+        sim_stats = sim.stats();
+        if (starved) starved->finish(sim.now());
     }
 
     // ==== Output Results ====
-    if (!metrics.save_csv("build/results.csv")) {
-        std::cerr << "Warning: failed to write build/results.csv\n";
+    // With --topk the per-tenant rows are replaced by the heavy-hitter summary.
+    const char* results_path = topk ? "build/topk.csv" : "build/results.csv";
+    if (!(topk ? heavy->write_csv(results_path) : metrics.save_csv(results_path))) {
+        std::cerr << "Warning: failed to write " << results_path << "\n";
     }
 
     std::cout << "Simulation complete.\n";
     std::cout << "Fairness Index: " << metrics.fairness_index() << "\n";
-    std::cout << "Results saved to build/results.csv\n";
+    std::cout << "Results saved to " << results_path << "\n";
+
+    if (topk) {
+        // Heavy tenants are exact since they took their slot; count - error
+        // is a guaranteed lower bound on the whole run. The tail is every
+        // completion by a tenant outside the byte ranking at the time.
+        const ssd::CountMinSketch& cm = heavy->bytes_sketch();
+        std::cout << "Top-K: " << heavy->requests() << " requests, ~"
+                  << static_cast<uint64_t>(heavy->distinct_tenants() + 0.5) << " tenants, k "
+                  << topk_opts.k << ", sketch " << cm.width() << "x" << cm.depth()
+                  << ", per-tenant MB error <= " << cm.error_bound() / (1024.0 * 1024.0) << "\n";
+        struct Row { const char* name; ssd::TopKBasis basis; };
+        const Row rows[] = {
+            { "bytes", ssd::TopKBasis::Bytes },
+            { "requests", ssd::TopKBasis::Requests },
+            { "load", ssd::TopKBasis::Load },
+        };
+        std::cout << "ranking,rank,user_id,estimate,guaranteed,MB,mean_latency_s,p99_latency_s\n";
+        for (const auto& row : rows) {
+            const ssd::SpaceSaving& ss = heavy->ranking(row.basis);
+            auto order = ss.ranked();
+            for (size_t i = 0; i < std::min<size_t>(order.size(), 10); ++i) {
+                const auto& slot = ss.slot(order[i]);
+                const ssd::TenantSummary& s = heavy->summary(row.basis, order[i]);
+                std::cout << row.name << "," << i + 1 << "," << slot.key << "," << slot.count
+                          << "," << slot.count - slot.error << ","
+                          << s.bytes / (1024.0 * 1024.0) << ","
+                          << (s.requests > 0 ? s.latency_sum_s / s.requests : 0.0) << ","
+                          << s.latency_ns.quantile(0.99) * 1e-9 << "\n";
+            }
+        }
+        double tail_n = static_cast<double>(std::max<uint64_t>(heavy->tail_requests(), 1));
+        std::cout << "Tail: " << heavy->tail_requests() << " requests ("
+                  << (heavy->requests() > 0 ? 100.0 * heavy->tail_requests() / heavy->requests() : 0.0)
+                  << "%), "
+                  << (heavy->bytes() > 0 ? 100.0 * heavy->tail_bytes() / heavy->bytes() : 0.0)
+                  << "% of bytes, mean latency " << heavy->tail_latency_sum_s() / tail_n
+                  << " s, p99 " << heavy->tail_latency_ns().quantile(0.99) * 1e-9
+                  << " s; all tenants p99 " << heavy->latency_ns().quantile(0.99) * 1e-9 << " s\n";
+    }
+
+    // Latency-side fairness, per tenant mean/p99 response time and slowdown.
+    {
+        struct Row { const char* name; ssd::LatencyBasis basis; };
+        const Row rows[] = {
+            { "mean_latency", ssd::LatencyBasis::MeanLatency },
+            { "p99_latency", ssd::LatencyBasis::P99Latency },
+            { "mean_slowdown", ssd::LatencyBasis::MeanSlowdown },
+            { "p99_slowdown", ssd::LatencyBasis::P99Slowdown },
+        };
+        std::cout << "basis,jain,max_min,cov,gini\n";
+        for (int weighted = 0; weighted < (weights.empty() ? 1 : 2); ++weighted) {
+            for (const auto& row : rows) {
+                bool p99 = row.basis == ssd::LatencyBasis::P99Latency ||
+                           row.basis == ssd::LatencyBasis::P99Slowdown;
+                if (p99 && !metrics.tracks_quantiles()) continue;
+                ssd::FairnessSuite f = metrics.latency_fairness(row.basis, weighted != 0);
+                std::cout << (weighted ? "weighted_" : "") << row.name << "," << f.jain << ","
+                          << f.max_min << "," << f.cov << "," << f.gini << "\n";
+            }
+        }
+    }
+
+    if (starved) {
+        // A gap is the time a backlogged tenant waited for its next dispatch;
+        // wait is how long the dispatched request itself had been queued.
+        const auto& events = starved->events();
+        size_t gap_events = 0;
+        for (const auto& e : events) gap_events += e.kind == ssd::StarvationKind::Gap;
+        int worst = -1;
+        for (int u = 0; u < starved->num_users(); ++u)
+            if (worst < 0 || starved->tenant(u).max_gap_s > starved->tenant(worst).max_gap_s)
+                worst = u;
+        std::cout << "Starvation: " << gap_events << " gap episodes over "
+                  << starvation_opts.gap_threshold_s * 1000.0 << " ms, "
+                  << events.size() - gap_events << " age episodes over "
+                  << starvation_opts.age_threshold_s * 1000.0 << " ms, peak "
+                  << starved->peak_starving() << " tenants starving at once";
+        if (worst >= 0)
+            std::cout << ", worst gap " << starved->tenant(worst).max_gap_s << " s (user "
+                      << worst << ")";
+        std::cout << "\n";
+        if (!starvation_events.empty()) {
+            if (starved->write_events_csv(starvation_events))
+                std::cout << "Starvation events saved to " << starvation_events << "\n";
+            else
+                std::cerr << "Warning: failed to write " << starvation_events << "\n";
+        }
+        if (!topk) {
+            std::cout << "user_id,gaps,p50_gap_s,p99_gap_s,max_gap_s,max_wait_s,gap_events,"
+                         "age_events,starved_s\n";
+            for (int u = 0; u < starved->num_users(); ++u) {
+                const ssd::TenantStarvation& ts = starved->tenant(u);
+                if (ts.gap_ns.count() == 0) continue;
+                std::cout << u << "," << ts.gap_ns.count() << ","
+                          << ts.gap_ns.quantile(0.5) * 1e-9 << ","
+                          << ts.gap_ns.quantile(0.99) * 1e-9 << "," << ts.max_gap_s << ","
+                          << ts.max_wait_s << "," << ts.gap_events << "," << ts.age_events << ","
+                          << ts.starved_s << "\n";
+            }
+        }
+    }
+
+    // Overhead, thermal and FTL reports describe a single device.
+    if (sim_opts.charge_overhead && !use_fabric && !array) {
+        double ns = sim_stats.dispatched > 0
+            ? sim_stats.scheduler_cpu_s * 1e9 / sim_stats.dispatched : 0.0;
+        std::cout << "Scheduler overhead: " << ns << " ns/request, IOPS ceiling "
+                  << sim_stats.iops_ceiling() << ", achieved IOPS "
+                  << sim_stats.achieved_iops() << ", host CPU charged "
+                  << sim_stats.host_cpu_busy_s << " s\n";
+    }
+
+    if (sim_cfg.thermal.enabled && !array) {
+        const auto& thermal_model = device.thermal();
+        std::cout << "Thermal: peak heat " << thermal_model.peak_heat()
+                  << ", throttle transitions " << thermal_model.transitions()
+                  << ", final rate scale " << device.rate_scale() << "\n";
+        const auto& ts = device.thermal_stats();
+        double total_busy = 0.0, total_penalty = 0.0;
+        for (const auto& t : ts) {
+            total_busy += t.busy_s;
+            total_penalty += t.throttle_delay_s + t.wake_delay_s;
+        }
+        // With the FTL on, GC stalls are reported next to, not inside, throttling.
+        bool gc = device.ftl() != nullptr;
+        std::cout << "user_id,heat_share,throttle_delay_s,wake_delay_s,penalty_share"
+                  << (gc ? ",gc_stall_s" : "") << "\n";
+        for (size_t u = 0; u < ts.size(); ++u) {
+            double penalty = ts[u].throttle_delay_s + ts[u].wake_delay_s;
+            std::cout << u << ","
+                      << (total_busy > 0.0 ? ts[u].busy_s / total_busy : 0.0) << ","
+                      << ts[u].throttle_delay_s << ","
+                      << ts[u].wake_delay_s << ","
+                      << (total_penalty > 0.0 ? penalty / total_penalty : 0.0);
+            if (gc) std::cout << "," << ts[u].ftl_stall_s;
+            std::cout << "\n";
+        }
+    }
+
+    if (const ssd::Ftl* ftl = array ? nullptr : device.ftl()) {
+        // Wear is reported against the simulated span, extrapolated to a day.
+        double elapsed = 0.0;
+        for (const auto& r : trace) elapsed = std::max(elapsed, r.arrival_ts);
+        elapsed = std::max(elapsed, sim_stats.end_time);
+        double days = elapsed / 86400.0;
+        double logical = static_cast<double>(ftl->logical_bytes());
+        double page = static_cast<double>(ftl->config().page_bytes);
+        double host = static_cast<double>(ftl->host_pages());
+        double phys = static_cast<double>(ftl->physical_pages());
+
+        std::cout << "FTL: " << ftl->num_blocks() << " blocks, WAF "
+                  << (host > 0.0 ? phys / host : 1.0) << ", erases min/mean/max "
+                  << ftl->min_erase_count() << "/" << ftl->mean_erase_count() << "/"
+                  << ftl->max_erase_count() << ", projected lifetime "
+                  << ftl->projected_lifetime_s(elapsed) / 86400.0 << " days\n";
+        std::cout << "user_id,host_MB,physical_MB,waf,dwpd_used,dwpd_share,lifetime_days,held_s\n";
+        double total_weight = 0.0;
+        for (int u = 0; u < num_users; ++u)
+            total_weight += u < static_cast<int>(weights.size()) && weights[u] > 0.0 ? weights[u] : 1.0;
+        const auto& wear = ftl->tenant_wear();
+        for (int u = 0; u < num_users; ++u) {
+            ssd::TenantWear tw = u < static_cast<int>(wear.size()) ? wear[u] : ssd::TenantWear{};
+            double host_b = static_cast<double>(tw.host_pages) * page;
+            double phys_b = static_cast<double>(tw.physical_pages()) * page;
+            double w = u < static_cast<int>(weights.size()) && weights[u] > 0.0 ? weights[u] : 1.0;
+            // Physical drive writes per day this tenant is causing, and how
+            // long the rated P/E budget would last if it wrote alone.
+            double dwpd_used = days > 0.0 ? phys_b / logical / days : 0.0;
+            double rated = static_cast<double>(ftl->config().pe_cycles) *
+                           static_cast<double>(ftl->num_blocks()) *
+                           ftl->config().pages_per_block * page;
+            double lifetime_days = phys_b > 0.0 ? rated / phys_b * days
+                                                 : std::numeric_limits<double>::infinity();
+            std::cout << u << "," << host_b / (1024.0 * 1024.0) << ","
+                      << phys_b / (1024.0 * 1024.0) << "," << ftl->tenant_waf(u) << ","
+                      << dwpd_used << "," << ftl_cfg.dwpd * w / total_weight << ","
+                      << lifetime_days << "," << (endurance ? endurance->held_s(u) : 0.0)
+                      << "\n";
+        }
+
+        if (ftl->num_namespaces() > 1) {
+            // gc_stall_s is the GC time a namespace's own writes waited for;
+            // foreign_gc_share is the part spent moving other namespaces' data.
+            const FtlConfig& fc = ftl->config();
+            double copy_s = fc.page_read_s + fc.page_program_s;
+            std::cout << "nsid,pool,logical_MB,op,gc,host_MB,waf,gc_stall_s,foreign_gc_share\n";
+            for (int ns = 0; ns < ftl->num_namespaces(); ++ns) {
+                const ssd::NamespaceStats& st = ftl->namespace_stats(ns);
+                const NamespaceConfig& nc = fc.namespaces[ns];
+                double hp = static_cast<double>(st.host_pages);
+                std::cout << ns << "," << ftl->namespace_pool(ns) << ","
+                          << static_cast<double>(ftl->namespace_logical_pages(ns)) * page /
+                                 (1024.0 * 1024.0) << ","
+                          << nc.over_provisioning << ","
+                          << (nc.gc == GcPolicy::Fifo ? "fifo" : "greedy") << ","
+                          << hp * page / (1024.0 * 1024.0) << ","
+                          << (hp > 0.0 ? (hp + static_cast<double>(st.relocated_pages)) / hp : 1.0)
+                          << ","
+                          << static_cast<double>(st.triggered_copies) * copy_s +
+                                 static_cast<double>(st.triggered_erases) * fc.block_erase_s
+                          << ","
+                          << (st.triggered_copies > 0
+                                  ? static_cast<double>(st.foreign_copies) /
+                                        static_cast<double>(st.triggered_copies)
+                                  : 0.0)
+                          << "\n";
+            }
+        }
+    }
 
     return 0;
 }
@@ -0,0 +1,91 @@
+#include "mapped_trace.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kImageMagic[8] = { 'S', 'S', 'D', 'R', 'E', 'Q', 'S', '1' };
+
+// ImageHeader precedes the request array; its size keeps the array aligned.
+struct ImageHeader {
+    char magic[8];
+    uint32_t request_bytes;  // sizeof(Request) of the writer
+    uint32_t num_users;
+    uint64_t count;
+};
+
+static_assert(sizeof(ImageHeader) % alignof(Request) == 0,
+              "request array must stay aligned after the header");
+
+} // namespace
+
+namespace util {
+
+void write_request_image(const std::string& path, const std::vector<Request>& trace,
+                         int num_users) {
+    ImageHeader header{};
+    std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+    header.request_bytes = sizeof(Request);
+    header.num_users = static_cast<uint32_t>(num_users > 0 ? num_users : 0);
+    header.count = trace.size();
+
+    // Write to a temporary name first so readers never map a partial image.
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Cannot create request image: " + tmp);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(trace.data()),
+                  static_cast<std::streamsize>(trace.size() * sizeof(Request)));
+        if (!out) throw std::runtime_error("Failed writing request image: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Cannot publish request image: " + path);
+}
+
+MappedTrace::MappedTrace(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Cannot open request image: " + path);
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ImageHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Request image too small: " + path);
+    }
+    mapped_bytes_ = static_cast<size_t>(st.st_size);
+    base_ = ::mmap(nullptr, mapped_bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        throw std::runtime_error("Cannot map request image: " + path);
+    }
+
+    const auto* header = static_cast<const ImageHeader*>(base_);
+    if (std::memcmp(header->magic, kImageMagic, sizeof(kImageMagic)) != 0 ||
+        header->request_bytes != sizeof(Request) ||
+        header->count > (mapped_bytes_ - sizeof(ImageHeader)) / sizeof(Request)) {
+        ::munmap(base_, mapped_bytes_);
+        base_ = nullptr;
+        throw std::runtime_error("Not a compatible request image: " + path);
+    }
+    count_ = static_cast<size_t>(header->count);
+    num_users_ = static_cast<int>(header->num_users);
+    requests_ = reinterpret_cast<const Request*>(static_cast<const char*>(base_) +
+                                                 sizeof(ImageHeader));
+    // Replays read front to back.
+    ::madvise(base_, mapped_bytes_, MADV_SEQUENTIAL);
+}
+
+MappedTrace::~MappedTrace() {
+    if (base_) ::munmap(base_, mapped_bytes_);
+}
+
+} // namespace util
@@ -1,11 +1,103 @@
 #include "metrics.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <numeric>
+#include <stdexcept>
 
 namespace ssd {
 
+namespace {
+
+constexpr uint64_t kSubBuckets = uint64_t{1} << LogHistogram::kSubBits;
+
+// bucket_of maps |v| to its log-linear bucket: the exponent picks the group,
+// the kSubBits bits below the leading one pick the sub-bucket.
+size_t bucket_of(uint64_t v) {
+    if (v < kSubBuckets) return static_cast<size_t>(v);
+    int e = 63 - __builtin_clzll(v);
+    int shift = e - LogHistogram::kSubBits;
+    return static_cast<size_t>((shift + 1) * kSubBuckets + ((v >> shift) & (kSubBuckets - 1)));
+}
+
+uint64_t bucket_upper(size_t b) {
+    if (b < kSubBuckets) return b;
+    int shift = static_cast<int>(b / kSubBuckets) - 1;
+    uint64_t lower = (kSubBuckets + b % kSubBuckets) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+uint64_t to_units(double v, double scale) {
+    if (!(v > 0.0)) return 0;
+    double u = std::round(v * scale);
+    return u >= 1.8e19 ? std::numeric_limits<uint64_t>::max() : static_cast<uint64_t>(u);
+}
+
+constexpr double kNsPerSecond = 1e9;
+constexpr double kMilli = 1e3;
+
+} // namespace
+
+void LogHistogram::record(uint64_t v) {
+    size_t b = bucket_of(v);
+    if (b >= counts_.size()) counts_.resize(b + 1, 0);
+    ++counts_[b];
+    ++total_;
+}
+
+void LogHistogram::merge(const LogHistogram& other) {
+    if (other.counts_.size() > counts_.size()) counts_.resize(other.counts_.size(), 0);
+    for (size_t b = 0; b < other.counts_.size(); ++b) counts_[b] += other.counts_[b];
+    total_ += other.total_;
+}
+
+void LogHistogram::clear() {
+    counts_.clear();
+    total_ = 0;
+}
+
+uint64_t LogHistogram::quantile(double q) const {
+    if (total_ == 0) return 0;
+    q = std::clamp(q, 0.0, 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total_))));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < counts_.size(); ++b) {
+        seen += counts_[b];
+        if (seen >= rank) return bucket_upper(b);
+    }
+    return bucket_upper(counts_.size() - 1);
+}
+
+// fairness_suite sorts a copy of |x| once for Gini; the other metrics are
+// single passes over sums.
+FairnessSuite fairness_suite(std::vector<double> x) {
+    FairnessSuite out;
+    if (x.empty()) return out;
+    std::sort(x.begin(), x.end());
+    double n = static_cast<double>(x.size());
+    double sum = 0.0, sum_sq = 0.0, ranked = 0.0;
+    for (size_t i = 0; i < x.size(); ++i) {
+        sum += x[i];
+        sum_sq += x[i] * x[i];
+        ranked += (2.0 * static_cast<double>(i + 1) - n - 1.0) * x[i];
+    }
+    if (sum_sq == 0.0) {
+        // Every value is zero: perfectly even.
+        out.jain = 1.0;
+        out.max_min = 1.0;
+        return out;
+    }
+    double mean = sum / n;
+    out.jain = (sum * sum) / (n * sum_sq);
+    out.max_min = x.front() > 0.0 ? x.back() / x.front() : std::numeric_limits<double>::infinity();
+    out.cov = std::sqrt(std::max(0.0, sum_sq / n - mean * mean)) / mean;
+    out.gini = ranked / (n * sum);
+    return out;
+}
+
 Metrics::Metrics(int num_users) {
     reset(num_users);
 }
@@ -13,21 +105,51 @@ Metrics::Metrics(int num_users) {
 // reset prepares collectors for |num_users| tenants.
 void Metrics::reset(int num_users) {
     stats_.assign(std::max(num_users, 0), {});
+    latency_ns_.clear();
+    slowdown_milli_.clear();
+    if (track_quantiles_) {
+        latency_ns_.resize(stats_.size());
+        slowdown_milli_.resize(stats_.size());
+    }
+}
+
+void Metrics::track_quantiles(bool on) {
+    track_quantiles_ = on;
+    latency_ns_.clear();
+    slowdown_milli_.clear();
+    if (on) {
+        latency_ns_.resize(stats_.size());
+        slowdown_milli_.resize(stats_.size());
+    }
 }
 
 // on_finish accumulates latency and throughput for the provided request.
 void Metrics::on_finish(const Request& req) {
     if (req.user_id < 0) return;
-    if (req.user_id >= static_cast<int>(stats_.size()))
+    if (req.user_id >= static_cast<int>(stats_.size())) {
         stats_.resize(req.user_id + 1);
+        if (track_quantiles_) {
+            latency_ns_.resize(stats_.size());
+            slowdown_milli_.resize(stats_.size());
+        }
+    }
 
     auto& s = stats_[req.user_id];
     double latency = req.finish_ts - req.arrival_ts;
     if (latency < 0) latency = 0.0;
+    // Slowdown is 1 for a request that never waited; a zero-length service
+    // (empty request) counts as not slowed down.
+    double service = req.finish_ts - req.start_ts;
+    double slowdown = service > 0.0 ? std::max(1.0, latency / service) : 1.0;
 
     s.completed += 1;
     s.total_latency += latency;
+    s.total_slowdown += slowdown;
     s.bytes += req.size_bytes;
+    if (track_quantiles_) {
+        latency_ns_[req.user_id].record(to_units(latency, kNsPerSecond));
+        slowdown_milli_[req.user_id].record(to_units(slowdown, kMilli));
+    }
 }
 
 double Metrics::avg_latency(int user_id) const {
@@ -36,6 +158,22 @@ double Metrics::avg_latency(int user_id) const {
     return stats_[user_id].total_latency / static_cast<double>(stats_[user_id].completed);
 }
 
+double Metrics::latency_quantile(int user_id, double q) const {
+    if (user_id < 0 || user_id >= static_cast<int>(latency_ns_.size())) return 0.0;
+    return static_cast<double>(latency_ns_[user_id].quantile(q)) / kNsPerSecond;
+}
+
+double Metrics::avg_slowdown(int user_id) const {
+    if (user_id < 0 || user_id >= static_cast<int>(stats_.size()) || stats_[user_id].completed == 0)
+        return 0.0;
+    return stats_[user_id].total_slowdown / static_cast<double>(stats_[user_id].completed);
+}
+
+double Metrics::slowdown_quantile(int user_id, double q) const {
+    if (user_id < 0 || user_id >= static_cast<int>(slowdown_milli_.size())) return 0.0;
+    return static_cast<double>(slowdown_milli_[user_id].quantile(q)) / kMilli;
+}
+
 uint64_t Metrics::total_bytes(int user_id) const {
     if (user_id < 0 || user_id >= static_cast<int>(stats_.size()))
         return 0;
@@ -65,6 +203,32 @@ double Metrics::fairness_index() const {
     return (sum * sum) / (participants * sum_sq);
 }
 
+FairnessSuite Metrics::latency_fairness(LatencyBasis basis, bool weighted) const {
+    bool tail = basis == LatencyBasis::P99Latency || basis == LatencyBasis::P99Slowdown;
+    if (tail && !track_quantiles_)
+        throw std::logic_error("P99 latency fairness needs Metrics::track_quantiles");
+
+    std::vector<double> x;
+    std::vector<double> w;
+    for (int u = 0; u < num_users(); ++u) {
+        if (stats_[u].completed == 0) continue;
+        double v = 0.0;
+        switch (basis) {
+        case LatencyBasis::MeanLatency: v = avg_latency(u); break;
+        case LatencyBasis::P99Latency: v = latency_quantile(u, 0.99); break;
+        case LatencyBasis::MeanSlowdown: v = avg_slowdown(u); break;
+        case LatencyBasis::P99Slowdown: v = slowdown_quantile(u, 0.99); break;
+        }
+        x.push_back(v);
+        w.push_back(u < static_cast<int>(weights_.size()) && weights_[u] > 0.0 ? weights_[u] : 1.0);
+    }
+    if (weighted && !x.empty()) {
+        double mean_w = std::accumulate(w.begin(), w.end(), 0.0) / static_cast<double>(w.size());
+        for (size_t i = 0; i < x.size(); ++i) x[i] *= w[i] / mean_w;
+    }
+    return fairness_suite(std::move(x));
+}
+
 // save_csv persists a per-user summary so downstream tools can analyze results.
 bool Metrics::save_csv(const std::string& path) const {
     std::filesystem::path file_path(path);
@@ -0,0 +1,212 @@
+#include "pipeline.hpp"
+#include "dmclock.hpp"
+
+#include <map>
+#include <sstream>
+
+namespace ssd {
+
+namespace {
+
+// Build<T>::make constructs stage type |T| and everything it holds from the
+// CLI options. Base policies are default-constructed, except dmclock, which
+// takes its reservations and limits from the options.
+template <typename T>
+struct Build {
+    static T make(const SchedulerOptions&) { return T(); }
+};
+
+template <>
+struct Build<DmClockScheduler> {
+    static DmClockScheduler make(const SchedulerOptions& opts) { return DmClockScheduler(opts); }
+};
+
+template <typename Inner>
+struct Build<RotateStage<Inner>> {
+    static RotateStage<Inner> make(const SchedulerOptions& opts) {
+        RotateStage<Inner> stage(Build<Inner>::make(opts));
+        stage.set_start_gap(opts.sgfs_rotate_every, opts.sgfs_gap);
+        return stage;
+    }
+};
+
+template <typename Inner>
+struct Build<PrioStage<Inner>> {
+    static PrioStage<Inner> make(const SchedulerOptions& opts) {
+        return PrioStage<Inner>(opts, [&opts] { return Build<Inner>::make(opts); });
+    }
+};
+
+template <typename Inner>
+struct Build<TokenBucketStage<Inner>> {
+    static TokenBucketStage<Inner> make(const SchedulerOptions& opts) {
+        return TokenBucketStage<Inner>(opts, Build<Inner>::make(opts));
+    }
+};
+
+template <typename Inner>
+struct Build<ReadWriteSplitStage<Inner>> {
+    static ReadWriteSplitStage<Inner> make(const SchedulerOptions& opts) {
+        return ReadWriteSplitStage<Inner>(opts, Build<Inner>::make(opts),
+                                          Build<Inner>::make(opts));
+    }
+};
+
+template <typename Inner>
+struct Build<SizeClassStage<Inner>> {
+    static SizeClassStage<Inner> make(const SchedulerOptions& opts) {
+        return SizeClassStage<Inner>(opts, [&opts] { return Build<Inner>::make(opts); });
+    }
+};
+
+using Factory = std::unique_ptr<Scheduler> (*)(const SchedulerOptions&);
+using Registry = std::map<std::string, Factory>;
+
+template <typename T>
+std::unique_ptr<Scheduler> build_static(const SchedulerOptions& opts) {
+    return std::make_unique<T>(Build<T>::make(opts));
+}
+
+// kKeepsRates marks cores holding per-tenant rate state, which a size stage
+// would duplicate per class.
+template <typename Core>
+constexpr bool kKeepsRates = false;
+template <>
+constexpr bool kKeepsRates<DmClockScheduler> = true;
+template <>
+constexpr bool kKeepsRates<RotateStage<DmClockScheduler>> = true;
+
+// register_core adds |Core| and the pre-stage chains registered over it.
+template <typename Core>
+void register_core(Registry& reg, const std::string& core) {
+    reg[core] = &build_static<Core>;
+    reg["prio>" + core] = &build_static<PrioStage<Core>>;
+    reg["tbf>" + core] = &build_static<TokenBucketStage<Core>>;
+    reg["prio>tbf>" + core] = &build_static<PrioStage<TokenBucketStage<Core>>>;
+    reg["rw>" + core] = &build_static<ReadWriteSplitStage<Core>>;
+    reg["prio>rw>" + core] = &build_static<PrioStage<ReadWriteSplitStage<Core>>>;
+    if constexpr (!kKeepsRates<Core>) {
+        reg["size>" + core] = &build_static<SizeClassStage<Core>>;
+        reg["prio>size>" + core] = &build_static<PrioStage<SizeClassStage<Core>>>;
+    }
+}
+
+template <typename Base>
+void register_base(Registry& reg, const std::string& name) {
+    register_core<Base>(reg, name);
+    register_core<RotateStage<Base>>(reg, name + ">sgfs");
+}
+
+const Registry& static_pipelines() {
+    static const Registry reg = [] {
+        Registry r;
+        register_base<RoundRobinScheduler>(r, "rr");
+        register_base<DeficitRoundRobinScheduler>(r, "drr");
+        register_base<WeightedFairScheduler>(r, "qfq");
+        register_base<DmClockScheduler>(r, "dmclock");
+        return r;
+    }();
+    return reg;
+}
+
+bool is_base(const std::string& s) {
+    return s == "rr" || s == "drr" || s == "qfq" || s == "dmclock";
+}
+bool is_pre(const std::string& s) {
+    return s == "prio" || s == "tbf" || s == "rw" || s == "size";
+}
+
+// parse_spec splits |spec| into stages and checks it has the shape
+// pre* base sgfs*. "sgfs" alone is shorthand for "qfq>sgfs". A size stage
+// runs one copy of the rest of the chain per class, so it may not precede
+// tbf or dmclock: each copy would grant a tenant its full rate again.
+bool parse_spec(const std::string& spec, std::vector<std::string>& stages) {
+    stages.clear();
+    std::stringstream ss(spec);
+    std::string stage;
+    while (std::getline(ss, stage, '>')) stages.push_back(stage);
+    if (stages.size() == 1 && stages[0] == "sgfs") stages = { "qfq", "sgfs" };
+
+    size_t i = 0;
+    bool sized = false;
+    while (i < stages.size() && is_pre(stages[i])) {
+        if (sized && stages[i] == "tbf") return false;
+        sized = sized || stages[i] == "size";
+        ++i;
+    }
+    if (i == stages.size() || !is_base(stages[i])) return false;
+    if (sized && stages[i] == "dmclock") return false;
+    for (++i; i < stages.size(); ++i)
+        if (stages[i] != "sgfs") return false;
+    return true;
+}
+
+std::string join(const std::vector<std::string>& stages) {
+    std::string out;
+    for (const auto& s : stages) out += (out.empty() ? "" : ">") + s;
+    return out;
+}
+
+// build_dynamic builds stages[from..] with every stage boundary behind a
+// SchedulerHandle.
+std::unique_ptr<Scheduler> build_dynamic(const std::vector<std::string>& stages,
+                                         size_t from, const SchedulerOptions& opts) {
+    const std::string& s = stages[from];
+    if (s == "prio") {
+        return std::make_unique<PrioStage<SchedulerHandle>>(opts, [&stages, from, &opts] {
+            return SchedulerHandle(build_dynamic(stages, from + 1, opts));
+        });
+    }
+    if (s == "rw") {
+        return std::make_unique<ReadWriteSplitStage<SchedulerHandle>>(
+            opts, SchedulerHandle(build_dynamic(stages, from + 1, opts)),
+            SchedulerHandle(build_dynamic(stages, from + 1, opts)));
+    }
+    if (s == "size") {
+        return std::make_unique<SizeClassStage<SchedulerHandle>>(opts, [&stages, from, &opts] {
+            return SchedulerHandle(build_dynamic(stages, from + 1, opts));
+        });
+    }
+    if (s == "tbf") {
+        return std::make_unique<TokenBucketStage<SchedulerHandle>>(
+            opts, SchedulerHandle(build_dynamic(stages, from + 1, opts)));
+    }
+
+    std::unique_ptr<Scheduler> core;
+    if (s == "rr") core = std::make_unique<RoundRobinScheduler>();
+    else if (s == "drr") core = std::make_unique<DeficitRoundRobinScheduler>();
+    else if (s == "dmclock") core = std::make_unique<DmClockScheduler>(opts);
+    else core = std::make_unique<WeightedFairScheduler>();
+    for (size_t i = from + 1; i < stages.size(); ++i) {
+        auto rotate = std::make_unique<StartGapScheduler>(std::move(core));
+        rotate->set_start_gap(opts.sgfs_rotate_every, opts.sgfs_gap);
+        core = std::move(rotate);
+    }
+    return core;
+}
+
+} // namespace
+
+std::unique_ptr<Scheduler> make_pipeline(const std::string& spec,
+                                         const SchedulerOptions& opts,
+                                         bool force_dynamic) {
+    std::vector<std::string> stages;
+    if (!parse_spec(spec, stages)) return nullptr;
+
+    std::unique_ptr<Scheduler> scheduler;
+    const auto& reg = static_pipelines();
+    auto it = reg.find(join(stages));
+    if (it != reg.end() && !force_dynamic)
+        scheduler = it->second(opts);
+    else
+        scheduler = build_dynamic(stages, 0, opts);
+    scheduler->set_quantum(opts.quantum);
+    return scheduler;
+}
+
+bool is_static_pipeline(const std::string& spec) {
+    std::vector<std::string> stages;
+    return parse_spec(spec, stages) && static_pipelines().count(join(stages)) > 0;
+}
+
+} // namespace ssd
@@ -0,0 +1,328 @@
+#include "sampling.hpp"
+#include "simulator.hpp"
+#include "ssd.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <random>
+#include <thread>
+
+namespace ssd {
+
+namespace {
+
+constexpr size_t kSizeBuckets = 4;  // <=4K, <=16K, <=64K, larger
+constexpr size_t kFixedFeatures = 3 + kSizeBuckets;
+constexpr int kMaxIterations = 100;
+
+size_t size_bucket(uint32_t bytes) {
+    if (bytes <= 4096) return 0;
+    if (bytes <= 16384) return 1;
+    if (bytes <= 65536) return 2;
+    return 3;
+}
+
+// interval_bounds returns the first trace index of each interval plus a final
+// end index, so interval i covers [bounds[i], bounds[i + 1]).
+std::vector<size_t> interval_bounds(const std::vector<Request>& trace, double interval_s) {
+    if (trace.empty() || interval_s <= 0.0) return { 0, trace.size() };
+    double t0 = trace.front().arrival_ts;
+    size_t n = static_cast<size_t>((trace.back().arrival_ts - t0) / interval_s) + 1;
+    std::vector<size_t> bounds;
+    bounds.reserve(n + 1);
+    auto it = trace.begin();
+    for (size_t i = 0; i < n; ++i) {
+        double start = t0 + static_cast<double>(i) * interval_s;
+        it = std::lower_bound(it, trace.end(), start, [](const Request& r, double t) {
+            return r.arrival_ts < t;
+        });
+        bounds.push_back(static_cast<size_t>(it - trace.begin()));
+    }
+    bounds.push_back(trace.size());
+    return bounds;
+}
+
+double distance_sq(const std::vector<double>& a, const std::vector<double>& b) {
+    double d = 0.0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        double x = a[i] - b[i];
+        d += x * x;
+    }
+    return d;
+}
+
+// IntervalResult holds the measured per-user totals of one representative.
+struct IntervalResult {
+    Metrics metrics;
+    size_t simulated = 0;
+};
+
+} // namespace
+
+std::vector<std::vector<double>> interval_features(const std::vector<Request>& trace,
+                                                   double interval_s, int feature_tenants) {
+    feature_tenants = std::max(feature_tenants, 1);
+    auto bounds = interval_bounds(trace, interval_s);
+    size_t n = bounds.size() - 1;
+    std::vector<std::vector<double>> features(n, std::vector<double>(kFixedFeatures + feature_tenants, 0.0));
+
+    double max_rate = 0.0, max_bytes = 0.0;
+    int max_uid = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto& f = features[i];
+        double count = static_cast<double>(bounds[i + 1] - bounds[i]);
+        double bytes = 0.0, reads = 0.0;
+        for (size_t r = bounds[i]; r < bounds[i + 1]; ++r) {
+            const Request& req = trace[r];
+            int uid = std::max(req.user_id, 0);
+            max_uid = std::max(max_uid, uid);
+            bytes += req.size_bytes;
+            reads += req.op == OpType::READ ? 1.0 : 0.0;
+            f[3 + size_bucket(req.size_bytes)] += 1.0;
+            f[kFixedFeatures + static_cast<size_t>(uid % feature_tenants)] += 1.0;
+        }
+        f[0] = count;
+        f[1] = bytes;
+        if (count > 0.0) {
+            f[2] = reads / count;
+            for (size_t d = 3; d < f.size(); ++d) f[d] /= count;
+        }
+        max_rate = std::max(max_rate, count);
+        max_bytes = std::max(max_bytes, bytes);
+    }
+    // Tenant slots past the highest user ID are always zero; drop them so
+    // k-means doesn't pay for them.
+    size_t dims = kFixedFeatures + std::min<size_t>(feature_tenants, static_cast<size_t>(max_uid) + 1);
+    for (auto& f : features) f.resize(dims);
+    // Rates are scaled to the busiest interval so every dimension is in [0, 1].
+    for (auto& f : features) {
+        if (max_rate > 0.0) f[0] /= max_rate;
+        if (max_bytes > 0.0) f[1] /= max_bytes;
+    }
+    return features;
+}
+
+std::vector<int> kmeans(const std::vector<std::vector<double>>& points, int k, uint64_t seed) {
+    size_t n = points.size();
+    std::vector<int> assign(n, 0);
+    if (n == 0) return assign;
+    k = static_cast<int>(std::min<size_t>(std::max(k, 1), n));
+
+    // k-means++: each next center is drawn with probability proportional to
+    // the squared distance from the nearest center chosen so far.
+    std::mt19937_64 rng(seed);
+    std::vector<std::vector<double>> centers;
+    centers.push_back(points[rng() % n]);
+    std::vector<double> nearest(n, std::numeric_limits<double>::infinity());
+    while (static_cast<int>(centers.size()) < k) {
+        double total = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+            nearest[i] = std::min(nearest[i], distance_sq(points[i], centers.back()));
+            total += nearest[i];
+        }
+        if (total <= 0.0) break;  // fewer distinct points than k
+        double pick = std::uniform_real_distribution<double>(0.0, total)(rng);
+        size_t next = 0;
+        for (double acc = nearest[0]; acc < pick && next + 1 < n;) acc += nearest[++next];
+        centers.push_back(points[next]);
+    }
+
+    size_t dims = points.front().size();
+    for (int iter = 0; iter < kMaxIterations; ++iter) {
+        bool changed = iter == 0;
+        for (size_t i = 0; i < n; ++i) {
+            int best = 0;
+            double best_d = distance_sq(points[i], centers[0]);
+            for (size_t c = 1; c < centers.size(); ++c) {
+                double d = distance_sq(points[i], centers[c]);
+                if (d < best_d) {
+                    best_d = d;
+                    best = static_cast<int>(c);
+                }
+            }
+            if (assign[i] != best) changed = true;
+            assign[i] = best;
+        }
+        if (!changed) break;
+
+        std::vector<std::vector<double>> sums(centers.size(), std::vector<double>(dims, 0.0));
+        std::vector<size_t> counts(centers.size(), 0);
+        for (size_t i = 0; i < n; ++i) {
+            ++counts[assign[i]];
+            for (size_t d = 0; d < dims; ++d) sums[assign[i]][d] += points[i][d];
+        }
+        for (size_t c = 0; c < centers.size(); ++c) {
+            if (counts[c] == 0) continue;  // keep an emptied center where it was
+            for (size_t d = 0; d < dims; ++d) sums[c][d] /= static_cast<double>(counts[c]);
+            centers[c] = std::move(sums[c]);
+        }
+    }
+
+    // Renumber densely so clusters that ended empty leave no gaps.
+    std::vector<int> remap(centers.size(), -1);
+    int next_id = 0;
+    for (auto& a : assign) {
+        if (remap[a] < 0) remap[a] = next_id++;
+        a = remap[a];
+    }
+    return assign;
+}
+
+double SampledRun::mean_latency(int user_id) const {
+    if (user_id < 0 || user_id >= static_cast<int>(completed.size()) || completed[user_id] <= 0.0)
+        return 0.0;
+    return latency_sum_s[user_id] / completed[user_id];
+}
+
+double SampledRun::overall_mean_latency() const {
+    double n = 0.0, sum = 0.0;
+    for (size_t u = 0; u < completed.size(); ++u) {
+        n += completed[u];
+        sum += latency_sum_s[u];
+    }
+    return n > 0.0 ? sum / n : 0.0;
+}
+
+double SampledRun::fairness_index() const {
+    double sum = 0.0, sum_sq = 0.0;
+    size_t participants = 0;
+    for (double b : bytes) {
+        if (b <= 0.0) continue;
+        ++participants;
+        sum += b;
+        sum_sq += b * b;
+    }
+    if (participants == 0 || sum_sq == 0.0) return 0.0;
+    return (sum * sum) / (static_cast<double>(participants) * sum_sq);
+}
+
+SampledRun run_sampled(const std::vector<Request>& trace, int num_users, const SimConfig& cfg,
+                       const std::function<std::unique_ptr<Scheduler>()>& make_scheduler,
+                       const std::vector<double>& weights, const SamplingOptions& opts) {
+    auto t_start = std::chrono::steady_clock::now();
+    SampledRun run;
+    auto bounds = interval_bounds(trace, opts.interval_s);
+    run.intervals = bounds.size() - 1;
+    auto features = interval_features(trace, opts.interval_s, opts.feature_tenants);
+    run.cluster_of = kmeans(features, opts.clusters, opts.seed);
+
+    int k = 0;
+    for (int c : run.cluster_of) k = std::max(k, c + 1);
+    run.cluster_sizes.assign(k, 0);
+    for (int c : run.cluster_of) ++run.cluster_sizes[c];
+
+    // The representative is the member closest to its cluster's centroid.
+    size_t dims = features.empty() ? 0 : features.front().size();
+    std::vector<std::vector<double>> centroids(k, std::vector<double>(dims, 0.0));
+    for (size_t i = 0; i < features.size(); ++i)
+        for (size_t d = 0; d < dims; ++d) centroids[run.cluster_of[i]][d] += features[i][d];
+    for (int c = 0; c < k; ++c)
+        for (auto& x : centroids[c]) x /= static_cast<double>(run.cluster_sizes[c]);
+    run.representatives.assign(k, 0);
+    std::vector<double> best(k, std::numeric_limits<double>::infinity());
+    for (size_t i = 0; i < features.size(); ++i) {
+        int c = run.cluster_of[i];
+        double d = distance_sq(features[i], centroids[c]);
+        if (d < best[c]) {
+            best[c] = d;
+            run.representatives[c] = i;
+        }
+    }
+
+    // Each representative runs independently on its own device and policy.
+    std::vector<IntervalResult> results(k);
+    auto simulate = [&](int c) {
+        size_t rep = run.representatives[c];
+        size_t begin = bounds[rep], end = bounds[rep + 1];
+        if (begin == end) return;
+        double measure_from = trace[begin].arrival_ts;
+        size_t warm = begin;
+        while (warm > 0 && trace[warm - 1].arrival_ts >= measure_from - opts.warmup_s) --warm;
+
+        auto scheduler = make_scheduler();
+        scheduler->set_users(num_users);
+        if (!weights.empty()) scheduler->set_weights(weights);
+        SSD device(cfg);
+        Metrics all(num_users);
+        IntervalResult& out = results[c];
+        out.metrics.reset(num_users);
+        Simulator sim(*scheduler, device, all, opts.sim);
+        sim.set_completion_hook([&out, measure_from](const Request& r) {
+            if (r.arrival_ts >= measure_from) out.metrics.on_finish(r);
+        });
+        sim.run(trace.data() + warm, end - warm);
+        out.simulated = end - warm;
+    };
+
+    int threads = opts.threads > 0 ? opts.threads
+                                   : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, std::max(k, 1));
+    if (threads <= 1) {
+        for (int c = 0; c < k; ++c) simulate(c);
+    } else {
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(threads);
+        for (int w = 0; w < threads; ++w) {
+            workers.emplace_back([&, w]() {
+                try {
+                    for (int c = w; c < k; c += threads) simulate(c);
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& t : workers) t.join();
+        for (auto& e : errors)
+            if (e) std::rethrow_exception(e);
+    }
+
+    run.completed.assign(std::max(num_users, 0), 0.0);
+    run.bytes.assign(run.completed.size(), 0.0);
+    run.latency_sum_s.assign(run.completed.size(), 0.0);
+    for (int c = 0; c < k; ++c) {
+        const Metrics& m = results[c].metrics;
+        double scale = static_cast<double>(run.cluster_sizes[c]);
+        run.simulated_requests += results[c].simulated;
+        for (int u = 0; u < m.num_users(); ++u) {
+            if (u >= static_cast<int>(run.completed.size())) {
+                run.completed.resize(u + 1, 0.0);
+                run.bytes.resize(u + 1, 0.0);
+                run.latency_sum_s.resize(u + 1, 0.0);
+            }
+            double n = static_cast<double>(m.completed(u));
+            run.completed[u] += scale * n;
+            run.bytes[u] += scale * static_cast<double>(m.total_bytes(u));
+            run.latency_sum_s[u] += scale * m.avg_latency(u) * n;
+        }
+    }
+    run.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t_start).count();
+    return run;
+}
+
+SamplingError sampling_error(const SampledRun& sampled, const Metrics& full) {
+    auto rel = [](double est, double truth) {
+        return truth != 0.0 ? std::abs(est - truth) / std::abs(truth) : std::abs(est);
+    };
+    SamplingError err;
+    err.fairness_abs = std::abs(sampled.fairness_index() - full.fairness_index());
+
+    double n = 0.0, lat = 0.0, bytes = 0.0, est_bytes = 0.0;
+    for (int u = 0; u < full.num_users(); ++u) {
+        double c = static_cast<double>(full.completed(u));
+        n += c;
+        lat += full.avg_latency(u) * c;
+        bytes += static_cast<double>(full.total_bytes(u));
+        if (c > 0.0)
+            err.max_user_latency_rel = std::max(err.max_user_latency_rel,
+                                                rel(sampled.mean_latency(u), full.avg_latency(u)));
+    }
+    for (double b : sampled.bytes) est_bytes += b;
+    err.mean_latency_rel = rel(sampled.overall_mean_latency(), n > 0.0 ? lat / n : 0.0);
+    err.bytes_rel = rel(est_bytes, bytes);
+    return err;
+}
+
+} // namespace ssd
@@ -1 +1,12 @@
+#include "pipeline.hpp"
 #include "scheduler_impl.hpp"
+
+namespace ssd {
+
+std::unique_ptr<Scheduler> make_scheduler(const std::string& name,
+                                          const SchedulerOptions& opts) {
+    // Plain policies are single-stage pipelines; "sgfs" expands to qfq>sgfs.
+    return make_pipeline(name, opts);
+}
+
+} // namespace ssd
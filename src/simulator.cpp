@@ -0,0 +1,173 @@
+#include "simulator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_between(Clock::time_point a, Clock::time_point b) {
+    return std::chrono::duration<double>(b - a).count();
+}
+
+// timer_overhead_s estimates the cost of one back-to-back clock read pair so
+// it can be subtracted from each measured scheduler call.
+double timer_overhead_s() {
+    static const double overhead = [] {
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < 1000; ++i) {
+            auto a = Clock::now();
+            auto b = Clock::now();
+            best = std::min(best, seconds_between(a, b));
+        }
+        return best;
+    }();
+    return overhead;
+}
+
+} // namespace
+
+namespace ssd {
+
+Simulator::Simulator(Scheduler& scheduler, SSD& device, Metrics& metrics,
+                     const SimOptions& opts)
+    : scheduler_(scheduler), device_(device), metrics_(metrics), opts_(opts) {
+    if (opts_.charge_overhead) timer_overhead_s();
+}
+
+// charge books |measured_s| of scheduler CPU time onto the simulated host core
+// no earlier than |ready_at| and returns when that work finishes.
+double Simulator::charge(double measured_s, double ready_at) {
+    double cost = std::max(0.0, measured_s - timer_overhead_s());
+    stats_.scheduler_cpu_s += cost;
+    double busy = cost * opts_.overhead_scale;
+    stats_.host_cpu_busy_s += busy;
+    cpu_free_at_ = std::max(cpu_free_at_, ready_at) + busy;
+    return cpu_free_at_;
+}
+
+void Simulator::admit(const Request& r) {
+    advance_to(r.arrival_ts);
+    ++stats_.admitted;
+    if (starvation_) starvation_->on_enqueue(r, now_);
+    if (!opts_.charge_overhead) {
+        scheduler_.enqueue(r);
+        return;
+    }
+    auto t0 = Clock::now();
+    scheduler_.enqueue(r);
+    auto t1 = Clock::now();
+    charge(seconds_between(t0, t1), now_);
+}
+
+// dispatch_ready fills free channels at the current time. Each pass walks the
+// idle channels once, asking the scheduler for one request per channel, then
+// hands the whole batch to the device and the event queue at once. In
+// overhead mode each decision (pick_user + pop) runs on the host CPU first, so
+// a request reaches the device only once its decision has been paid for.
+void Simulator::dispatch_ready() {
+    if (starvation_) starvation_->check(now_);
+    while (true) {
+        batch_.clear();
+        bool drained = false;
+        for (int chan = device_.first_free_channel(now_); chan >= 0;
+             chan = device_.first_free_channel(now_, chan + 1)) {
+            double dispatch_at = now_;
+            std::optional<Request> req;
+            if (opts_.charge_overhead) {
+                auto t0 = Clock::now();
+                auto uid = scheduler_.pick_user(now_);
+                if (uid) req = scheduler_.pop(*uid);
+                auto t1 = Clock::now();
+                dispatch_at = charge(seconds_between(t0, t1), now_);
+            } else {
+                auto uid = scheduler_.pick_user(now_);
+                if (uid) req = scheduler_.pop(*uid);
+            }
+            if (!req) {
+                drained = true;
+                break;
+            }
+            req->start_ts = dispatch_at;
+            if (starvation_) starvation_->on_dispatch(*req, dispatch_at);
+            batch_.push_back({ 0.0, chan, *req });
+        }
+        if (batch_.empty()) break;  // No free channels or nothing to send
+
+        device_.dispatch_batch(batch_.data(), batch_.size());
+        events_.push_batch(batch_.data(), batch_.size());
+        stats_.dispatched += batch_.size();
+        // Only zero-byte requests can leave a channel idle after dispatch;
+        // rescan in that case.
+        if (drained) break;
+    }
+}
+
+// complete_at_now pops every completion stamped with the current time.
+void Simulator::complete_at_now() {
+    while (!events_.empty() && events_.top().time <= now_) {
+        auto ev = events_.pop();
+        if (deferred_) {
+            deferred_->push_back(ev.request);
+        } else {
+            metrics_.on_finish(ev.request);
+            if (completion_hook_) completion_hook_(ev.request);
+        }
+        ++stats_.completed;
+        stats_.end_time = std::max(stats_.end_time, ev.time);
+    }
+}
+
+// next_event_time is the earlier of the next completion and the next time
+// the scheduler releases a request it is holding back.
+double Simulator::next_event_time() const {
+    double next = scheduler_.next_wakeup(now_);
+    if (next <= now_) next = std::numeric_limits<double>::infinity();
+    if (!events_.empty()) next = std::min(next, events_.top().time);
+    return next;
+}
+
+void Simulator::advance_to(double t) {
+    if (t <= now_) return;  // Same instant: keep collecting arrivals.
+    while (true) {
+        dispatch_ready();
+        double next = next_event_time();
+        if (next > t) break;
+        now_ = next;
+        complete_at_now();
+        if (now_ >= t) return;  // Dispatch resumes once arrivals at |t| are in.
+    }
+    now_ = t;
+}
+
+void Simulator::drain() {
+    while (step()) {}
+}
+
+bool Simulator::step() {
+    dispatch_ready();
+    double next = next_event_time();
+    if (next == std::numeric_limits<double>::infinity()) return false;
+    now_ = next;
+    complete_at_now();
+    return true;
+}
+
+double Simulator::poll() {
+    dispatch_ready();
+    return next_event_time();
+}
+
+void Simulator::run(const std::vector<Request>& trace) {
+    run(trace.data(), trace.size());
+}
+
+void Simulator::run(const Request* trace, size_t count) {
+    for (size_t i = 0; i < count; ++i)
+        admit(trace[i]);
+    drain();
+}
+
+} // namespace ssd
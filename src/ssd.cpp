@@ -12,33 +12,147 @@ double bytes_per_second(double bw_MBps, int channels) {
     return (bw_MBps / static_cast<double>(channels)) * kBytesPerMB;
 }
 
+double seconds_per_byte(double bw_MBps, int channels) {
+    double rate = bytes_per_second(bw_MBps, channels);
+    return rate > 0.0 ? 1.0 / rate : 0.0;
+}
+
 } // namespace
 
 namespace ssd {
 
 SSD::SSD(const SimConfig& cfg) : cfg_(cfg) {
     channels_.assign(std::max(cfg_.num_channels, 0), {});
+    nominal_read_s_per_byte_ = seconds_per_byte(cfg_.read_bw_MBps, cfg_.num_channels);
+    nominal_write_s_per_byte_ = seconds_per_byte(cfg_.write_bw_MBps, cfg_.num_channels);
+    set_rate_scale(1.0);
+
+    if (cfg_.thermal.enabled) {
+        thermal_ = ThermalModel(cfg_.thermal, cfg_.num_channels);
+        thermal_stats_.assign(std::max(cfg_.num_users, 0), {});
+    }
+    if (cfg_.ftl.enabled)
+        ftl_ = std::make_unique<Ftl>(cfg_.ftl, cfg_.num_users);
+
+    if (cfg_.oracle != OracleMode::Off) {
+        if (!cfg_.oracle_s_per_byte || cfg_.oracle_s_per_byte->empty())
+            throw std::invalid_argument("Oracle device needs observed service times");
+        // Observed times already include whatever the device did internally.
+        if (cfg_.thermal.enabled || cfg_.ftl.enabled)
+            throw std::invalid_argument("Oracle device replaces the thermal and FTL models");
+        oracle_ = cfg_.oracle_s_per_byte->data();
+        oracle_size_ = cfg_.oracle_s_per_byte->size();
+    }
+}
+
+// oracle_service_s looks up |r|'s observed rate by its trace slot, or by
+// dispatch order in Position mode, and charges it for the request's size.
+double SSD::oracle_service_s(const Request& r) {
+    size_t i = cfg_.oracle == OracleMode::Request ? r.slot : oracle_dispatches_++ % oracle_size_;
+    if (i >= oracle_size_)
+        throw std::out_of_range("Request slot outside the oracle's service times");
+    return static_cast<double>(oracle_[i]) * static_cast<double>(std::max<uint32_t>(r.size_bytes, 1));
 }
 
 // Dispatch applies the scheduling decision onto the physical channel model.
-double SSD::dispatch(int channel_idx, const Request& r, double now) {
+double SSD::dispatch(int channel_idx, Request& r, double now) {
     if (channel_idx < 0 || channel_idx >= static_cast<int>(channels_.size()))
         throw std::out_of_range("Invalid channel index");
 
-    double service = (r.op == OpType::READ)
-        ? read_service_time_s(r.size_bytes)
-        : write_service_time_s(r.size_bytes);
-
     ChannelState& ch = channels_[channel_idx];
+    double cost = (r.op == OpType::READ) ? ch.read_s_per_byte : ch.write_s_per_byte;
+    double transfer = oracle_ ? oracle_service_s(r) : static_cast<double>(r.size_bytes) * cost;
+    double background = 0.0;
+    if (ftl_) r.nsid = ftl_->namespace_of(r.user_id);
+    if (ftl_ && r.op == OpType::WRITE) {
+        // Foreground GC and wear leveling stall the write that triggered them.
+        background = ftl_->background_time_s(
+            ftl_->write(r.user_id, r.address, r.size_bytes, r.nsid));
+    }
+    double service = transfer + background;
     double start = std::max(now, ch.free_at);
+
+    if (cfg_.thermal.enabled) {
+        // A command arriving at a fully idle device pays the power-state exit.
+        double wake = start > busy_until_ ? thermal_.wake_latency(start - busy_until_) : 0.0;
+        start += wake;
+
+        if (r.user_id >= 0) {
+            if (r.user_id >= static_cast<int>(thermal_stats_.size()))
+                thermal_stats_.resize(r.user_id + 1);
+            double nominal_cost = (r.op == OpType::READ) ? nominal_read_s_per_byte_
+                                                          : nominal_write_s_per_byte_;
+            // Throttling only stretches the transfer; GC time is booked apart.
+            ThermalStats& ts = thermal_stats_[r.user_id];
+            ts.busy_s += transfer;
+            ts.throttle_delay_s += transfer - static_cast<double>(r.size_bytes) * nominal_cost;
+            ts.wake_delay_s += wake;
+            ts.ftl_stall_s += background;
+        }
+
+        if (thermal_.on_busy(start, service))
+            set_rate_scale(thermal_.rate_scale());
+    }
+
     ch.free_at = start + service;
+    busy_until_ = std::max(busy_until_, ch.free_at);
     return ch.free_at;
 }
 
+// dispatch_batch splits dispatch() into a service-time pass and a channel
+// pass. Every channel carries the same rate (set_rate_scale updates them
+// together), so the first pass is a multiply per request that the compiler
+// can vectorize; FTL work is still charged in dispatch order.
+void SSD::dispatch_batch(Event* batch, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        if (batch[i].channel < 0 || batch[i].channel >= static_cast<int>(channels_.size()))
+            throw std::out_of_range("Invalid channel index");
+    }
+    if (cfg_.thermal.enabled) {
+        // Heat from one request can throttle the next; keep strict order.
+        for (size_t i = 0; i < n; ++i) {
+            Request& r = batch[i].request;
+            r.finish_ts = dispatch(batch[i].channel, r, r.start_ts);
+            batch[i].time = r.finish_ts;
+        }
+        return;
+    }
+
+    service_.resize(n);
+    const double read_cost = channels_.front().read_s_per_byte;
+    const double write_cost = channels_.front().write_s_per_byte;
+    if (oracle_) {
+        for (size_t i = 0; i < n; ++i) service_[i] = oracle_service_s(batch[i].request);
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            const Request& r = batch[i].request;
+            double cost = r.op == OpType::READ ? read_cost : write_cost;
+            service_[i] = static_cast<double>(r.size_bytes) * cost;
+        }
+    }
+    if (ftl_) {
+        for (size_t i = 0; i < n; ++i) {
+            Request& r = batch[i].request;
+            r.nsid = ftl_->namespace_of(r.user_id);
+            if (r.op == OpType::WRITE)
+                service_[i] += ftl_->background_time_s(
+                    ftl_->write(r.user_id, r.address, r.size_bytes, r.nsid));
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        ChannelState& ch = channels_[batch[i].channel];
+        ch.free_at = std::max(batch[i].request.start_ts, ch.free_at) + service_[i];
+        busy_until_ = std::max(busy_until_, ch.free_at);
+        batch[i].request.finish_ts = ch.free_at;
+        batch[i].time = ch.free_at;
+    }
+}
+
 // first_free_channel scans channels sequentially; the workload uses small N, so
 // this linear scan is sufficient and keeps the model simple.
-int SSD::first_free_channel(double now) const {
-    for (int i = 0; i < static_cast<int>(channels_.size()); ++i) {
+int SSD::first_free_channel(double now, int from) const {
+    for (int i = std::max(from, 0); i < static_cast<int>(channels_.size()); ++i) {
         if (channels_[i].free_at <= now)
             return i;
     }
@@ -46,15 +160,24 @@ int SSD::first_free_channel(double now) const {
 }
 
 double SSD::read_service_time_s(uint32_t bytes) const {
-    double rate = bytes_per_second(cfg_.read_bw_MBps, cfg_.num_channels);
-    if (rate <= 0.0) return 0.0;
-    return static_cast<double>(bytes) / rate;
+    if (channels_.empty()) return 0.0;
+    return static_cast<double>(bytes) * channels_.front().read_s_per_byte;
 }
 
 double SSD::write_service_time_s(uint32_t bytes) const {
-    double rate = bytes_per_second(cfg_.write_bw_MBps, cfg_.num_channels);
-    if (rate <= 0.0) return 0.0;
-    return static_cast<double>(bytes) / rate;
+    if (channels_.empty()) return 0.0;
+    return static_cast<double>(bytes) * channels_.front().write_s_per_byte;
+}
+
+// set_rate_scale refreshes the precomputed per-channel costs so dispatch stays a
+// single multiply; requests already in flight keep their original completion.
+void SSD::set_rate_scale(double scale) {
+    if (scale <= 0.0) return;
+    rate_scale_ = scale;
+    for (auto& ch : channels_) {
+        ch.read_s_per_byte = nominal_read_s_per_byte_ / scale;
+        ch.write_s_per_byte = nominal_write_s_per_byte_ / scale;
+    }
 }
 
 bool SSD::is_free(int idx, double now) const {
@@ -0,0 +1,265 @@
+#include "staged.hpp"
+#include "live.hpp"
+#include "spsc_ring.hpp"
+#include "trace_archive.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace ssd {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Batch = std::vector<Request>;
+
+double seconds_since(Clock::time_point t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+// thread_cpu_s is the CPU time the calling thread has used so far.
+double thread_cpu_s() {
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+// StageAborted unwinds a stage that was waiting on a ring when another stage
+// failed.
+struct StageAborted {};
+
+// Link connects two stages: full batches travel forward, emptied ones come
+// back for reuse.
+struct Link {
+    SpscRing<Batch> full;
+    SpscRing<Batch> spare;
+    explicit Link(size_t batches) : full(batches), spare(batches) {}
+};
+
+// wait_for retries |attempt| until it succeeds and adds the time spent to
+// |waited|. It spins first (the other stage is usually mid-batch on its own
+// core), then yields, then sleeps, so a stage that waits long doesn't take CPU
+// from the others when there are fewer cores than stages.
+template <typename Attempt>
+void wait_for(Attempt attempt, const std::atomic<bool>& failed, double& waited) {
+    if (attempt()) return;
+    auto t0 = Clock::now();
+    for (int tries = 0; !attempt(); ++tries) {
+        if (failed.load(std::memory_order_relaxed)) throw StageAborted{};
+        if (tries >= 256)
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        else if (tries >= 64)
+            std::this_thread::yield();
+    }
+    waited += seconds_since(t0);
+}
+
+// Sender is the producer end of a Link. current() stays the same object for
+// the sender's lifetime, so the simulator can append to it directly.
+class Sender {
+public:
+    Sender(Link& link, size_t batch, const std::atomic<bool>& failed, double& waited)
+        : link_(link), batch_(batch), failed_(failed), waited_(waited) {
+        current_.reserve(batch_);
+    }
+
+    Batch& current() { return current_; }
+
+    void push(const Request& r) {
+        current_.push_back(r);
+        if (current_.size() >= batch_) ship();
+    }
+
+    void ship_if_full() {
+        if (current_.size() >= batch_) ship();
+    }
+
+    // close ships what is left, then an empty batch to mark the end.
+    void close() {
+        ship();
+        Batch end;
+        wait_for([&] { return link_.full.try_push(end); }, failed_, waited_);
+    }
+
+private:
+    void ship() {
+        if (current_.empty()) return;
+        wait_for([&] { return link_.full.try_push(current_); }, failed_, waited_);
+        if (!link_.spare.try_pop(current_)) current_ = Batch();
+        current_.clear();
+        current_.reserve(batch_);
+    }
+
+    Link& link_;
+    size_t batch_;
+    Batch current_;
+    const std::atomic<bool>& failed_;
+    double& waited_;
+};
+
+// Receiver is the consumer end of a Link.
+class Receiver {
+public:
+    Receiver(Link& link, const std::atomic<bool>& failed, double& waited)
+        : link_(link), failed_(failed), waited_(waited) {}
+
+    // receive waits for the next batch; false at the end of the stream.
+    bool receive(Batch& b) {
+        wait_for([&] { return link_.full.try_pop(b); }, failed_, waited_);
+        return !b.empty();
+    }
+
+    // recycle hands |b| back to the sender, or frees it if the sender already
+    // has enough spares.
+    void recycle(Batch& b) {
+        b.clear();
+        link_.spare.try_push(b);
+    }
+
+private:
+    Link& link_;
+    const std::atomic<bool>& failed_;
+    double& waited_;
+};
+
+} // namespace
+
+StagedStats run_staged(const std::string& trace_path, const StagedOptions& opts,
+                       Simulator& sim, Metrics& metrics,
+                       const std::function<void(const Request&)>& on_complete,
+                       std::ostream& window_out) {
+    StagedStats stats;
+    const size_t batch = std::max<size_t>(opts.batch, 1);
+    const int max_users = std::max(opts.max_users, 1);
+    Link to_sim(std::max<size_t>(opts.ring_batches, 2));
+    Link to_sink(std::max<size_t>(opts.ring_batches, 2));
+    std::atomic<bool> failed{ false };
+    std::exception_ptr errors[3];
+
+    // Each stage records its first exception and stops the others.
+    auto guarded = [&](int stage, auto&& body) {
+        try {
+            body();
+        } catch (const StageAborted&) {
+        } catch (...) {
+            errors[stage] = std::current_exception();
+            failed.store(true, std::memory_order_relaxed);
+        }
+    };
+
+    auto loader = [&] {
+        double cpu0 = thread_cpu_s();
+        double waited = 0.0;
+        Sender out(to_sim, batch, failed, waited);
+        auto emit = [&](Request r) {
+            if (r.user_id >= max_users) {
+                r.user_id %= max_users;
+                ++stats.folded;
+            }
+            ++stats.requests;
+            out.push(r);
+        };
+
+        if (util::is_trace_archive(trace_path)) {
+            util::TraceArchiveReader reader(trace_path);
+            for (size_t b = 0; b < reader.blocks().size(); ++b)
+                for (const Request& r : reader.read_block(b)) emit(r);
+        } else {
+            std::ifstream in(trace_path);
+            if (!in.is_open()) throw std::runtime_error("Failed to open trace file: " + trace_path);
+            util::TraceParser parser;
+            parser.cap_users(max_users);
+            std::priority_queue<Request, std::vector<Request>, ArrivalLater> buffer;
+            double latest = 0.0;
+            double released = 0.0;
+            std::string line;
+            Request req{};
+            while (std::getline(in, line)) {
+                if (!parser.parse_line(line, req)) continue;
+                if (req.arrival_ts < released) ++stats.late;
+                latest = std::max(latest, req.arrival_ts);
+                buffer.push(req);
+                while (!buffer.empty() && buffer.top().arrival_ts <= latest - opts.reorder_slack_s) {
+                    released = std::max(released, buffer.top().arrival_ts);
+                    emit(buffer.top());
+                    buffer.pop();
+                }
+            }
+            for (; !buffer.empty(); buffer.pop()) emit(buffer.top());
+        }
+        out.close();
+        stats.loader_cpu_s = thread_cpu_s() - cpu0;
+        stats.loader_wait_s = waited;
+    };
+
+    auto simulate = [&] {
+        double cpu0 = thread_cpu_s();
+        double waited = 0.0;
+        Receiver in(to_sim, failed, waited);
+        Sender out(to_sink, batch, failed, waited);
+        sim.defer_completions(&out.current());
+        Batch b;
+        while (in.receive(b)) {
+            for (const Request& r : b) {
+                sim.admit(r);
+                out.ship_if_full();
+            }
+            in.recycle(b);
+        }
+        // Drain event by event so completions still ship in bounded batches.
+        while (sim.step()) out.ship_if_full();
+        out.close();
+        stats.sim_cpu_s = thread_cpu_s() - cpu0;
+        stats.sim_wait_s = waited;
+    };
+
+    auto sink = [&] {
+        double cpu0 = thread_cpu_s();
+        double waited = 0.0;
+        Receiver in(to_sink, failed, waited);
+        std::unique_ptr<WindowReporter> windows;
+        if (opts.window_s > 0.0)
+            windows = std::make_unique<WindowReporter>(opts.window_s, max_users, window_out);
+        Batch b;
+        while (in.receive(b)) {
+            for (const Request& r : b) {
+                metrics.on_finish(r);
+                if (on_complete) on_complete(r);
+                if (windows) windows->on_finish(r);
+            }
+            in.recycle(b);
+        }
+        if (windows) {
+            windows->flush();
+            stats.windows = windows->rows();
+        }
+        stats.sink_cpu_s = thread_cpu_s() - cpu0;
+        stats.sink_wait_s = waited;
+    };
+
+    // The simulation stage runs on the calling thread.
+    auto t0 = Clock::now();
+    std::thread loader_thread([&] { guarded(0, loader); });
+    std::thread sink_thread([&] { guarded(2, sink); });
+    guarded(1, simulate);
+    sim.defer_completions(nullptr);
+    loader_thread.join();
+    sink_thread.join();
+    stats.wall_s = seconds_since(t0);
+
+    for (const auto& e : errors)
+        if (e) std::rethrow_exception(e);
+    return stats;
+}
+
+} // namespace ssd
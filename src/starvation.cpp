@@ -0,0 +1,188 @@
+#include "starvation.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+namespace ssd {
+
+void StarvationDetector::Heap::place(size_t i, int u) {
+    items_[i] = u;
+    pos_[u] = static_cast<int64_t>(i);
+}
+
+void StarvationDetector::Heap::sift_up(size_t i) {
+    int u = items_[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (keys_[items_[parent]] <= keys_[u]) break;
+        place(i, items_[parent]);
+        i = parent;
+    }
+    place(i, u);
+}
+
+void StarvationDetector::Heap::sift_down(size_t i) {
+    int u = items_[i];
+    const size_t n = items_.size();
+    while (true) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && keys_[items_[child + 1]] < keys_[items_[child]]) ++child;
+        if (keys_[u] <= keys_[items_[child]]) break;
+        place(i, items_[child]);
+        i = child;
+    }
+    place(i, u);
+}
+
+void StarvationDetector::Heap::set(int u, double key) {
+    if (u >= static_cast<int>(pos_.size())) {
+        pos_.resize(u + 1, -1);
+        keys_.resize(u + 1, 0.0);
+    }
+    if (pos_[u] < 0) {
+        keys_[u] = key;
+        items_.push_back(u);
+        sift_up(items_.size() - 1);
+        return;
+    }
+    double old = keys_[u];
+    keys_[u] = key;
+    if (key < old) sift_up(static_cast<size_t>(pos_[u]));
+    else sift_down(static_cast<size_t>(pos_[u]));
+}
+
+void StarvationDetector::Heap::erase(int u) {
+    if (!contains(u)) return;
+    size_t i = static_cast<size_t>(pos_[u]);
+    pos_[u] = -1;
+    int last = items_.back();
+    items_.pop_back();
+    if (i == items_.size()) return;
+    place(i, last);
+    sift_up(i);
+    sift_down(static_cast<size_t>(pos_[last]));
+}
+
+StarvationDetector::StarvationDetector(int num_users, const StarvationOptions& opts)
+    : opts_(opts) {
+    ensure(num_users - 1);
+}
+
+void StarvationDetector::ensure(int user) {
+    if (user < static_cast<int>(tenants_.size())) return;
+    tenants_.resize(user + 1);
+    stats_.resize(user + 1);
+}
+
+void StarvationDetector::on_enqueue(const Request& r, double now) {
+    if (r.user_id < 0) return;
+    ensure(r.user_id);
+    Tenant& t = tenants_[r.user_id];
+    bool was_idle = t.queued.empty();
+    t.queued.insert(t.queued.end(), r.arrival_ts);
+    if (!was_idle) return;
+    t.since = now;
+    gap_heap_.set(r.user_id, now);
+    age_heap_.set(r.user_id, r.arrival_ts);
+}
+
+// on_dispatch also catches crossings that happened between checks, so every
+// episode is reported even when the tenant is served before check() runs.
+void StarvationDetector::on_dispatch(const Request& r, double now) {
+    const int u = r.user_id;
+    if (u < 0 || u >= static_cast<int>(tenants_.size())) return;
+    Tenant& t = tenants_[u];
+    if (t.queued.empty()) return;
+    TenantStarvation& st = stats_[u];
+
+    double gap = std::max(now - t.since, 0.0);
+    st.gap_ns.record(static_cast<uint64_t>(gap * 1e9));
+    st.max_gap_s = std::max(st.max_gap_s, gap);
+    st.max_wait_s = std::max(st.max_wait_s, now - r.arrival_ts);
+    if (!t.gap_flagged && gap >= opts_.gap_threshold_s) {
+        t.gap_flagged = true;
+        t.gap_detected = now;
+        peak_starving_ = std::max(peak_starving_, ++starving_);
+    }
+    double oldest = *t.queued.begin();
+    if (!t.age_flagged && now - oldest >= opts_.age_threshold_s) {
+        t.age_flagged = true;
+        t.age_start = oldest;
+        t.age_detected = now;
+    }
+
+    // Stages such as rw, size or prio serve a tenant out of arrival order,
+    // so the request is found by its arrival time in O(log n).
+    auto it = t.queued.find(r.arrival_ts);
+    t.queued.erase(it == t.queued.end() ? t.queued.begin() : it);
+
+    if (t.gap_flagged) close_gap(u, now);
+    if (t.queued.empty()) {
+        gap_heap_.erase(u);
+    } else {
+        t.since = now;
+        gap_heap_.set(u, now);
+    }
+
+    if (t.age_flagged && (t.queued.empty() || now - *t.queued.begin() < opts_.age_threshold_s))
+        close_age(u, now);
+    if (t.age_flagged || t.queued.empty()) age_heap_.erase(u);
+    else age_heap_.set(u, *t.queued.begin());
+}
+
+void StarvationDetector::check(double now) {
+    while (!gap_heap_.empty() && now - gap_heap_.top_key() >= opts_.gap_threshold_s) {
+        int u = gap_heap_.top();
+        gap_heap_.erase(u);
+        tenants_[u].gap_flagged = true;
+        tenants_[u].gap_detected = now;
+        peak_starving_ = std::max(peak_starving_, ++starving_);
+    }
+    while (!age_heap_.empty() && now - age_heap_.top_key() >= opts_.age_threshold_s) {
+        int u = age_heap_.top();
+        age_heap_.erase(u);
+        Tenant& t = tenants_[u];
+        t.age_flagged = true;
+        t.age_start = *t.queued.begin();
+        t.age_detected = now;
+    }
+}
+
+void StarvationDetector::finish(double now) {
+    check(now);
+    for (int u = 0; u < static_cast<int>(tenants_.size()); ++u) {
+        if (tenants_[u].gap_flagged) close_gap(u, now);
+        if (tenants_[u].age_flagged) close_age(u, now);
+    }
+}
+
+void StarvationDetector::close_gap(int user, double now) {
+    Tenant& t = tenants_[user];
+    events_.push_back({ user, StarvationKind::Gap, t.since, t.gap_detected, now });
+    ++stats_[user].gap_events;
+    stats_[user].starved_s += now - t.since;
+    t.gap_flagged = false;
+    --starving_;
+}
+
+void StarvationDetector::close_age(int user, double now) {
+    Tenant& t = tenants_[user];
+    events_.push_back({ user, StarvationKind::Age, t.age_start, t.age_detected, now });
+    ++stats_[user].age_events;
+    t.age_flagged = false;
+}
+
+bool StarvationDetector::write_events_csv(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+    out << "user_id,kind,start_ts,detected_ts,end_ts,duration_s\n";
+    for (const auto& e : events_) {
+        out << e.user_id << "," << (e.kind == StarvationKind::Gap ? "gap" : "age") << ","
+            << e.start_ts << "," << e.detected_ts << "," << e.end_ts << "," << e.duration_s()
+            << "\n";
+    }
+    return static_cast<bool>(out);
+}
+
+} // namespace ssd
@@ -0,0 +1,336 @@
+#include "sweep.hpp"
+
+#include "mapped_trace.hpp"
+#include "metrics.hpp"
+#include "scheduler_impl.hpp"
+#include "simulator.hpp"
+#include "ssd.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* kItemSuffix = ".item";
+// Crashed workers are retried this many times before run_sweep gives up.
+constexpr int kMaxRecoveryRounds = 3;
+
+std::vector<std::string> split(const std::string& text, char sep) {
+    std::vector<std::string> parts;
+    std::stringstream ss(text);
+    std::string part;
+    while (std::getline(ss, part, sep))
+        if (!part.empty()) parts.push_back(part);
+    return parts;
+}
+
+// sorted_entries lists regular files in |dir| by name; missing dirs are empty.
+std::vector<std::string> sorted_entries(const fs::path& dir) {
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+        names.push_back(it->path().filename().string());
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool has_suffix(const std::string& name, const std::string& suffix) {
+    return name.size() > suffix.size() &&
+           name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// try_rename performs an atomic rename and reports whether this caller won.
+bool try_rename(const fs::path& from, const fs::path& to) {
+    return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+// write_atomically publishes |text| at |path| via a temporary and rename, so
+// readers see either nothing or the whole file.
+void write_atomically(const fs::path& path, const std::string& text) {
+    fs::path tmp = path;
+    tmp += ".tmp." + std::to_string(::getpid());
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << text;
+        if (!out) throw std::runtime_error("Cannot write " + tmp.string());
+    }
+    if (!try_rename(tmp, path))
+        throw std::runtime_error("Cannot publish " + path.string());
+}
+
+std::string param(const ssd::SweepItem& item, const char* key, const char* fallback) {
+    auto it = item.params.find(key);
+    return it == item.params.end() ? fallback : it->second;
+}
+
+ssd::SweepItem read_item(const fs::path& path, std::string id) {
+    ssd::SweepItem item;
+    item.id = std::move(id);
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        auto eq = line.find('=');
+        if (eq == std::string::npos) continue;
+        item.params[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    return item;
+}
+
+} // namespace
+
+namespace ssd {
+
+std::string SweepItem::describe() const {
+    std::string out;
+    for (const auto& [key, value] : params) {
+        if (!out.empty()) out += ';';
+        out += key + "=" + value;
+    }
+    return out;
+}
+
+std::vector<SweepItem> expand_sweep_grid(const std::string& grid) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> axes;
+    for (const auto& axis : split(grid, ';')) {
+        auto eq = axis.find('=');
+        if (eq == std::string::npos || eq == 0)
+            throw std::invalid_argument("Sweep axis must be key=v1,v2: " + axis);
+        // '|' separates values that themselves contain commas (weights).
+        char sep = axis.find('|') != std::string::npos ? '|' : ',';
+        auto values = split(axis.substr(eq + 1), sep);
+        if (values.empty()) throw std::invalid_argument("Sweep axis has no values: " + axis);
+        axes.emplace_back(axis.substr(0, eq), std::move(values));
+    }
+
+    std::vector<SweepItem> items(1);
+    for (const auto& [key, values] : axes) {
+        std::vector<SweepItem> next;
+        next.reserve(items.size() * values.size());
+        for (const auto& item : items) {
+            for (const auto& value : values) {
+                SweepItem expanded = item;
+                expanded.params[key] = value;
+                next.push_back(std::move(expanded));
+            }
+        }
+        items = std::move(next);
+    }
+    for (size_t i = 0; i < items.size(); ++i) {
+        char id[24];
+        std::snprintf(id, sizeof(id), "%06zu", i);
+        items[i].id = id;
+    }
+    return items;
+}
+
+SweepResult run_sweep_item(const SweepItem& item, const Request* trace, size_t count,
+                           int num_users) {
+    static const char* kKnown[] = { "scheduler", "quantum", "channels", "read_bw",
+                                    "write_bw", "weights", "overhead" };
+    for (const auto& entry : item.params) {
+        if (std::find(std::begin(kKnown), std::end(kKnown), entry.first) == std::end(kKnown))
+            throw std::invalid_argument("Unknown sweep parameter: " + entry.first);
+    }
+
+    SchedulerOptions sched_opts;
+    sched_opts.quantum = std::stod(param(item, "quantum", "4096"));
+    std::string policy = param(item, "scheduler", "qfq");
+    auto scheduler = make_scheduler(policy, sched_opts);
+    if (!scheduler) throw std::invalid_argument("Unknown scheduler policy: " + policy);
+
+    std::vector<double> weights;
+    for (const auto& w : split(param(item, "weights", ""), ','))
+        weights.push_back(std::stod(w));
+    scheduler->set_users(num_users);
+    if (!weights.empty()) scheduler->set_weights(weights);
+
+    SimConfig cfg { num_users, std::stoi(param(item, "channels", "8")),
+                    std::stod(param(item, "read_bw", "2000")),
+                    std::stod(param(item, "write_bw", "1200")), {}, {}, OracleMode::Off, nullptr };
+    SimOptions sim_opts;
+    sim_opts.charge_overhead = param(item, "overhead", "0") == "1";
+
+    auto t0 = std::chrono::steady_clock::now();
+    SSD device(cfg);
+    Metrics metrics(num_users);
+    Simulator sim(*scheduler, device, metrics, sim_opts);
+    sim.run(trace, count);
+    auto t1 = std::chrono::steady_clock::now();
+
+    SweepResult result;
+    result.fairness_index = metrics.fairness_index();
+    result.completed = sim.stats().completed;
+    result.sim_end_s = sim.stats().end_time;
+    double latency_sum = 0.0;
+    for (int u = 0; u < metrics.num_users(); ++u)
+        latency_sum += metrics.avg_latency(u) * static_cast<double>(metrics.completed(u));
+    result.mean_latency_s = result.completed > 0
+        ? latency_sum / static_cast<double>(result.completed) : 0.0;
+    result.wall_s = std::chrono::duration<double>(t1 - t0).count();
+    return result;
+}
+
+SweepQueue::SweepQueue(std::string dir) : dir_(std::move(dir)) {}
+
+void SweepQueue::init(const std::vector<SweepItem>& items) {
+    for (const char* sub : { "queue", "claimed", "done", "failed", "results" })
+        fs::create_directories(fs::path(dir_) / sub);
+    // An item already pending, claimed, done, or failed is left where it is.
+    std::unordered_set<std::string> known;
+    for (const char* sub : { "queue", "done", "failed" })
+        for (auto& name : sorted_entries(fs::path(dir_) / sub)) known.insert(std::move(name));
+    for (const auto& name : sorted_entries(fs::path(dir_) / "claimed")) {
+        auto dot = name.rfind('.');
+        if (dot != std::string::npos) known.insert(name.substr(0, dot));
+    }
+    for (const auto& item : items) {
+        std::string name = item.id + kItemSuffix;
+        if (known.count(name)) continue;
+        fs::path pending = fs::path(dir_) / "queue" / name;
+        std::string text;
+        for (const auto& [key, value] : item.params) text += key + "=" + value + "\n";
+        write_atomically(pending, text);
+    }
+}
+
+std::string SweepQueue::claimed_name(const std::string& id) const {
+    return id + kItemSuffix + "." + std::to_string(::getpid());
+}
+
+// A claim is stale when its owning pid is gone (ESRCH). Workers are local, so
+// a live pid means the item is still being worked on.
+size_t SweepQueue::recover_stale() {
+    size_t recovered = 0;
+    fs::path root(dir_);
+    for (const auto& name : sorted_entries(root / "claimed")) {
+        auto dot = name.rfind('.');
+        auto item_end = name.rfind(kItemSuffix, dot);
+        if (dot == std::string::npos || item_end == std::string::npos) continue;
+        pid_t pid = static_cast<pid_t>(std::atol(name.c_str() + dot + 1));
+        if (pid <= 0 || ::kill(pid, 0) == 0 || errno != ESRCH) continue;
+
+        std::string id = name.substr(0, item_end);
+        bool published = fs::exists(root / "results" / (id + ".csv"));
+        fs::path target = root / (published ? "done" : "queue") / (id + kItemSuffix);
+        if (try_rename(root / "claimed" / name, target)) ++recovered;
+    }
+    return recovered;
+}
+
+std::optional<SweepItem> SweepQueue::claim() {
+    fs::path root(dir_);
+    for (const auto& name : sorted_entries(root / "queue")) {
+        if (!has_suffix(name, kItemSuffix)) continue;
+        std::string id = name.substr(0, name.size() - std::string(kItemSuffix).size());
+        fs::path claimed = root / "claimed" / claimed_name(id);
+        // Losing the race to another worker just means trying the next item.
+        if (try_rename(root / "queue" / name, claimed)) return read_item(claimed, id);
+    }
+    return std::nullopt;
+}
+
+void SweepQueue::complete(const SweepItem& item, const SweepResult& result) {
+    fs::path root(dir_);
+    std::ostringstream line;
+    line << item.id << "," << item.describe() << "," << result.fairness_index << ","
+         << result.completed << "," << result.sim_end_s << "," << result.mean_latency_s
+         << "," << result.wall_s << "\n";
+    // Publish the result before marking the item done; recover_stale handles a
+    // crash between the two steps.
+    write_atomically(root / "results" / (item.id + ".csv"), line.str());
+    try_rename(root / "claimed" / claimed_name(item.id), root / "done" / (item.id + kItemSuffix));
+}
+
+void SweepQueue::fail(const SweepItem& item) {
+    fs::path root(dir_);
+    try_rename(root / "claimed" / claimed_name(item.id), root / "failed" / (item.id + kItemSuffix));
+}
+
+size_t SweepQueue::collect(std::ostream& out) const {
+    out << "item,config,fairness_index,completed,sim_end_s,mean_latency_s,wall_s\n";
+    size_t n = 0;
+    fs::path results = fs::path(dir_) / "results";
+    for (const auto& name : sorted_entries(results)) {
+        if (!has_suffix(name, ".csv")) continue;
+        std::ifstream in(results / name);
+        out << in.rdbuf();
+        ++n;
+    }
+    return n;
+}
+
+size_t SweepQueue::pending() const {
+    return sorted_entries(fs::path(dir_) / "queue").size();
+}
+
+size_t run_sweep_worker(const std::string& dir) {
+    SweepQueue queue(dir);
+    util::MappedTrace trace(queue.trace_path());
+    queue.recover_stale();
+
+    size_t completed = 0;
+    while (auto item = queue.claim()) {
+        try {
+            queue.complete(*item, run_sweep_item(*item, trace.data(), trace.size(),
+                                                 trace.num_users()));
+            ++completed;
+        } catch (const std::exception& e) {
+            std::cerr << "sweep item " << item->id << " failed: " << e.what() << "\n";
+            queue.fail(*item);
+        }
+    }
+    return completed;
+}
+
+int run_sweep(const std::string& dir, int workers) {
+    workers = std::max(workers, 1);
+    SweepQueue queue(dir);
+    int failures = 0;
+    for (int round = 0; round <= kMaxRecoveryRounds; ++round) {
+        std::vector<pid_t> children;
+        std::cout.flush();
+        for (int w = 0; w < workers; ++w) {
+            pid_t pid = ::fork();
+            if (pid < 0) throw std::runtime_error("fork failed for sweep worker");
+            if (pid == 0) {
+                int rc = 0;
+                try {
+                    run_sweep_worker(dir);
+                } catch (const std::exception& e) {
+                    std::cerr << "sweep worker " << ::getpid() << ": " << e.what() << "\n";
+                    rc = 1;
+                }
+                std::cerr.flush();
+                ::_exit(rc);
+            }
+            children.push_back(pid);
+        }
+
+        failures = 0;
+        for (pid_t pid : children) {
+            int status = 0;
+            ::waitpid(pid, &status, 0);
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failures;
+        }
+        // Items abandoned by crashed workers go back to the queue for another round.
+        if (queue.recover_stale() == 0 && queue.pending() == 0) break;
+    }
+    return failures;
+}
+
+} // namespace ssd
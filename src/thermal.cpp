@@ -0,0 +1,67 @@
+#include "thermal.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ssd {
+
+ThermalModel::ThermalModel(const ThermalConfig& cfg, int num_channels) : cfg_(cfg) {
+    std::sort(cfg_.levels.begin(), cfg_.levels.end(),
+              [](const ThrottleLevel& a, const ThrottleLevel& b) { return a.heat < b.heat; });
+    std::sort(cfg_.power_states.begin(), cfg_.power_states.end(),
+              [](const PowerState& a, const PowerState& b) {
+                  return a.idle_after_s < b.idle_after_s;
+              });
+    if (cfg_.time_constant_s > 0.0 && num_channels > 0)
+        per_busy_second_ = 1.0 / (cfg_.time_constant_s * static_cast<double>(num_channels));
+}
+
+double ThermalModel::heat(double now) const {
+    if (cfg_.time_constant_s <= 0.0 || now <= updated_at_) return heat_;
+    return heat_ * std::exp(-(now - updated_at_) / cfg_.time_constant_s);
+}
+
+// on_busy decays the accumulator to |now| before adding the new work so that
+// idle gaps between dispatches cool the device.
+bool ThermalModel::on_busy(double now, double busy_s) {
+    heat_ = heat(now);
+    updated_at_ = std::max(updated_at_, now);
+    heat_ += busy_s * per_busy_second_;
+    peak_ = std::max(peak_, heat_);
+
+    int next = level_for(heat_);
+    if (next == level_) return false;
+    level_ = next;
+    ++transitions_;
+    return true;
+}
+
+// level_for applies hysteresis: a level is only left once heat falls a margin
+// below its threshold, which avoids flapping around a boundary.
+int ThermalModel::level_for(double h) const {
+    int next = 0;
+    for (size_t i = 0; i < cfg_.levels.size(); ++i) {
+        double threshold = cfg_.levels[i].heat;
+        if (static_cast<int>(i) < level_) threshold -= cfg_.hysteresis;
+        if (h >= threshold) next = static_cast<int>(i) + 1;
+    }
+    return next;
+}
+
+double ThermalModel::rate_scale() const {
+    if (level_ <= 0) return 1.0;
+    return std::max(cfg_.levels[level_ - 1].rate_scale, 1e-6);
+}
+
+double ThermalModel::wake_latency(double idle_s) const {
+    for (auto it = cfg_.power_states.rbegin(); it != cfg_.power_states.rend(); ++it) {
+        if (idle_s < it->idle_after_s) continue;
+        // Entry that has not finished yet must complete before exiting.
+        double entered_for = idle_s - it->idle_after_s;
+        double entry_left = std::max(0.0, it->entry_latency_s - entered_for);
+        return entry_left + it->exit_latency_s;
+    }
+    return 0.0;
+}
+
+} // namespace ssd
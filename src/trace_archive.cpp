@@ -0,0 +1,417 @@
+#include "trace_archive.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace util {
+
+namespace {
+
+// File layout:
+//   header  : "SSDTRCA1" | u32 version | u32 block_size
+//   blocks  : varint-coded columns, see encode_block
+//   index   : per block u64 offset | u32 bytes | u32 count | i64 min_ns | i64 max_ns
+//   trailer : u64 index_offset | u32 block_count | "SSDTRCX1"
+constexpr char kHeaderMagic[8] = {'S', 'S', 'D', 'T', 'R', 'C', 'A', '1'};
+constexpr char kTrailerMagic[8] = {'S', 'S', 'D', 'T', 'R', 'C', 'X', '1'};
+constexpr uint32_t kVersion = 2;  // v2 adds the address column
+constexpr size_t kHeaderBytes = 16;
+constexpr size_t kIndexEntryBytes = 32;
+constexpr size_t kTrailerBytes = 20;
+
+using Bytes = std::vector<uint8_t>;
+
+void put_varint(Bytes& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<uint8_t>(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+uint64_t zigzag(int64_t v) {
+    return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+int64_t unzigzag(uint64_t v) {
+    return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+template <typename T>
+void put_fixed(Bytes& out, T v) {
+    uint8_t buf[sizeof(T)];
+    std::memcpy(buf, &v, sizeof(T));
+    out.insert(out.end(), buf, buf + sizeof(T));
+}
+
+// Cursor reads varints and fixed-width fields from a decoded buffer.
+class Cursor {
+public:
+    Cursor(const uint8_t* data, size_t size) : p_(data), end_(data + size) {}
+
+    uint64_t varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p_ == end_) throw std::runtime_error("Trace archive: truncated block");
+            uint8_t b = *p_++;
+            v |= static_cast<uint64_t>(b & 0x7f) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        throw std::runtime_error("Trace archive: malformed varint");
+    }
+
+    uint8_t byte() {
+        if (p_ == end_) throw std::runtime_error("Trace archive: truncated block");
+        return *p_++;
+    }
+
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+template <typename T>
+T get_fixed(const uint8_t* p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+int64_t to_ns(double seconds) {
+    return static_cast<int64_t>(std::llround(seconds * 1e9));
+}
+
+// put_dictionary writes the sorted distinct |values| delta-coded and returns
+// the value -> code mapping.
+template <typename T>
+std::unordered_map<T, uint64_t> put_dictionary(Bytes& out, std::vector<T> values) {
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    put_varint(out, values.size());
+    std::unordered_map<T, uint64_t> codes;
+    int64_t prev = 0;
+    for (size_t i = 0; i < values.size(); ++i) {
+        put_varint(out, zigzag(static_cast<int64_t>(values[i]) - prev));
+        prev = static_cast<int64_t>(values[i]);
+        codes.emplace(values[i], i);
+    }
+    return codes;
+}
+
+// get_dictionary reads a dictionary of at most |count| values (one per
+// request). Every entry takes at least a byte, which bounds it by the rest
+// of the block as well.
+std::vector<int64_t> get_dictionary(Cursor& in, size_t count) {
+    uint64_t size = in.varint();
+    if (size > count || size > in.remaining())
+        throw std::runtime_error("Trace archive: dictionary overflows block");
+    std::vector<int64_t> values(size);
+    int64_t prev = 0;
+    for (auto& v : values) {
+        v = prev + unzigzag(in.varint());
+        prev = v;
+    }
+    return values;
+}
+
+// put_runs RLE-encodes a sequence of small codes as (code, length) pairs.
+void put_runs(Bytes& out, const std::vector<uint64_t>& codes) {
+    Bytes runs;
+    size_t num_runs = 0;
+    for (size_t i = 0; i < codes.size();) {
+        size_t j = i;
+        while (j < codes.size() && codes[j] == codes[i]) ++j;
+        put_varint(runs, codes[i]);
+        put_varint(runs, j - i);
+        ++num_runs;
+        i = j;
+    }
+    put_varint(out, num_runs);
+    out.insert(out.end(), runs.begin(), runs.end());
+}
+
+std::vector<uint64_t> get_runs(Cursor& in, size_t count) {
+    std::vector<uint64_t> codes;
+    codes.reserve(count);
+    uint64_t num_runs = in.varint();
+    for (uint64_t r = 0; r < num_runs; ++r) {
+        uint64_t code = in.varint();
+        uint64_t len = in.varint();
+        if (codes.size() + len > count)
+            throw std::runtime_error("Trace archive: run overflows block");
+        codes.insert(codes.end(), len, code);
+    }
+    if (codes.size() != count) throw std::runtime_error("Trace archive: short run column");
+    return codes;
+}
+
+// encode_block writes the columns of |count| requests starting at |first|:
+// timestamps (zigzag delta varint, ns), users (dictionary + varint codes),
+// ops (RLE), sizes (size-class dictionary + RLE codes), and addresses
+// (zigzag varint of the gap from the previous request's end).
+Bytes encode_block(const Request* first, size_t count) {
+    Bytes out;
+    put_varint(out, count);
+
+    int64_t prev = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int64_t ns = to_ns(first[i].arrival_ts);
+        put_varint(out, zigzag(ns - prev));
+        prev = ns;
+    }
+
+    std::vector<int> users(count);
+    for (size_t i = 0; i < count; ++i) users[i] = first[i].user_id;
+    auto user_codes = put_dictionary(out, users);
+    for (int u : users) put_varint(out, user_codes[u]);
+
+    std::vector<uint64_t> ops(count);
+    for (size_t i = 0; i < count; ++i) ops[i] = static_cast<uint64_t>(first[i].op);
+    put_runs(out, ops);
+
+    std::vector<uint32_t> sizes(count);
+    for (size_t i = 0; i < count; ++i) sizes[i] = first[i].size_bytes;
+    auto size_codes = put_dictionary(out, sizes);
+    std::vector<uint64_t> classes(count);
+    for (size_t i = 0; i < count; ++i) classes[i] = size_codes[sizes[i]];
+    put_runs(out, classes);
+
+    // Addresses are coded against the end of the previous request, so
+    // sequential streams cost one byte each.
+    prev = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int64_t addr = static_cast<int64_t>(first[i].address);
+        put_varint(out, zigzag(addr - prev));
+        prev = addr + first[i].size_bytes;
+    }
+    return out;
+}
+
+std::vector<Request> decode_block(const Bytes& data, uint32_t version) {
+    Cursor in(data.data(), data.size());
+    // Every request takes at least a byte for its timestamp.
+    uint64_t count = in.varint();
+    if (count > in.remaining()) throw std::runtime_error("Trace archive: count overflows block");
+    std::vector<Request> out(count);
+
+    int64_t prev = 0;
+    for (auto& r : out) {
+        prev += unzigzag(in.varint());
+        r.arrival_ts = static_cast<double>(prev) * 1e-9;
+    }
+
+    auto users = get_dictionary(in, count);
+    for (auto& r : out) {
+        uint64_t code = in.varint();
+        if (code >= users.size()) throw std::runtime_error("Trace archive: bad user code");
+        r.user_id = static_cast<int>(users[code]);
+    }
+
+    auto ops = get_runs(in, count);
+    for (size_t i = 0; i < count; ++i) {
+        if (ops[i] != static_cast<uint64_t>(OpType::READ) &&
+            ops[i] != static_cast<uint64_t>(OpType::WRITE))
+            throw std::runtime_error("Trace archive: bad op code");
+        out[i].op = static_cast<OpType>(ops[i]);
+    }
+
+    auto sizes = get_dictionary(in, count);
+    auto classes = get_runs(in, count);
+    for (size_t i = 0; i < count; ++i) {
+        if (classes[i] >= sizes.size()) throw std::runtime_error("Trace archive: bad size code");
+        out[i].size_bytes = static_cast<uint32_t>(sizes[classes[i]]);
+    }
+
+    if (version >= 2) {
+        prev = 0;
+        for (auto& r : out) {
+            int64_t addr = prev + unzigzag(in.varint());
+            r.address = static_cast<uint64_t>(addr);
+            prev = addr + r.size_bytes;
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+void write_trace_archive(const std::string& path, const std::vector<Request>& trace,
+                         size_t block_size) {
+    if (block_size == 0) block_size = 65536;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) throw std::runtime_error("Failed to create trace archive: " + path);
+
+    Bytes header(kHeaderMagic, kHeaderMagic + 8);
+    put_fixed<uint32_t>(header, kVersion);
+    put_fixed<uint32_t>(header, static_cast<uint32_t>(block_size));
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    uint64_t offset = header.size();
+    Bytes index;
+    uint32_t num_blocks = 0;
+    for (size_t first = 0; first < trace.size(); first += block_size) {
+        size_t count = std::min(block_size, trace.size() - first);
+        Bytes block = encode_block(trace.data() + first, count);
+        out.write(reinterpret_cast<const char*>(block.data()), block.size());
+
+        int64_t min_ns = to_ns(trace[first].arrival_ts);
+        int64_t max_ns = min_ns;
+        for (size_t i = first; i < first + count; ++i) {
+            min_ns = std::min(min_ns, to_ns(trace[i].arrival_ts));
+            max_ns = std::max(max_ns, to_ns(trace[i].arrival_ts));
+        }
+        put_fixed<uint64_t>(index, offset);
+        put_fixed<uint32_t>(index, static_cast<uint32_t>(block.size()));
+        put_fixed<uint32_t>(index, static_cast<uint32_t>(count));
+        put_fixed<int64_t>(index, min_ns);
+        put_fixed<int64_t>(index, max_ns);
+        offset += block.size();
+        ++num_blocks;
+    }
+
+    put_fixed<uint64_t>(index, offset);
+    put_fixed<uint32_t>(index, num_blocks);
+    index.insert(index.end(), kTrailerMagic, kTrailerMagic + 8);
+    out.write(reinterpret_cast<const char*>(index.data()), index.size());
+    if (!out) throw std::runtime_error("Failed to write trace archive: " + path);
+}
+
+bool is_trace_archive(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[8];
+    if (!in.read(magic, sizeof(magic))) return false;
+    return std::memcmp(magic, kHeaderMagic, sizeof(magic)) == 0;
+}
+
+TraceArchiveReader::TraceArchiveReader(const std::string& path) : path_(path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in.is_open()) throw std::runtime_error("Failed to open trace archive: " + path);
+    file_bytes_ = static_cast<uint64_t>(in.tellg());
+    if (file_bytes_ < kHeaderBytes + kTrailerBytes || !is_trace_archive(path))
+        throw std::runtime_error("Not a trace archive: " + path);
+
+    uint8_t header[kHeaderBytes];
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(header), kHeaderBytes);
+    version_ = get_fixed<uint32_t>(header + 8);
+    if (version_ == 0 || version_ > kVersion)
+        throw std::runtime_error("Unsupported trace archive version: " + path);
+
+    uint8_t trailer[kTrailerBytes];
+    in.seekg(static_cast<std::streamoff>(file_bytes_ - kTrailerBytes));
+    in.read(reinterpret_cast<char*>(trailer), kTrailerBytes);
+    if (std::memcmp(trailer + 12, kTrailerMagic, 8) != 0)
+        throw std::runtime_error("Trace archive is missing its footer: " + path);
+    uint64_t index_offset = get_fixed<uint64_t>(trailer);
+    uint32_t num_blocks = get_fixed<uint32_t>(trailer + 8);
+    if (index_offset + uint64_t(num_blocks) * kIndexEntryBytes + kTrailerBytes != file_bytes_)
+        throw std::runtime_error("Trace archive footer is inconsistent: " + path);
+
+    Bytes index(static_cast<size_t>(num_blocks) * kIndexEntryBytes);
+    in.seekg(static_cast<std::streamoff>(index_offset));
+    in.read(reinterpret_cast<char*>(index.data()), index.size());
+    if (!in) throw std::runtime_error("Failed to read trace archive index: " + path);
+
+    blocks_.resize(num_blocks);
+    for (uint32_t b = 0; b < num_blocks; ++b) {
+        const uint8_t* e = index.data() + b * kIndexEntryBytes;
+        blocks_[b].offset = get_fixed<uint64_t>(e);
+        blocks_[b].bytes = get_fixed<uint32_t>(e + 8);
+        blocks_[b].count = get_fixed<uint32_t>(e + 12);
+        blocks_[b].min_ns = get_fixed<int64_t>(e + 16);
+        blocks_[b].max_ns = get_fixed<int64_t>(e + 24);
+        if (blocks_[b].offset + blocks_[b].bytes > index_offset)
+            throw std::runtime_error("Trace archive index is inconsistent: " + path);
+        num_requests_ += blocks_[b].count;
+    }
+}
+
+std::vector<Request> TraceArchiveReader::read_block(size_t index) const {
+    if (index >= blocks_.size()) throw std::out_of_range("Trace archive block out of range");
+    const ArchiveBlockInfo& info = blocks_[index];
+    std::ifstream in(path_, std::ios::binary);
+    Bytes data(info.bytes);
+    in.seekg(static_cast<std::streamoff>(info.offset));
+    in.read(reinterpret_cast<char*>(data.data()), data.size());
+    if (!in) throw std::runtime_error("Failed to read trace archive block");
+    auto out = decode_block(data, version_);
+    if (out.size() != info.count) throw std::runtime_error("Trace archive block count mismatch");
+    return out;
+}
+
+// first_block_at relies on blocks covering non-decreasing time ranges, which
+// holds for traces sorted by arrival (as every loader produces).
+size_t TraceArchiveReader::first_block_at(double t_seconds) const {
+    int64_t t = to_ns(t_seconds);
+    auto it = std::lower_bound(blocks_.begin(), blocks_.end(), t,
+                               [](const ArchiveBlockInfo& b, int64_t v) { return b.max_ns < v; });
+    return static_cast<size_t>(it - blocks_.begin());
+}
+
+// read_blocks decodes [first, last) with each worker taking a strided share
+// of the blocks, then concatenates in block order.
+std::vector<Request> TraceArchiveReader::read_blocks(size_t first, size_t last,
+                                                     int threads) const {
+    size_t n = last > first ? last - first : 0;
+    std::vector<std::vector<Request>> parts(n);
+    if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<int>(std::min<size_t>(threads, std::max<size_t>(n, 1)));
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < n; ++i) parts[i] = read_block(first + i);
+    } else {
+        std::vector<std::thread> workers;
+        std::vector<std::exception_ptr> errors(threads);
+        for (int w = 0; w < threads; ++w) {
+            workers.emplace_back([&, w]() {
+                try {
+                    for (size_t i = w; i < n; i += threads) parts[i] = read_block(first + i);
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& t : workers) t.join();
+        for (auto& e : errors)
+            if (e) std::rethrow_exception(e);
+    }
+
+    size_t total = 0;
+    for (const auto& p : parts) total += p.size();
+    std::vector<Request> out;
+    out.reserve(total);
+    for (auto& p : parts) out.insert(out.end(), p.begin(), p.end());
+    return out;
+}
+
+std::vector<Request> TraceArchiveReader::read_range(double t0, double t1, int threads) const {
+    size_t first = first_block_at(t0);
+    int64_t end_ns = to_ns(t1);
+    auto last_it = std::lower_bound(blocks_.begin() + first, blocks_.end(), end_ns,
+                                    [](const ArchiveBlockInfo& b, int64_t v) {
+                                        return b.min_ns < v;
+                                    });
+    size_t last = static_cast<size_t>(last_it - blocks_.begin());
+
+    auto out = read_blocks(first, last, threads);
+    out.erase(std::remove_if(out.begin(), out.end(),
+                             [&](const Request& r) {
+                                 return r.arrival_ts < t0 || r.arrival_ts >= t1;
+                             }),
+              out.end());
+    return out;
+}
+
+std::vector<Request> TraceArchiveReader::read_all(int threads) const {
+    return read_blocks(0, blocks_.size(), threads);
+}
+
+} // namespace util
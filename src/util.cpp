@@ -1,7 +1,10 @@
 #include "util.hpp"
+#include "trace_archive.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <cmath>
+#include <functional>
 #include <fstream>
 #include <limits>
 #include <sstream>
@@ -89,177 +92,291 @@ OpType parse_op(std::string value) {
     throw std::runtime_error("Unknown op type: " + value);
 }
 
-} // namespace
-
-// load_trace_csv converts the CSV trace format into Request records ordered by
-// arrival timestamp. Timestamps are provided in microseconds, so they are
-// converted to seconds to match the simulator's floating-point timeline. The
-// parser accepts both the legacy 5-column format and the extended 6-column
-// format that provides explicit user IDs.
-std::vector<Request> load_trace_csv(const std::string& path) {
-    std::ifstream in(path);
-    if (!in.is_open()) {
-        throw std::runtime_error("Failed to open trace file: " + path);
+// parse_address accepts decimal or 0x-prefixed hex offsets. The column was
+// historically unused, so unparseable values map to offset 0 rather than
+// rejecting the trace.
+uint64_t parse_address(const std::string& value) {
+    try {
+        bool hex = value.size() > 2 && value[0] == '0' && (value[1] == 'x' || value[1] == 'X');
+        return std::stoull(value, nullptr, hex ? 16 : 10);
+    } catch (const std::exception&) {
+        return 0;
     }
+}
 
-    std::vector<Request> requests;
-    std::unordered_map<std::string, int> process_user_ids;
-    int next_auto_user_id = 0;
+// event_key identifies an in-flight blktrace request by device and sector.
+uint64_t event_key(const std::string& device, uint64_t sector) {
+    return (static_cast<uint64_t>(std::hash<std::string>{}(device)) << 48) ^ sector;
+}
 
-    std::string line;
-    size_t line_no = 0;
-    bool saw_data_line = false;
-
-    auto append_request = [&requests](int uid, OpType op, double ts_seconds,
-                                      uint32_t size_bytes) {
-        Request req{};
-        req.user_id = uid;
-        req.op = op;
-        req.arrival_ts = ts_seconds;
-        req.size_bytes = size_bytes;
-        req.start_ts = 0.0;
-        req.finish_ts = 0.0;
-        requests.push_back(req);
-    };
-
-    auto process_line = [&](const std::string& text, size_t current_line) {
-        std::stringstream ss(text);
-        std::vector<std::string> tokens;
-        tokens.reserve(6);
-
-        std::string token;
-        while (std::getline(ss, token, ',')) {
-            trim_in_place(token);
-            tokens.push_back(token);
-        }
-        if (tokens.empty()) return;
-
-        if (tokens.size() == 6) {
-            double ts_seconds = parse_timestamp_seconds(tokens[0], current_line);
-            const std::string& process_id = tokens[1];
-            int declared_uid = parse_user_id_field(tokens[2], current_line);
-            OpType op = parse_op(tokens[3]);
-            uint32_t size_bytes = parse_size_field(tokens[5], current_line);
-
-            auto [it, inserted] = process_user_ids.emplace(process_id, declared_uid);
-            if (!inserted && it->second != declared_uid) {
-                throw std::runtime_error("Line " + std::to_string(current_line) +
-                                         ": process '" + process_id +
-                                         "' has conflicting user_id values (" +
-                                         std::to_string(it->second) + " vs " +
-                                         std::to_string(declared_uid) + ")");
-            }
-            append_request(declared_uid, op, ts_seconds, size_bytes);
-            return;
-        }
+Request make_request(int uid, OpType op, double ts_seconds, uint32_t size_bytes,
+                     uint64_t address) {
+    Request req{};
+    req.user_id = uid;
+    req.op = op;
+    req.arrival_ts = ts_seconds;
+    req.size_bytes = size_bytes;
+    req.address = address;
+    req.start_ts = 0.0;
+    req.finish_ts = 0.0;
+    return req;
+}
 
-        if (tokens.size() == 5) {
-            double ts_seconds = parse_timestamp_seconds(tokens[0], current_line);
-            const std::string& process_id = tokens[1];
-            OpType op = parse_op(tokens[2]);
-            uint32_t size_bytes = parse_size_field(tokens[4], current_line);
+} // namespace
 
-            auto [it, inserted] =
-                process_user_ids.emplace(process_id, next_auto_user_id);
-            if (inserted) ++next_auto_user_id;
+// parse_line dispatches on the shape of |text|: 6-column CSV with explicit
+// user IDs, legacy 5-column CSV, or blkparse text.
+bool TraceParser::parse_line(const std::string& text, Request& out) {
+    ++line_no_;
+    std::string line = text;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
 
-            append_request(it->second, op, ts_seconds, size_bytes);
-            return;
-        }
+    const auto first = line.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) return false;
+    if (line[first] == '#') return false;
 
-        auto handle_blktrace = [&]() -> bool {
-            std::stringstream ws(text);
-            std::string device;
-            if (!(ws >> device)) return false;
-            if (device.find(',') == std::string::npos) return false;
-
-            std::string cpu_str, seq_str, ts_str, pid_str, action, rwbs;
-            if (!(ws >> cpu_str >> seq_str >> ts_str >> pid_str >> action >> rwbs))
-                return false;
-
-            double ts_seconds;
-            try {
-                ts_seconds = std::stod(ts_str);
-            } catch (const std::exception&) {
-                return false;
-            }
+    if (!saw_data_line_ && looks_like_header(line)) {
+        return false;
+    }
+    saw_data_line_ = true;
 
-            // Non-queue events are recognized but do not generate requests.
-            if (action != "Q") {
-                return true;
-            }
+    std::stringstream ss(line);
+    std::vector<std::string> tokens;
+    tokens.reserve(6);
 
-            std::string lba_str, plus_token, length_str;
-            if (!(ws >> lba_str >> plus_token >> length_str)) {
-                throw std::runtime_error("Line " + std::to_string(current_line) +
-                                         ": incomplete blktrace data for queue event");
-            }
-            if (plus_token != "+") {
-                throw std::runtime_error("Line " + std::to_string(current_line) +
-                                         ": expected '+' before sector count");
-            }
+    std::string token;
+    while (std::getline(ss, token, ',')) {
+        trim_in_place(token);
+        tokens.push_back(token);
+    }
+    if (tokens.empty()) return false;
+
+    bool produced = false;
+    if (tokens.size() == 6)
+        produced = parse_csv6(tokens, out);
+    else if (tokens.size() == 5)
+        produced = parse_csv5(tokens, out);
+    else if (!parse_blktrace(line, out, produced))
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": expected CSV or blktrace format");
+    if (produced) out.slot = next_slot_++;
+    return produced;
+}
 
-            uint64_t sectors = 0;
-            try {
-                sectors = std::stoull(length_str);
-            } catch (const std::exception& e) {
-                throw std::runtime_error("Line " + std::to_string(current_line) +
-                                         ": invalid sector count: " + e.what());
-            }
-            uint64_t bytes64 = sectors * static_cast<uint64_t>(kSectorSizeBytes);
-            if (bytes64 > std::numeric_limits<uint32_t>::max()) {
-                throw std::runtime_error("Line " + std::to_string(current_line) +
-                                         ": request size exceeds uint32_t");
-            }
-            uint32_t size_bytes = static_cast<uint32_t>(bytes64);
-
-            std::string cmd_token;
-            std::string process_label = pid_str;
-            if (ws >> cmd_token) {
-                if (!cmd_token.empty() && cmd_token.front() == '[') {
-                    if (cmd_token.back() == ']') {
-                        cmd_token = cmd_token.substr(1, cmd_token.size() - 2);
-                    } else {
-                        cmd_token.erase(0, 1);
-                    }
-                }
-                if (!cmd_token.empty()) {
-                    process_label += ":" + cmd_token;
-                }
-            }
+bool TraceParser::parse_csv6(const std::vector<std::string>& tokens, Request& out) {
+    double ts_seconds = parse_timestamp_seconds(tokens[0], line_no_);
+    const std::string& process_id = tokens[1];
+    int declared_uid = parse_user_id_field(tokens[2], line_no_);
+    OpType op = parse_op(tokens[3]);
+    uint32_t size_bytes = parse_size_field(tokens[5], line_no_);
+
+    auto it = process_user_ids_.find(process_id);
+    if (it == process_user_ids_.end()) {
+        if (!full()) process_user_ids_.emplace(process_id, declared_uid);
+    } else if (it->second != declared_uid) {
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": process '" + process_id +
+                                 "' has conflicting user_id values (" +
+                                 std::to_string(it->second) + " vs " +
+                                 std::to_string(declared_uid) + ")");
+    }
+    out = make_request(declared_uid, op, ts_seconds, size_bytes, parse_address(tokens[4]));
+    return true;
+}
 
-            std::transform(rwbs.begin(), rwbs.end(), rwbs.begin(),
-                           [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
-            OpType op = (rwbs.find('W') != std::string::npos) ? OpType::WRITE : OpType::READ;
+bool TraceParser::parse_csv5(const std::vector<std::string>& tokens, Request& out) {
+    double ts_seconds = parse_timestamp_seconds(tokens[0], line_no_);
+    const std::string& process_id = tokens[1];
+    OpType op = parse_op(tokens[2]);
+    uint32_t size_bytes = parse_size_field(tokens[4], line_no_);
 
-            auto [it, inserted] =
-                process_user_ids.emplace(process_label, next_auto_user_id);
-            if (inserted) ++next_auto_user_id;
+    out = make_request(user_for(process_id), op, ts_seconds, size_bytes,
+                       parse_address(tokens[3]));
+    return true;
+}
 
-            append_request(it->second, op, ts_seconds, size_bytes);
-            return true;
-        };
+// parse_blktrace returns false when |text| is not blkparse output. Otherwise it
+// sets |produced| when the line was a queue (Q) event that yields a request.
+bool TraceParser::parse_blktrace(const std::string& text, Request& out, bool& produced) {
+    produced = false;
+    std::stringstream ws(text);
+    std::string device;
+    if (!(ws >> device)) return false;
+    if (device.find(',') == std::string::npos) return false;
+
+    std::string cpu_str, seq_str, ts_str, pid_str, action, rwbs;
+    if (!(ws >> cpu_str >> seq_str >> ts_str >> pid_str >> action >> rwbs))
+        return false;
 
-        if (handle_blktrace()) return;
+    double ts_seconds;
+    try {
+        ts_seconds = std::stod(ts_str);
+    } catch (const std::exception&) {
+        return false;
+    }
 
-        throw std::runtime_error("Line " + std::to_string(current_line) +
-                                 ": expected CSV or blktrace format");
-    };
+    // Non-queue events are recognized but do not generate requests.
+    if (action != "Q") {
+        if (track_service_) track_event(device, action, ts_seconds, ws);
+        return true;
+    }
 
-    while (std::getline(in, line)) {
-        ++line_no;
-        if (!line.empty() && line.back() == '\r') line.pop_back();
+    std::string lba_str, plus_token, length_str;
+    if (!(ws >> lba_str >> plus_token >> length_str)) {
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": incomplete blktrace data for queue event");
+    }
+    if (plus_token != "+") {
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": expected '+' before sector count");
+    }
+
+    uint64_t sectors = 0;
+    try {
+        sectors = std::stoull(length_str);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": invalid sector count: " + e.what());
+    }
+    uint64_t bytes64 = sectors * static_cast<uint64_t>(kSectorSizeBytes);
+    if (bytes64 > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("Line " + std::to_string(line_no_) +
+                                 ": request size exceeds uint32_t");
+    }
+    uint32_t size_bytes = static_cast<uint32_t>(bytes64);
+
+    std::string cmd_token;
+    std::string process_label = pid_str;
+    if (ws >> cmd_token) {
+        if (!cmd_token.empty() && cmd_token.front() == '[') {
+            if (cmd_token.back() == ']') {
+                cmd_token = cmd_token.substr(1, cmd_token.size() - 2);
+            } else {
+                cmd_token.erase(0, 1);
+            }
+        }
+        if (!cmd_token.empty()) {
+            process_label += ":" + cmd_token;
+        }
+    }
 
-        const auto first = line.find_first_not_of(" \t\r\n");
-        if (first == std::string::npos) continue;
-        if (line[first] == '#') continue;
+    std::transform(rwbs.begin(), rwbs.end(), rwbs.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    OpType op = (rwbs.find('W') != std::string::npos) ? OpType::WRITE : OpType::READ;
+
+    uint64_t sector = 0;
+    try {
+        sector = std::stoull(lba_str);
+    } catch (const std::exception&) {
+        sector = 0;
+    }
+    out = make_request(user_for(process_label), op, ts_seconds, size_bytes,
+                       sector * kSectorSizeBytes);
+    produced = true;
+    if (track_service_) {
+        queued_[event_key(device, sector)] = next_slot_;
+        service_.push_back(std::numeric_limits<float>::quiet_NaN());
+        service_write_.push_back(op == OpType::WRITE);
+    }
+    return true;
+}
+
+// track_event follows a queued request through dispatch (D) to completion
+// (C). The dispatch length is what the device served, so a request that
+// absorbed merges is charged per byte of the merged size; merged requests
+// (M/F) themselves leave the join without a time of their own.
+void TraceParser::track_event(const std::string& device, const std::string& action, double ts,
+                              std::stringstream& rest) {
+    if (action != "D" && action != "C" && action != "M" && action != "F") return;
+    std::string lba_str, plus_token, length_str;
+    if (!(rest >> lba_str >> plus_token >> length_str) || plus_token != "+") return;
+    uint64_t sector = 0, sectors = 0;
+    try {
+        sector = std::stoull(lba_str);
+        sectors = std::stoull(length_str);
+    } catch (const std::exception&) {
+        return;
+    }
+    uint64_t key = event_key(device, sector);
+
+    if (action == "M" || action == "F") {
+        queued_.erase(key);
+    } else if (action == "D") {
+        auto it = queued_.find(key);
+        if (it == queued_.end()) return;
+        dispatched_[key] = { it->second, ts, std::max<uint64_t>(sectors * kSectorSizeBytes, 1) };
+        queued_.erase(it);
+    } else {
+        auto it = dispatched_.find(key);
+        if (it == dispatched_.end()) return;
+        const Dispatched& d = it->second;
+        service_[d.slot] = static_cast<float>(std::max(ts - d.ts, 0.0) / static_cast<double>(d.bytes));
+        dispatched_.erase(it);
+    }
+}
 
-        if (!saw_data_line && looks_like_header(line)) {
+ServiceTimes TraceParser::take_service_times() {
+    ServiceTimes out;
+    std::vector<float> observed[2];
+    for (size_t i = 0; i < service_.size(); ++i)
+        if (!std::isnan(service_[i])) observed[service_write_[i] ? 1 : 0].push_back(service_[i]);
+    float median[2];
+    for (int op = 0; op < 2; ++op) {
+        std::vector<float>& v = observed[op].empty() ? observed[1 - op] : observed[op];
+        if (v.empty()) {
+            median[op] = 0.0f;
             continue;
         }
+        std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+        median[op] = v[v.size() / 2];
+    }
+    out.observed = observed[0].size() + observed[1].size();
+    for (size_t i = 0; i < service_.size(); ++i)
+        if (std::isnan(service_[i])) service_[i] = median[service_write_[i] ? 1 : 0];
+    out.s_per_byte = std::move(service_);
+    service_.clear();
+    service_write_.clear();
+    queued_.clear();
+    dispatched_.clear();
+    return out;
+}
+
+// user_for returns the auto-assigned user ID for |label|, allocating the next
+// ID in order of first appearance. Past the cap, labels hash to IDs above it.
+int TraceParser::user_for(const std::string& label) {
+    auto it = process_user_ids_.find(label);
+    if (it != process_user_ids_.end()) return it->second;
+    if (full())
+        return max_users_ + static_cast<int>(std::hash<std::string>{}(label) %
+                                             static_cast<size_t>(max_users_));
+    process_user_ids_.emplace(label, next_auto_user_id_);
+    return next_auto_user_id_++;
+}
 
-        process_line(line, line_no);
-        saw_data_line = true;
+// load_trace_csv converts the CSV trace format into Request records ordered by
+// arrival timestamp. Timestamps are provided in microseconds, so they are
+// converted to seconds to match the simulator's floating-point timeline. The
+// parser accepts both the legacy 5-column format and the extended 6-column
+// format that provides explicit user IDs.
+std::vector<Request> load_trace_csv(const std::string& path, ServiceTimes* service) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+
+    std::vector<Request> requests;
+    TraceParser parser;
+    parser.track_service_times(service != nullptr);
+    std::string line;
+    Request req{};
+    while (std::getline(in, line)) {
+        if (parser.parse_line(line, req))
+            requests.push_back(req);
+    }
+    if (service) {
+        *service = parser.take_service_times();
+        if (service->observed == 0)
+            throw std::runtime_error("No dispatch/completion (D/C) events to replay in " + path);
     }
 
     std::sort(requests.begin(), requests.end(),
@@ -272,4 +389,12 @@ std::vector<Request> load_trace_csv(const std::string& path) {
     return requests;
 }
 
+std::vector<Request> load_trace(const std::string& path, ServiceTimes* service) {
+    if (is_trace_archive(path)) {
+        if (service) throw std::runtime_error("Trace archives carry no D/C events: " + path);
+        return TraceArchiveReader(path).read_all();
+    }
+    return load_trace_csv(path, service);
+}
+
 } // namespace util